@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/local-clock.h"
+#include "ns3/perfect-clock-model-impl.h"
+
+/**
+ * Distributed version of two-clocks-simple, to be run with mpirun:
+ *
+ *   mpirun -np 2 ./waf --run distributed-two-clocks
+ *
+ * Node n1 runs on rank 0 and node n2 on rank 1, or on rank 0 as well when there is a single rank, 
+ * which gives the same output.
+ * 
+ *              P2P (remote)
+ *   n1-----------------------n2
+ * clock1                   clock2
+ *  rank 0                   rank 1
+ * 
+ * The echo client of n1 sends a packet every second of its local time. Its clock runs twice as fast as 
+ * global time, then is slowed down to half the global time at 5 s. The clock of the echo server of n2 
+ * runs at half the global time. The simulator is DistributedLocalTimeSimulatorImpl.
+ **/
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DistributedTwoClocks");
+
+void
+SetClock (Ptr<LocalClock> clock, double freq, Time offset)
+{
+  clock -> AdjustClock (freq, offset);
+}
+
+void
+Sent (Ptr<LocalClock> clock, Ptr<const Packet> p)
+{
+  std::cout << "rank " << MpiInterface::GetSystemId () << " client sent " << p -> GetSize () << " bytes at global time " 
+            << Simulator::Now ().GetSeconds () << "s local time " << clock -> GetLocalTime ().GetSeconds () << "s" << std::endl;
+}
+
+void
+Received (Ptr<LocalClock> clock, Ptr<const Packet> p)
+{
+  std::cout << "rank " << MpiInterface::GetSystemId () << " server received " << p -> GetSize () << " bytes at global time " 
+            << Simulator::Now ().GetSeconds () << "s local time " << clock -> GetLocalTime ().GetSeconds () << "s" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+#ifdef NS3_MPI
+  CommandLine cmd;
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::DistributedLocalTimeSimulatorImpl"));
+  MpiInterface::Enable (&argc, &argv);
+
+  uint32_t systemId = MpiInterface::GetSystemId ();
+  uint32_t systemCount = MpiInterface::GetSize ();
+  uint32_t serverRank = systemCount > 1 ? 1 : 0;
+
+  Ptr<Node> n1 = CreateObject<Node> (0);
+  Ptr<Node> n2 = CreateObject<Node> (serverRank);
+  NodeContainer nodes (n1, n2);
+
+  Ptr<PerfectClockModelImpl> clockImpl1 = CreateObject<PerfectClockModelImpl> ();
+  clockImpl1 -> SetFrequency (2);
+  Ptr<LocalClock> clock1 = CreateObject<LocalClock> ();
+  clock1 -> SetAttribute ("ClockModel", PointerValue (clockImpl1));
+  n1 -> AggregateObject (clock1);
+
+  Ptr<PerfectClockModelImpl> clockImpl2 = CreateObject<PerfectClockModelImpl> ();
+  clockImpl2 -> SetFrequency (0.5);
+  Ptr<LocalClock> clock2 = CreateObject<LocalClock> ();
+  clock2 -> SetAttribute ("ClockModel", PointerValue (clockImpl2));
+  n2 -> AggregateObject (clock2);
+
+  PointToPointHelper pointToPoint;
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  NetDeviceContainer devices = pointToPoint.Install (nodes);
+
+  InternetStackHelper stack;
+  stack.Install (nodes);
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+
+  if (systemId == serverRank)
+    {
+      UdpEchoServerHelper echoServer (9);
+      ApplicationContainer serverApps = echoServer.Install (n2);
+      serverApps.Start (Seconds (0));
+      serverApps.Stop (Seconds (20));
+      serverApps.Get (0) -> TraceConnectWithoutContext ("Rx", MakeBoundCallback (&Received, clock2));
+    }
+
+  if (systemId == 0)
+    {
+      UdpEchoClientHelper echoClient (interfaces.GetAddress (1), 9);
+      echoClient.SetAttribute ("MaxPackets", UintegerValue (20));
+      echoClient.SetAttribute ("Interval", TimeValue (Seconds (1.0)));
+      echoClient.SetAttribute ("PacketSize", UintegerValue (1024));
+      ApplicationContainer clientApps = echoClient.Install (n1);
+      clientApps.Start (Seconds (0));
+      clientApps.Stop (Seconds (20));
+      clientApps.Get (0) -> TraceConnectWithoutContext ("Tx", MakeBoundCallback (&Sent, clock1));
+
+      //Slow the clock down at 5 s, keeping the local time continuous
+      Simulator::ScheduleWithContext (n1 -> GetId (), Seconds (5), &SetClock, clock1, 0.5, Seconds (7.5));
+    }
+
+  Simulator::Stop (Seconds (20));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  MpiInterface::Disable ();
+  return 0;
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
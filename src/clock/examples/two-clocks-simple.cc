@@ -22,6 +22,9 @@
 #include "ns3/applications-module.h"
 #include "ns3/local-clock.h"
 #include "ns3/perfect-clock-model-impl.h"
+#include "ns3/piecewise-clock-model-impl.h"
+#include "ns3/hardware-timestamp-tag.h"
+#include "ns3/clock-helper.h"
 #include "ns3/gnuplot-helper.h"
 
 /**
@@ -76,6 +79,9 @@
  * |  /
  * |_/_____________GlobalTime
  *     x1    x2 ......n
+ *
+ * With --timestamps, the point to point devices stamp the packets in the local time of their node when the transmission
+ * starts and when the reception ends, and the server prints the timestamps of the requests it receives.
  **/
 
 
@@ -92,11 +98,26 @@ void setClock (Ptr<LocalClock> clock, double freq, Time offset)
   clock -> SetClock (clockImpl);
 }
 
+void PrintTimestamps (Ptr<const Packet> packet)
+{
+  HardwareTimestampTag tag;
+  if (packet -> PeekPacketTag (tag))
+  {
+    std::cout << "Request sent at " << tag.GetTxTimestamp ().GetSeconds () << "s local time of node 0, received at " 
+              << tag.GetRxTimestamp ().GetSeconds () << "s local time of node 1" << std::endl;
+  }
+}
+
 int
 main (int argc, char *argv[])
 {
 
+  bool piecewise = false;
+  bool timestamps = false;
+
   CommandLine cmd;
+  cmd.AddValue ("piecewise", "Load the drift profile of node 0 in a PiecewiseClockModelImpl instead of updating its clock", piecewise);
+  cmd.AddValue ("timestamps", "Stamp the packets in local time at the devices and print the timestamps of the requests", timestamps);
   cmd.Parse (argc, argv);
 
   //Set LocalTime Simulator Impl
@@ -144,6 +165,11 @@ main (int argc, char *argv[])
 
   NetDeviceContainer devices;
   devices = pointToPoint.Install (nodes);
+  if (timestamps)
+  {
+    HardwareTimestampHelper timestampHelper;
+    timestampHelper.Install (devices);
+  }
 
   InternetStackHelper stack;
   stack.Install (nodes);
@@ -159,6 +185,10 @@ main (int argc, char *argv[])
   ApplicationContainer serverApps = echoServer.Install (nodes.Get (1));
   serverApps.Start (Seconds (0));
   serverApps.Stop (Seconds (maxTime));
+  if (timestamps)
+  {
+    serverApps.Get (0) -> TraceConnectWithoutContext ("Rx", MakeCallback (&PrintTimestamps));
+  }
 
   UdpEchoClientHelper echoClient (interfaces.GetAddress (1), 9);
   echoClient.SetAttribute ("MaxPackets", UintegerValue (100));
@@ -175,6 +205,12 @@ main (int argc, char *argv[])
   double newFreq;
  
   Ptr<ClockModel> clockImpl;
+  Ptr<PiecewiseClockModelImpl> profile;
+  if (piecewise)
+  {
+    profile = CreateObject<PiecewiseClockModelImpl> ();
+    profile -> AddSegment (Seconds (0), freq);
+  }
   
   for (int i=20;i<maxTime;i+=20)
   {
@@ -194,7 +230,18 @@ main (int argc, char *argv[])
       j=0;
       std::cout << "OFFSET" << init_offset << std::endl;
     }
-    Simulator::ScheduleWithContext (0, Seconds (i), &setClock, clock0, freq, init_offset);
+    if (piecewise)
+    {
+      profile -> AddSegment (Seconds (i), freq);
+    }
+    else
+    {
+      Simulator::ScheduleWithContext (0, Seconds (i), &setClock, clock0, freq, init_offset);
+    }
+  }
+  if (piecewise)
+  {
+    clock0 -> SetAttribute ("ClockModel", PointerValue (profile));
   }
 
   GnuplotHelper plotHelper;
@@ -1,11 +1,419 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
 
 #include "clock-helper.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/localtime-simulator-impl.h"
+#include "ns3/hardware-timestamp-tag.h"
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+#include <cstring>
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::ClockHelper, ns3::ClockTraceFile, ns3::ClockTraceHelper and ns3::HardwareTimestampHelper implementations.
+ */
 
 namespace ns3 {
 
-/* ... */
+NS_LOG_COMPONENT_DEFINE ("ClockHelper");
+
+ClockHelper::ClockHelper ()
+{
+  m_factory.SetTypeId ("ns3::PerfectClockModelImpl");
+}
+
+void
+ClockHelper::SetClockModel (std::string type)
+{
+  m_factory.SetTypeId (type);
+}
+
+void
+ClockHelper::SetClockModelAttribute (std::string name, const AttributeValue &value)
+{
+  m_factory.Set (name, value);
+}
+
+void
+ClockHelper::SetFrequency (Ptr<RandomVariableStream> frequency)
+{
+  m_frequency = frequency;
+}
+
+void
+ClockHelper::SetOffset (Ptr<RandomVariableStream> offset)
+{
+  m_offset = offset;
+}
+
+std::vector<Ptr<LocalClock> >
+ClockHelper::Install (NodeContainer c) const
+{
+  NS_LOG_FUNCTION (this << c.GetN ());
+  LocalTimeSimulatorImpl *simImpl = LocalTimeSimulatorImpl::GetCurrent ();
+  if (simImpl != 0)
+    {
+      uint32_t nContexts = 0;
+      for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+        {
+          nContexts = std::max (nContexts, (*i)->GetId () + 1);
+        }
+      simImpl->ReserveClocks (nContexts);
+    }
+
+  std::vector<Ptr<LocalClock> > clocks;
+  clocks.reserve (c.GetN ());
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      clocks.push_back (InstallPriv (*i));
+    }
+  return clocks;
+}
+
+Ptr<LocalClock>
+ClockHelper::Install (Ptr<Node> node) const
+{
+  return InstallPriv (node);
+}
+
+Ptr<LocalClock>
+ClockHelper::InstallPriv (Ptr<Node> node) const
+{
+  NS_ABORT_MSG_IF (node->GetObject<LocalClock> () != 0, "Node " << node->GetId () << " already has a clock");
+  Ptr<ClockModel> model = m_factory.Create<ClockModel> ();
+  if (m_frequency != 0)
+    {
+      model->SetAttribute ("Frequency", DoubleValue (m_frequency->GetValue ()));
+    }
+  if (m_offset != 0)
+    {
+      model->SetAttribute ("Offset", TimeValue (Seconds (m_offset->GetValue ())));
+    }
+  Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+  clock->SetAttribute ("ClockModel", PointerValue (model));
+  //Registers the clock in the clock table of the simulator
+  node->AggregateObject (clock);
+  return clock;
+}
+
+int64_t
+ClockHelper::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  int64_t currentStream = stream;
+  if (m_frequency != 0)
+    {
+      m_frequency->SetStream (currentStream++);
+    }
+  if (m_offset != 0)
+    {
+      m_offset->SetStream (currentStream++);
+    }
+  return (currentStream - stream);
+}
+
+/** First bytes of a clock trace file. */
+static const char CLOCK_TRACE_MAGIC[8] = {'n', 's', '3', 'c', 'l', 'o', 'c', 'k'};
+/** Version of the format of the clock trace files. */
+static const uint32_t CLOCK_TRACE_VERSION = 1;
 
+ClockTraceFile::ClockTraceFile (std::string filename, uint32_t blockSize)
+  : m_blockSize (blockSize),
+    m_nWritten (0)
+{
+  NS_LOG_FUNCTION (this << filename << blockSize);
+  NS_ABORT_MSG_IF (blockSize == 0, "A block holds at least one record");
+  m_file.open (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ABORT_MSG_UNLESS (m_file.is_open (), "Unable to open clock trace file " << filename);
 
+  int32_t unit = Time::GetResolution ();
+  m_file.write (CLOCK_TRACE_MAGIC, sizeof (CLOCK_TRACE_MAGIC));
+  m_file.write (reinterpret_cast<const char *> (&CLOCK_TRACE_VERSION), sizeof (CLOCK_TRACE_VERSION));
+  m_file.write (reinterpret_cast<const char *> (&unit), sizeof (unit));
+
+  m_types.reserve (blockSize);
+  m_nodes.reserve (blockSize);
+  m_globals.reserve (blockSize);
+  m_as.reserve (blockSize);
+  m_bs.reserve (blockSize);
 }
 
+ClockTraceFile::~ClockTraceFile ()
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+}
+
+/**
+ * \brief Write a column of a block.
+ * \param file The file
+ * \param column The column
+ */
+template <typename T>
+static void
+WriteColumn (std::ofstream &file, const std::vector<T> &column)
+{
+  file.write (reinterpret_cast<const char *> (&column[0]), column.size () * sizeof (T));
+}
+
+/**
+ * \brief Read a column of a block.
+ * \param file The file
+ * \param n Number of records of the block
+ * \param column Receives the column
+ */
+template <typename T>
+static void
+ReadColumn (std::ifstream &file, uint32_t n, std::vector<T> &column)
+{
+  column.resize (n);
+  file.read (reinterpret_cast<char *> (&column[0]), n * sizeof (T));
+}
+
+void
+ClockTraceFile::Flush (void)
+{
+  NS_LOG_FUNCTION (this << m_types.size ());
+  uint32_t n = m_types.size ();
+  if (n == 0)
+    {
+      return;
+    }
+  m_file.write (reinterpret_cast<const char *> (&n), sizeof (n));
+  WriteColumn (m_file, m_types);
+  WriteColumn (m_file, m_nodes);
+  WriteColumn (m_file, m_globals);
+  WriteColumn (m_file, m_as);
+  WriteColumn (m_file, m_bs);
+  m_file.flush ();
+  m_nWritten += n;
+
+  m_types.clear ();
+  m_nodes.clear ();
+  m_globals.clear ();
+  m_as.clear ();
+  m_bs.clear ();
+}
+
+uint64_t
+ClockTraceFile::GetNRecords (void) const
+{
+  return m_nWritten + m_types.size ();
+}
+
+bool
+ClockTraceFile::Read (std::string filename, std::vector<Record> &records)
+{
+  NS_LOG_FUNCTION (filename);
+  std::ifstream file (filename.c_str (), std::ios::in | std::ios::binary);
+  char magic[sizeof (CLOCK_TRACE_MAGIC)];
+  uint32_t version;
+  int32_t unit;
+  file.read (magic, sizeof (magic));
+  file.read (reinterpret_cast<char *> (&version), sizeof (version));
+  file.read (reinterpret_cast<char *> (&unit), sizeof (unit));
+  if (!file || std::memcmp (magic, CLOCK_TRACE_MAGIC, sizeof (magic)) != 0 || version != CLOCK_TRACE_VERSION)
+    {
+      return false;
+    }
+
+  std::vector<uint8_t> types;
+  std::vector<uint32_t> nodes;
+  std::vector<int64_t> globals;
+  std::vector<int64_t> as;
+  std::vector<int64_t> bs;
+  uint32_t n;
+  while (file.read (reinterpret_cast<char *> (&n), sizeof (n)))
+    {
+      ReadColumn (file, n, types);
+      ReadColumn (file, n, nodes);
+      ReadColumn (file, n, globals);
+      ReadColumn (file, n, as);
+      ReadColumn (file, n, bs);
+      if (!file)
+        {
+          return false;
+        }
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Record record;
+          record.type = types[i];
+          record.node = nodes[i];
+          record.global = globals[i];
+          record.a = as[i];
+          record.b = bs[i];
+          records.push_back (record);
+        }
+    }
+  return true;
+}
+
+/** Clocks sampled by a ClockTraceHelper. */
+class ClockSampler : public SimpleRefCount<ClockSampler>
+{
+public:
+  /** The file of the samples. */
+  Ptr<ClockTraceFile> file;
+  /** Global time between two samples. */
+  Time interval;
+  /** The sampled clocks. */
+  std::vector<Ptr<LocalClock> > clocks;
+  /** Id of the node of each clock. */
+  std::vector<uint32_t> nodes;
+
+  /** Sample all the clocks, and schedule the next samples. */
+  void Sample (void);
+};
+
+void
+ClockSampler::Sample (void)
+{
+  int64_t global = Simulator::Now ().GetTimeStep ();
+  for (std::size_t i = 0; i < clocks.size (); ++i)
+    {
+      file->Write (ClockTraceFile::SAMPLE, nodes[i], global, clocks[i]->GetLocalTime ().GetTimeStep (), 0);
+    }
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, interval, &ClockSampler::Sample, Ptr<ClockSampler> (this));
+}
+
+/**
+ * \brief Sink of the ClockUpdate trace source.
+ * \param file The file
+ * \param node Id of the node
+ * \param oldLocalTime Local time before the update
+ * \param newLocalTime Local time after the update
+ */
+static void
+ClockUpdateSink (Ptr<ClockTraceFile> file, uint32_t node, Time oldLocalTime, Time newLocalTime)
+{
+  file->Write (ClockTraceFile::CLOCK_UPDATE, node, Simulator::Now ().GetTimeStep (),
+               oldLocalTime.GetTimeStep (), newLocalTime.GetTimeStep ());
+}
+
+/**
+ * \brief Sink of the EventRescheduled trace source.
+ * \param file The file
+ * \param node Id of the node
+ * \param oldTs Global time of the event before it was moved
+ * \param newTs Global time of the event after it was moved
+ */
+static void
+EventRescheduledSink (Ptr<ClockTraceFile> file, uint32_t node, Time oldTs, Time newTs)
+{
+  file->Write (ClockTraceFile::EVENT_RESCHEDULED, node, Simulator::Now ().GetTimeStep (),
+               oldTs.GetTimeStep (), newTs.GetTimeStep ());
+}
+
+ClockTraceHelper::ClockTraceHelper ()
+  : m_blockSize (65536)
+{
+}
+
+void
+ClockTraceHelper::SetBlockSize (uint32_t blockSize)
+{
+  m_blockSize = blockSize;
+}
+
+Ptr<ClockTraceFile>
+ClockTraceHelper::EnableTracing (std::string filename, NodeContainer nodes, Time interval)
+{
+  NS_LOG_FUNCTION (this << filename << nodes.GetN () << interval);
+  Ptr<ClockTraceFile> file = Create<ClockTraceFile> (filename, m_blockSize);
+  Ptr<ClockSampler> sampler = Create<ClockSampler> ();
+  sampler->file = file;
+  sampler->interval = interval;
+  sampler->clocks.reserve (nodes.GetN ());
+  sampler->nodes.reserve (nodes.GetN ());
+  for (NodeContainer::Iterator i = nodes.Begin (); i != nodes.End (); ++i)
+    {
+      Ptr<LocalClock> clock = (*i)->GetObject<LocalClock> ();
+      if (clock == 0)
+        {
+          NS_LOG_WARN ("Node " << (*i)->GetId () << " has no clock to trace");
+          continue;
+        }
+      uint32_t id = (*i)->GetId ();
+      clock->TraceConnectWithoutContext ("ClockUpdate", MakeBoundCallback (&ClockUpdateSink, file, id));
+      clock->TraceConnectWithoutContext ("EventRescheduled", MakeBoundCallback (&EventRescheduledSink, file, id));
+      sampler->clocks.push_back (clock);
+      sampler->nodes.push_back (id);
+    }
+  if (interval.IsStrictlyPositive ())
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (0), &ClockSampler::Sample, sampler);
+    }
+  Simulator::ScheduleDestroy (&ClockTraceFile::Flush, file);
+  return file;
+}
+
+/**
+ * \brief Sink of the PhyTxBegin trace source.
+ * \param clock Clock of the node, 0 to stamp in global time
+ * \param packet The packet whose transmission starts
+ */
+static void
+TxTimestampSink (Ptr<LocalClock> clock, Ptr<const Packet> packet)
+{
+  HardwareTimestampTag tag;
+  tag.SetTxTimestamp (clock != 0 ? clock->GetTimestamp () : Simulator::Now ());
+  //Packet tags are not part of the packet data, they can be changed on the packet being sent
+  ConstCast<Packet> (packet)->ReplacePacketTag (tag);
+}
+
+/**
+ * \brief Sink of the PhyRxEnd trace source.
+ * \param clock Clock of the node, 0 to stamp in global time
+ * \param packet The packet received
+ */
+static void
+RxTimestampSink (Ptr<LocalClock> clock, Ptr<const Packet> packet)
+{
+  HardwareTimestampTag tag;
+  packet->PeekPacketTag (tag);
+  tag.SetRxTimestamp (clock != 0 ? clock->GetTimestamp () : Simulator::Now ());
+  ConstCast<Packet> (packet)->ReplacePacketTag (tag);
+}
+
+void
+HardwareTimestampHelper::Install (NetDeviceContainer c) const
+{
+  NS_LOG_FUNCTION (this << c.GetN ());
+  for (NetDeviceContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Install (*i);
+    }
+}
+
+void
+HardwareTimestampHelper::Install (Ptr<NetDevice> device) const
+{
+  NS_LOG_FUNCTION (this << device);
+  Ptr<LocalClock> clock = device->GetNode ()->GetObject<LocalClock> ();
+  bool connected = device->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&TxTimestampSink, clock))
+    && device->TraceConnectWithoutContext ("PhyRxEnd", MakeBoundCallback (&RxTimestampSink, clock));
+  NS_ABORT_MSG_UNLESS (connected, "Device " << device->GetInstanceTypeId ().GetName ()
+                       << " has no PhyTxBegin and PhyRxEnd trace sources to stamp packets");
+}
+
+}
@@ -1,13 +1,286 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
 #ifndef CLOCK_HELPER_H
 #define CLOCK_HELPER_H
 
+#include "ns3/local-clock.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "ns3/object-factory.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simple-ref-count.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::ClockHelper, ns3::ClockTraceFile, ns3::ClockTraceHelper and ns3::HardwareTimestampHelper declarations.
+ */
 
 namespace ns3 {
 
-/* ... */
+/**
+ * \ingroup Clock
+ *
+ * @brief Install a LocalClock on each node of a set of nodes.
+ *
+ * Each clock gets its own clock model, created from the type and the attributes set on the helper. The frequency and
+ * the offset of each model are drawn from random variables, so the model must have Frequency and Offset attributes,
+ * as PerfectClockModelImpl and StochasticClockModelImpl have. The offset is drawn in seconds.
+ *
+ * The clocks are registered in the clock table of LocalTimeSimulatorImpl as they are installed, so the simulator
+ * implementation must be selected before. The table is allocated once for all the nodes of the container.
+ */
+class ClockHelper
+{
+public:
+  /** Create a helper that installs perfect clocks with the default attributes. */
+  ClockHelper ();
+
+  /**
+   * \param type Type of the clock models, a subclass of ClockModel
+   */
+  void SetClockModel (std::string type);
+  /**
+   * \param name Name of an attribute of the clock models
+   * \param value Value of the attribute
+   */
+  void SetClockModelAttribute (std::string name, const AttributeValue &value);
+  /**
+   * \param frequency Random variable of the frequency of the clocks, 0 to keep the attribute of the model
+   */
+  void SetFrequency (Ptr<RandomVariableStream> frequency);
+  /**
+   * \param offset Random variable of the offset of the clocks in seconds, 0 to keep the attribute of the model
+   */
+  void SetOffset (Ptr<RandomVariableStream> offset);
+
+  /**
+   * \brief Install a clock on each node.
+   * \param c The nodes, which must not have a clock yet
+   * \return The clocks, in the order of the nodes
+   */
+  std::vector<Ptr<LocalClock> > Install (NodeContainer c) const;
+  /**
+   * \brief Install a clock on a node.
+   * \param node The node, which must not have a clock yet
+   * \return The clock
+   */
+  Ptr<LocalClock> Install (Ptr<Node> node) const;
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random variables of the frequency and the offset.
+   * \param stream First stream index to use
+   * \return The number of stream indices assigned by this helper
+   */
+  int64_t AssignStreams (int64_t stream);
+
+private:
+  /**
+   * \param node The node
+   * \return The clock installed on the node
+   */
+  Ptr<LocalClock> InstallPriv (Ptr<Node> node) const;
+
+  /** Factory of the clock models. */
+  ObjectFactory m_factory;
+  /** Frequency of the clocks, may be 0. */
+  Ptr<RandomVariableStream> m_frequency;
+  /** Offset of the clocks in seconds, may be 0. */
+  Ptr<RandomVariableStream> m_offset;
+};
+
+/**
+ * \ingroup Clock
+ *
+ * @brief Binary columnar file of clock traces.
+ *
+ * Records are buffered column by column and written a block at a time, so that a record costs a few stores
+ * and no formatting. The file is made of, in the byte order of the host:
+ *  - a header: the 8 characters "ns3clock", the version (uint32_t, 1) and the unit of the time steps
+ *    (int32_t, a Time::Unit).
+ *  - blocks: the number of records n (uint32_t), then each column of the block stored contiguously:
+ *    n types (uint8_t), n node ids (uint32_t), n global times (int64_t), n values a (int64_t) and n values b (int64_t).
+ *
+ * All the times are in time steps, the global time is the time at which the record was written. For each type:
+ *  - SAMPLE: a is the local time of the node, b is 0.
+ *  - CLOCK_UPDATE: a and b are the local times of the node before and after the update.
+ *  - EVENT_RESCHEDULED: a and b are the global times of the event before and after it was moved.
+ *
+ * The last block is written by Flush () or when the file is destroyed.
+ */
+class ClockTraceFile : public SimpleRefCount<ClockTraceFile>
+{
+public:
+  /** Type of a record. */
+  enum RecordType
+  {
+    SAMPLE = 0,
+    CLOCK_UPDATE = 1,
+    EVENT_RESCHEDULED = 2
+  };
+  /** Record read back from a file. */
+  struct Record
+  {
+    /** Type of the record, a RecordType. */
+    uint8_t type;
+    /** Id of the node. */
+    uint32_t node;
+    /** Global time of the record, in time steps. */
+    int64_t global;
+    /** First value, in time steps. */
+    int64_t a;
+    /** Second value, in time steps. */
+    int64_t b;
+  };
+
+  /**
+   * \brief Create the file and write its header.
+   * \param filename Name of the file
+   * \param blockSize Number of records buffered before a block is written
+   */
+  ClockTraceFile (std::string filename, uint32_t blockSize);
+  /** Destructor, writes the records still buffered. */
+  ~ClockTraceFile ();
+
+  /**
+   * \brief Append a record, and write the block once it is full.
+   * \param type Type of the record
+   * \param node Id of the node
+   * \param global Global time in time steps
+   * \param a First value in time steps
+   * \param b Second value in time steps
+   */
+  void Write (RecordType type, uint32_t node, int64_t global, int64_t a, int64_t b);
+  /** Write the records buffered as a block. */
+  void Flush (void);
+  /**
+   * \return Number of records written to the file or buffered
+   */
+  uint64_t GetNRecords (void) const;
+
+  /**
+   * \brief Read back a whole file.
+   * \param filename Name of the file
+   * \param records Container that receives the records
+   * \return false if the file cannot be opened or is not a clock trace of this version
+   */
+  static bool Read (std::string filename, std::vector<Record> &records);
 
+private:
+  /** The file. */
+  std::ofstream m_file;
+  /** Number of records of a block. */
+  uint32_t m_blockSize;
+  /** Number of records written as blocks. */
+  uint64_t m_nWritten;
+  /** Column of the types. */
+  std::vector<uint8_t> m_types;
+  /** Column of the node ids. */
+  std::vector<uint32_t> m_nodes;
+  /** Column of the global times. */
+  std::vector<int64_t> m_globals;
+  /** Column of the values a. */
+  std::vector<int64_t> m_as;
+  /** Column of the values b. */
+  std::vector<int64_t> m_bs;
+};
+
+inline void
+ClockTraceFile::Write (RecordType type, uint32_t node, int64_t global, int64_t a, int64_t b)
+{
+  m_types.push_back (type);
+  m_nodes.push_back (node);
+  m_globals.push_back (global);
+  m_as.push_back (a);
+  m_bs.push_back (b);
+  if (m_types.size () == m_blockSize)
+    {
+      Flush ();
+    }
 }
 
-#endif /* CLOCK_HELPER_H */
+/**
+ * \ingroup Clock
+ *
+ * @brief Trace the clocks of a set of nodes in a ClockTraceFile.
+ *
+ * The ClockUpdate and EventRescheduled trace sources of the LocalClock of each node are connected to the file,
+ * and the local time of all the nodes is sampled periodically by a single event without context, which runs on
+ * global time. The sampling event reschedules itself until the end of the simulation, so Simulator::Stop () must
+ * be called. The records still buffered are written when the simulator is destroyed.
+ *
+ * The file is not protected by any lock, so the nodes must not run in parallel, as they do with
+ * MultithreadedLocalTimeSimulatorImpl.
+ */
+class ClockTraceHelper
+{
+public:
+  ClockTraceHelper ();
+
+  /**
+   * \param blockSize Number of records buffered before a block is written
+   */
+  void SetBlockSize (uint32_t blockSize);
+
+  /**
+   * \brief Trace the clocks of \p nodes. The nodes without a LocalClock are ignored.
+   * \param filename Name of the file
+   * \param nodes The nodes
+   * \param interval Global time between two samples, 0 to trace the updates only
+   * \return The file, which can be flushed by the caller
+   */
+  Ptr<ClockTraceFile> EnableTracing (std::string filename, NodeContainer nodes, Time interval);
+
+private:
+  /** Number of records of a block. */
+  uint32_t m_blockSize;
+};
 
+/**
+ * \ingroup Clock
+ *
+ * @brief Make network devices stamp the packets they send and receive with a HardwareTimestampTag.
+ *
+ * The PhyTxBegin and PhyRxEnd trace sources of each device are connected to sinks bound to the LocalClock of its node,
+ * which is looked up once, when the device is installed. The timestamps are then read inline from the clock, without
+ * any lookup per packet. PointToPointNetDevice and CsmaNetDevice have these trace sources.
+ *
+ * The transmit timestamp replaces the tag a forwarded packet still carries from its previous hop.
+ * The nodes without a LocalClock stamp the packets in global time.
+ */
+class HardwareTimestampHelper
+{
+public:
+  /**
+   * \brief Stamp the packets of each device.
+   * \param c The devices, which must have PhyTxBegin and PhyRxEnd trace sources
+   */
+  void Install (NetDeviceContainer c) const;
+  /**
+   * \brief Stamp the packets of a device.
+   * \param device The device, which must have PhyTxBegin and PhyRxEnd trace sources
+   */
+  void Install (Ptr<NetDevice> device) const;
+};
+
+}
+
+#endif /* CLOCK_HELPER_H */
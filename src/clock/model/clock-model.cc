@@ -41,4 +41,20 @@ ClockModel::GetTypeId (void)
   ;
   return tid;
 }
+
+Time
+ClockModel::GlobalDelayToLocalDelay (Time globalTime, Time globalDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << globalDelay);
+  return GlobalToLocalTime (globalTime + globalDelay) - GlobalToLocalTime (globalTime);
+}
+
+Time
+ClockModel::LocalDelayToGlobalDelay (Time globalTime, Time localDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << localDelay);
+  Time globalAbsTime = LocalToGlobalTime (GlobalToLocalTime (globalTime) + localDelay);
+  return Max (globalAbsTime - globalTime, Time (0));
+}
+
 }
\ No newline at end of file
@@ -54,6 +54,26 @@ public:
   virtual Time GlobalToLocalDelay (Time globaldDelay) = 0;
   /**  \copydoc ClockModel::GlobalToLocalAbs  */
   virtual Time LocalToGlobalDelay (Time localdelay) = 0;
+
+  /**
+   * \brief Translate a global delay, counted from \p globalTime, into a local delay.
+   * Unlike GlobalToLocalDelay () the current time is given, so the conversion does not need to call Simulator::Now ().
+   * The default implementation goes through GlobalToLocalTime (), models can override it with a fused conversion.
+   * \param globalTime Global time at which the delay starts
+   * \param globalDelay Delay in global time
+   * \return Delay in local time
+   */
+  virtual Time GlobalDelayToLocalDelay (Time globalTime, Time globalDelay);
+  /**
+   * \brief Translate a local delay, counted from \p globalTime, into a global delay.
+   * This is the conversion done for every event scheduled by a node.
+   * The default implementation goes through GlobalToLocalTime () and LocalToGlobalTime (), 
+   * models can override it with a fused conversion.
+   * \param globalTime Global time at which the delay starts
+   * \param localDelay Delay in local time
+   * \return Delay in global time, never negative
+   */
+  virtual Time LocalDelayToGlobalDelay (Time globalTime, Time localDelay);
   
 };
 }// namespace ns3
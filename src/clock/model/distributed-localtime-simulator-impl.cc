@@ -0,0 +1,294 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "distributed-localtime-simulator-impl.h"
+#include "ns3/granted-time-window-mpi-interface.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/simulator.h"
+#include "ns3/channel.h"
+#include "ns3/node-container.h"
+#include "ns3/log.h"
+
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::DistributedLocalTimeSimulatorImpl implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DistributedLocalTimeSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (DistributedLocalTimeSimulatorImpl);
+
+TypeId
+DistributedLocalTimeSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DistributedLocalTimeSimulatorImpl")
+    .SetParent<LocalTimeSimulatorImpl> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<DistributedLocalTimeSimulatorImpl> ()
+  ;
+  return tid;
+}
+
+DistributedLocalTimeSimulatorImpl::DistributedLocalTimeSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  m_myId = MpiInterface::GetSystemId ();
+  m_systemCount = MpiInterface::GetSize ();
+
+  // Allocate the LBTS message buffer
+  m_pLBTS = new LbtsMessage[m_systemCount];
+  m_grantedTime = Seconds (0);
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+
+  m_globalFinished = false;
+  m_lookAhead = Seconds (-1);
+}
+
+DistributedLocalTimeSimulatorImpl::~DistributedLocalTimeSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DistributedLocalTimeSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  delete [] m_pLBTS;
+  m_pLBTS = 0;
+  LocalTimeSimulatorImpl::DoDispose ();
+}
+
+void
+DistributedLocalTimeSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  LocalTimeSimulatorImpl::Destroy ();
+  MpiInterface::Destroy ();
+}
+
+void
+DistributedLocalTimeSimulatorImpl::CalculateLookAhead (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  if (MpiInterface::GetSize () <= 1)
+    {
+      m_lookAhead = Seconds (0);
+    }
+  else
+    {
+      if (m_lookAhead == Seconds (-1))
+        {
+          m_lookAhead = GetMaximumSimulationTime ();
+        }
+      // else it was already set by SetMaximumLookAhead
+
+      // The channel delays are global-time delays, they do not depend on the clocks of the nodes
+      NodeContainer c = NodeContainer::GetGlobal ();
+      for (NodeContainer::Iterator iter = c.Begin (); iter != c.End (); ++iter)
+        {
+          if ((*iter)->GetSystemId () != MpiInterface::GetSystemId ())
+            {
+              continue;
+            }
+
+          for (uint32_t i = 0; i < (*iter)->GetNDevices (); ++i)
+            {
+              Ptr<NetDevice> localNetDevice = (*iter)->GetDevice (i);
+              // only works for p2p links currently
+              if (!localNetDevice->IsPointToPoint ())
+                {
+                  continue;
+                }
+              Ptr<Channel> channel = localNetDevice->GetChannel ();
+              if (channel == 0)
+                {
+                  continue;
+                }
+
+              // grab the adjacent node
+              Ptr<Node> remoteNode;
+              if (channel->GetDevice (0) == localNetDevice)
+                {
+                  remoteNode = (channel->GetDevice (1))->GetNode ();
+                }
+              else
+                {
+                  remoteNode = (channel->GetDevice (0))->GetNode ();
+                }
+
+              // if it's not remote, don't consider it
+              if (remoteNode->GetSystemId () == MpiInterface::GetSystemId ())
+                {
+                  continue;
+                }
+
+              TimeValue delay;
+              channel->GetAttribute ("Delay", delay);
+              if (delay.Get () < m_lookAhead)
+                {
+                  m_lookAhead = delay.Get ();
+                }
+            }
+        }
+    }
+
+  // m_lookAhead is now set
+  m_grantedTime = m_lookAhead;
+
+  // Tasks with no inter-task links use the largest lookahead of the other tasks,
+  // see DistributedSimulatorImpl::CalculateLookAhead ()
+  long sendbuf;
+  long recvbuf;
+  if (m_lookAhead == GetMaximumSimulationTime ())
+    {
+      sendbuf = 0;
+    }
+  else
+    {
+      sendbuf = m_lookAhead.GetInteger ();
+    }
+
+  MPI_Allreduce (&sendbuf, &recvbuf, 1, MPI_LONG, MPI_MAX, MPI_COMM_WORLD);
+
+  if (m_lookAhead == GetMaximumSimulationTime () && recvbuf != 0)
+    {
+      m_lookAhead = Time (recvbuf);
+      m_grantedTime = m_lookAhead;
+    }
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+DistributedLocalTimeSimulatorImpl::SetMaximumLookAhead (const Time lookAhead)
+{
+  if (lookAhead > Time (0))
+    {
+      NS_LOG_FUNCTION (this << lookAhead);
+      m_lookAhead = lookAhead;
+    }
+  else
+    {
+      NS_LOG_WARN ("attempted to set look ahead negative: " << lookAhead);
+    }
+}
+
+bool
+DistributedLocalTimeSimulatorImpl::IsFinished (void) const
+{
+  return m_globalFinished;
+}
+
+uint32_t
+DistributedLocalTimeSimulatorImpl::GetSystemId (void) const
+{
+  return m_myId;
+}
+
+uint32_t
+DistributedLocalTimeSimulatorImpl::Fork (uint32_t nVariants, uint32_t nParallel)
+{
+  NS_LOG_FUNCTION (this << nVariants << nParallel);
+  NS_FATAL_ERROR ("DistributedLocalTimeSimulatorImpl::Fork: a forked MPI rank cannot take part in the synchronization of the ranks");
+  return nVariants;
+}
+
+void
+DistributedLocalTimeSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+
+#ifdef NS3_MPI
+  CalculateLookAhead ();
+  PrepareRun ();
+  m_globalFinished = false;
+  while (!m_globalFinished)
+    {
+      Time nextTime = TimeStep (NextTs ());
+
+      // If the next local event is beyond the granted time, or the local task is
+      // finished, synchronize with the other tasks to determine a new time window.
+      if (nextTime > m_grantedTime || IsLocalFinished ())
+        {
+          GrantedTimeWindowMpiInterface::ReceiveMessages ();
+          // The received packets are scheduled with context, insert them before looking at the next event
+          ProcessEventsWithContext ();
+          nextTime = TimeStep (NextTs ());
+          GrantedTimeWindowMpiInterface::TestSendComplete ();
+          LbtsMessage lMsg (GrantedTimeWindowMpiInterface::GetRxCount (), GrantedTimeWindowMpiInterface::GetTxCount (),
+                            m_myId, IsLocalFinished (), nextTime);
+          m_pLBTS[m_myId] = lMsg;
+          MPI_Allgather (&lMsg, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
+                         sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD);
+          Time smallestTime = m_pLBTS[0].GetSmallestTime ();
+          // If totRx != totTx there are messages in transit, the granted time is not updated
+          uint32_t totRx = m_pLBTS[0].GetRxCount ();
+          uint32_t totTx = m_pLBTS[0].GetTxCount ();
+          m_globalFinished = m_pLBTS[0].IsFinished ();
+
+          for (uint32_t i = 1; i < m_systemCount; ++i)
+            {
+              if (m_pLBTS[i].GetSmallestTime () < smallestTime)
+                {
+                  smallestTime = m_pLBTS[i].GetSmallestTime ();
+                }
+              totRx += m_pLBTS[i].GetRxCount ();
+              totTx += m_pLBTS[i].GetTxCount ();
+              m_globalFinished &= m_pLBTS[i].IsFinished ();
+            }
+          if (totRx == totTx)
+            {
+              if (m_lookAhead == GetMaximumSimulationTime ())
+                {
+                  m_grantedTime = GetMaximumSimulationTime ();
+                }
+              else
+                {
+                  m_grantedTime = smallestTime + m_lookAhead;
+                }
+            }
+        }
+
+      // Execute the next event if it is within the current time window
+      if ((nextTime <= m_grantedTime) && (!IsLocalFinished ()))
+        {
+          ProcessOneEvent ();
+        }
+    }
+
+  // If the simulator stopped naturally by lack of events, make a
+  // consistency test to check that we didn't lose any events along the way.
+  NS_ASSERT (!m_events->IsEmpty () || m_unscheduledEvents == 0);
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+} // namespace ns3
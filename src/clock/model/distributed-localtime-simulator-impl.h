@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef DISTRIBUTED_LOCALTIME_SIMULATOR_IMPL_H
+#define DISTRIBUTED_LOCALTIME_SIMULATOR_IMPL_H
+
+#include "ns3/localtime-simulator-impl.h"
+#include "ns3/distributed-simulator-impl.h"
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::DistributedLocalTimeSimulatorImpl declaration.
+ */
+
+namespace ns3{
+
+/**
+ *  \ingroup simulator
+ *  \ingroup mpi
+ * 
+ * @brief Distributed version of LocalTimeSimulatorImpl, with the granted time window synchronization of DistributedSimulatorImpl.
+ * 
+ * Each MPI rank runs the nodes whose system id is its rank. Events are scheduled, converted from local time and rescheduled 
+ * on clock updates exactly as in LocalTimeSimulatorImpl, since Simulator::Schedule () only schedules events of the node of the 
+ * current context, which lives on the same rank.
+ *
+ * Events sent to another rank are packets sent on a remote channel, received with Simulator::ScheduleWithContext () at the global 
+ * time at which the remote device receives them. The lookahead is the smallest delay of the remote channels, in global time, and 
+ * the transmission time only adds to it. Therefore the lookahead does not depend on the clocks of the nodes, and a skewed clock 
+ * cannot make a rank receive an event in its past. The timestamp of the next event, used to compute the granted time window, may 
+ * be the one of an event cancelled by a clock update or not re-timed yet, which is never later than the real next event.
+ *
+ * Set "SimulatorImplementationType" to "ns3::DistributedLocalTimeSimulatorImpl" before MpiInterface::Enable ().
+ */
+class DistributedLocalTimeSimulatorImpl : public LocalTimeSimulatorImpl
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  DistributedLocalTimeSimulatorImpl ();
+  /** Destructor. */
+  ~DistributedLocalTimeSimulatorImpl ();
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Run (void);
+  virtual uint32_t GetSystemId (void) const;
+  /**
+   * \brief Not available: the variants would share the MPI communicator of the rank, and run the
+   * granted time window protocol as a single rank.
+   * \param nVariants Number of variants
+   * \param nParallel Maximum number of variants run at the same time
+   * \return Never returns
+   */
+  virtual uint32_t Fork (uint32_t nVariants, uint32_t nParallel);
+
+  /**
+   * \brief Set a maximum lookahead, used when it is smaller than the delays of the remote channels.
+   * \param lookAhead Maximum lookahead, in global time
+   */
+  void SetMaximumLookAhead (const Time lookAhead);
+
+private:
+  virtual void DoDispose (void);
+  /** Compute the lookahead from the delays of the point to point channels to other ranks. */
+  void CalculateLookAhead (void);
+
+  /** Are all parallel instances completed. */
+  bool m_globalFinished;
+  /** LBTS messages of all the ranks, allocated once the number of ranks is known. */
+  LbtsMessage *m_pLBTS;
+  /** MPI rank. */
+  uint32_t m_myId;
+  /** MPI size. */
+  uint32_t m_systemCount;
+  /** Last LBTS. */
+  Time m_grantedTime;
+  /** Lookahead value. */
+  Time m_lookAhead;
+};
+
+}// namespace ns3
+
+#endif /* DISTRIBUTED_LOCALTIME_SIMULATOR_IMPL_H */
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/hardware-timestamp-tag.h"
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::HardwareTimestampTag implementation.
+ */
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (HardwareTimestampTag);
+
+TypeId
+HardwareTimestampTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::HardwareTimestampTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<HardwareTimestampTag> ()
+  ;
+  return tid;
+}
+
+HardwareTimestampTag::HardwareTimestampTag ()
+  : m_txTs (-1),
+    m_rxTs (-1)
+{
+}
+
+void
+HardwareTimestampTag::SetTxTimestamp (Time timestamp)
+{
+  m_txTs = timestamp.GetTimeStep ();
+}
+
+Time
+HardwareTimestampTag::GetTxTimestamp (void) const
+{
+  return TimeStep (m_txTs);
+}
+
+void
+HardwareTimestampTag::SetRxTimestamp (Time timestamp)
+{
+  m_rxTs = timestamp.GetTimeStep ();
+}
+
+Time
+HardwareTimestampTag::GetRxTimestamp (void) const
+{
+  return TimeStep (m_rxTs);
+}
+
+TypeId
+HardwareTimestampTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+HardwareTimestampTag::GetSerializedSize (void) const
+{
+  return 16;
+}
+
+void
+HardwareTimestampTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_txTs);
+  i.WriteU64 (m_rxTs);
+}
+
+void
+HardwareTimestampTag::Deserialize (TagBuffer i)
+{
+  m_txTs = i.ReadU64 ();
+  m_rxTs = i.ReadU64 ();
+}
+
+void
+HardwareTimestampTag::Print (std::ostream &os) const
+{
+  os << "tx=" << TimeStep (m_txTs) << " rx=" << TimeStep (m_rxTs);
+}
+
+}
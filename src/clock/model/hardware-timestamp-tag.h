@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef HARDWARE_TIMESTAMP_TAG_H
+#define HARDWARE_TIMESTAMP_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/nstime.h"
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::HardwareTimestampTag declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup Clock
+ *
+ * @brief Packet tag holding the timestamps taken by the network devices at the PHY boundary.
+ *
+ * The timestamps are in the local time of the node of the device that took them, as read from its LocalClock, or
+ * in global time if the node has no clock. The transmit timestamp is taken by the sender when the transmission
+ * starts, the receive timestamp by the receiver when the reception ends, so their difference includes the
+ * transmission time of the frame. HardwareTimestampHelper installs the devices that take them.
+ *
+ * The tag has a fixed size and holds no pointer. A timestamp that has not been taken is negative.
+ */
+class HardwareTimestampTag : public Tag
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /** Create a tag without timestamps. */
+  HardwareTimestampTag ();
+
+  /**
+   * \param timestamp Local time at which the transmission of the packet started
+   */
+  void SetTxTimestamp (Time timestamp);
+  /**
+   * \return Local time at which the transmission of the packet started, negative if it has not been taken
+   */
+  Time GetTxTimestamp (void) const;
+  /**
+   * \param timestamp Local time at which the reception of the packet ended
+   */
+  void SetRxTimestamp (Time timestamp);
+  /**
+   * \return Local time at which the reception of the packet ended, negative if it has not been taken
+   */
+  Time GetRxTimestamp (void) const;
+
+  // inherited function, no need to doc.
+  virtual TypeId GetInstanceTypeId (void) const;
+  // inherited function, no need to doc.
+  virtual uint32_t GetSerializedSize (void) const;
+  // inherited function, no need to doc.
+  virtual void Serialize (TagBuffer i) const;
+  // inherited function, no need to doc.
+  virtual void Deserialize (TagBuffer i);
+  // inherited function, no need to doc.
+  virtual void Print (std::ostream &os) const;
+
+private:
+  /** Transmit timestamp in time steps. */
+  int64_t m_txTs;
+  /** Receive timestamp in time steps. */
+  int64_t m_rxTs;
+};
+
+}
+
+#endif /* HARDWARE_TIMESTAMP_TAG_H */
@@ -23,7 +23,12 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include "ns3/pointer.h"
+#include "ns3/trace-source-accessor.h"
 #include "ns3/localtime-simulator-impl.h"
+#include "ns3/node.h"
+#include "ns3/perfect-clock-model-impl.h"
+#include "ns3/abort.h"
+#include <algorithm>
 
 /**
  * \file clock
@@ -36,6 +41,25 @@ NS_LOG_COMPONENT_DEFINE ("LocalClock");
 
 NS_OBJECT_ENSURE_REGISTERED (LocalClock);
 
+/** Smallest size of the event list that triggers the removal of expired events. */
+static const std::size_t MIN_EVENTS_THRESHOLD = 64;
+
+/**
+ * A lazy update leaves the pending events at their old global time until they reach the head of the 
+ * scheduler, so it is only used when the new clock model does not run faster than the old one.
+ * \param oldModel Clock model before the update
+ * \param newModel Clock model after the update
+ * \return true if both models are perfect clocks and the new frequency is not higher
+ */
+static bool
+IsSlowdown (Ptr<ClockModel> oldModel, Ptr<ClockModel> newModel)
+{
+  Ptr<PerfectClockModelImpl> oldPerfect = DynamicCast<PerfectClockModelImpl> (oldModel);
+  Ptr<PerfectClockModelImpl> newPerfect = DynamicCast<PerfectClockModelImpl> (newModel);
+  return oldPerfect != 0 && newPerfect != 0 && oldPerfect != newPerfect
+         && newPerfect->GetFrequency () <= oldPerfect->GetFrequency ();
+}
+
 TypeId
 LocalClock::GetTypeId (void)
 {
@@ -46,21 +70,38 @@ LocalClock::GetTypeId (void)
     .AddAttribute ("ClockModel",
                   "The clock model implementation used to simulate local clock",
                   PointerValue (),
-                  MakePointerAccessor (&LocalClock::m_clock),
+                  MakePointerAccessor (&LocalClock::SetClockModel,
+                                       &LocalClock::GetClockModel),
                   MakePointerChecker<ClockModel> ())
+    .AddTraceSource ("ClockUpdate",
+                     "The clock model has been updated, with the local time before and after the update",
+                     MakeTraceSourceAccessor (&LocalClock::m_clockUpdateTrace),
+                     "ns3::LocalClock::ClockUpdateTracedCallback")
+    .AddTraceSource ("EventRescheduled",
+                     "An event of this clock has been moved to a new global time",
+                     MakeTraceSourceAccessor (&LocalClock::m_eventRescheduledTrace),
+                     "ns3::LocalClock::EventRescheduledTracedCallback")
   ;
   return tid;
 }
 
 LocalClock::LocalClock ()
+  : m_affine (0),
+    m_eventsThreshold (MIN_EVENTS_THRESHOLD),
+    m_firstEpoch (0),
+    m_movedUidBound (0)
 {
   NS_LOG_FUNCTION (this);
 }
 
 LocalClock::LocalClock (Ptr<ClockModel> clock)
+  : m_affine (0),
+    m_eventsThreshold (MIN_EVENTS_THRESHOLD),
+    m_firstEpoch (0),
+    m_movedUidBound (0)
 {
   NS_LOG_FUNCTION (this);
-  m_clock = clock;
+  SetClockModel (clock);
 }
 
 LocalClock::~LocalClock()
@@ -68,6 +109,20 @@ LocalClock::~LocalClock()
   NS_LOG_FUNCTION (this);
 }
 
+void
+LocalClock::SetClockModel (Ptr<ClockModel> model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_clock = model;
+  m_affine = PeekPointer (DynamicCast<PerfectClockModelImpl> (model));
+}
+
+Ptr<ClockModel>
+LocalClock::GetClockModel (void) const
+{
+  return m_clock;
+}
+
 Time 
 LocalClock::GetLocalTime ()
 {
@@ -78,40 +133,181 @@ LocalClock::GetLocalTime ()
 void 
 LocalClock::SetClock (Ptr<ClockModel> newClock)
 {
-    NS_LOG_FUNCTION (this << newClock);
-    Ptr<ClockModel> oldClock = m_clock;
-    m_clock = newClock;
-
-    //First run over the list to remove expire events. 
-
-    for (std::list<EventId>::iterator iter = m_events.begin (); iter != m_events.end ();)
-    { 
-      if ((*iter).IsExpired ())
-      {
-        iter = m_events.erase (iter);    
-      }
-      else
-      {
-        iter++;
-      }
+  NS_LOG_FUNCTION (this << newClock);
+  SetClocks (std::vector<Ptr<LocalClock> > (1, this), std::vector<Ptr<ClockModel> > (1, newClock));
+}
+
+void
+LocalClock::AdjustClock (double frequency, Time offset)
+{
+  NS_LOG_FUNCTION (this << frequency << offset);
+  Adjustment adjustment;
+  adjustment.clock = this;
+  adjustment.frequency = frequency;
+  adjustment.offset = offset;
+  AdjustClocks (std::vector<Adjustment> (1, adjustment));
+}
+
+void
+LocalClock::SetClocks (const std::vector<Ptr<LocalClock> > &clocks, const std::vector<Ptr<ClockModel> > &models)
+{
+  NS_LOG_FUNCTION (clocks.size ());
+  NS_ASSERT_MSG (clocks.size () == models.size (), "A clock model is needed for each clock");
+
+  LocalTimeSimulatorImpl *simImpl = LocalTimeSimulatorImpl::GetCurrent ();
+  if (simImpl == nullptr)
+  {
+    NS_LOG_WARN ("NOT USING THE CORRECT SIMULATOR IMPLEMENTATION");
+    for (std::size_t i = 0; i < clocks.size (); ++i)
+    {
+      Time oldLocalTime = clocks[i]->m_clock->GetLocalTime ();
+      clocks[i]->SetClockModel (models[i]);
+      clocks[i]->m_clockUpdateTrace (oldLocalTime, models[i]->GetLocalTime ());
+    }
+    return;
+  }
+
+  //All the remaining delays are measured before any clock changes
+  bool lazy = simImpl->IsLazyRescheduling ();
+  std::vector<PendingEvents> pending (clocks.size ());
+  std::vector<Time> oldLocalTimes (clocks.size ());
+  for (std::size_t i = 0; i < clocks.size (); ++i)
+  {
+    oldLocalTimes[i] = clocks[i]->m_clock->GetLocalTime ();
+    if (lazy && IsSlowdown (clocks[i]->m_clock, models[i]))
+    {
+      clocks[i]->AddEpoch (simImpl->GetNextUid (), clocks[i]->m_clock);
+    }
+    else
+    {
+      clocks[i]->TakePendingEvents (pending[i]);
+    }
+  }
+  for (std::size_t i = 0; i < clocks.size (); ++i)
+  {
+    clocks[i]->SetClockModel (models[i]);
+  }
+  std::vector<MovedEvents> moved (clocks.size ());
+  for (std::size_t i = 0; i < clocks.size (); ++i)
+  {
+    simImpl->ReSchedule (PeekPointer (clocks[i]), pending[i], moved[i]);
+  }
+  //The sinks may schedule events, once the pending ones are back in uid order
+  for (std::size_t i = 0; i < clocks.size (); ++i)
+  {
+    clocks[i]->m_clockUpdateTrace (oldLocalTimes[i], models[i]->GetLocalTime ());
+    clocks[i]->FireEventRescheduled (moved[i]);
+  }
+}
+
+void
+LocalClock::AdjustClocks (const std::vector<Adjustment> &adjustments)
+{
+  NS_LOG_FUNCTION (adjustments.size ());
+
+  LocalTimeSimulatorImpl *simImpl = LocalTimeSimulatorImpl::GetCurrent ();
+  if (simImpl == nullptr)
+  {
+    NS_LOG_WARN ("NOT USING THE CORRECT SIMULATOR IMPLEMENTATION");
+    for (std::vector<Adjustment>::const_iterator i = adjustments.begin (); i != adjustments.end (); ++i)
+    {
+      Time oldLocalTime = i->clock->m_clock->GetLocalTime ();
+      i->clock->DoAdjustClock (i->frequency, i->offset);
+      i->clock->m_clockUpdateTrace (oldLocalTime, i->clock->m_clock->GetLocalTime ());
     }
+    return;
+  }
 
-    std::list<EventId> eventListAux (m_events);
-    m_events.clear ();
+  //All the remaining delays are measured before any clock changes
+  bool lazy = simImpl->IsLazyRescheduling ();
+  std::vector<PendingEvents> pending (adjustments.size ());
+  std::vector<Time> oldLocalTimes (adjustments.size ());
+  for (std::size_t i = 0; i < adjustments.size (); ++i)
+  {
+    LocalClock *clock = PeekPointer (adjustments[i].clock);
+    oldLocalTimes[i] = clock->m_clock->GetLocalTime ();
+    Ptr<PerfectClockModelImpl> model = DynamicCast<PerfectClockModelImpl> (clock->m_clock);
+    if (lazy && model != 0 && adjustments[i].frequency <= model->GetFrequency ())
+    {
+      //The model is changed in place, the epoch keeps a copy of it
+      Ptr<PerfectClockModelImpl> old = CreateObject<PerfectClockModelImpl> ();
+      old->SetFrequency (model->GetFrequency ());
+      old->SetOffset (model->GetOffset ());
+      clock->AddEpoch (simImpl->GetNextUid (), old);
+    }
+    else
+    {
+      clock->TakePendingEvents (pending[i]);
+    }
+  }
+  for (std::size_t i = 0; i < adjustments.size (); ++i)
+  {
+    LocalClock *clock = PeekPointer (adjustments[i].clock);
+    clock->DoAdjustClock (adjustments[i].frequency, adjustments[i].offset);
+  }
+  std::vector<MovedEvents> moved (adjustments.size ());
+  for (std::size_t i = 0; i < adjustments.size (); ++i)
+  {
+    simImpl->ReSchedule (PeekPointer (adjustments[i].clock), pending[i], moved[i]);
+  }
+  //The sinks may schedule events, once the pending ones are back in uid order
+  for (std::size_t i = 0; i < adjustments.size (); ++i)
+  {
+    LocalClock *clock = PeekPointer (adjustments[i].clock);
+    clock->m_clockUpdateTrace (oldLocalTimes[i], clock->m_clock->GetLocalTime ());
+    clock->FireEventRescheduled (moved[i]);
+  }
+}
 
-    for (std::list<EventId>::iterator iter = eventListAux.begin (); iter != eventListAux.end ();++iter)
+void
+LocalClock::FireEventRescheduled (const MovedEvents &moved)
+{
+  for (MovedEvents::const_iterator i = moved.begin (); i != moved.end (); ++i)
   {
-      Time eventTimeStamp = TimeStep((*iter).GetTs ()); 
-      Ptr<SimulatorImpl> simImpl = Simulator::GetImplementation ();
-      Ptr<LocalTimeSimulatorImpl> mysimImpl= DynamicCast<LocalTimeSimulatorImpl> (simImpl);
+    m_eventRescheduledTrace (i->oldTs, i->newTs);
+  }
+}
 
-      if(mysimImpl == nullptr)
-      {
-        NS_LOG_WARN ("NOT USING THE CORRECT SIMULATOR IMPLEMENTATION");
-      }
-      EventId newID = ReSchedule (eventTimeStamp, (*iter).PeekEventImpl(), oldClock);
-      mysimImpl -> CancelRescheduling (*iter, newID);
+void
+LocalClock::TakePendingEvents (PendingEvents &pending)
+{
+  NS_LOG_FUNCTION (this << m_events.size ());
+  //Only the events that are still live are rescheduled. They are inserted again in m_events by the simulator.
+  LocalTimeSimulatorImpl *simImpl = LocalTimeSimulatorImpl::GetCurrent ();
+  EventList events;
+  events.swap (m_events);
+  Time now = Simulator::Now ();
+  uint32_t nEpochs = m_firstEpoch + m_epochs.size ();
+  pending.reserve (events.size ());
+  for (EventList::const_iterator iter = events.begin (); iter != events.end (); ++iter)
+  {
+    if (simImpl->IsTrackedExpired (iter->id))
+    {
+      continue;
     }
+    Time ts = TimeStep (iter->id.GetTs ());
+    if (iter->epoch < nEpochs)
+    {
+      ts = Max (Replay (iter->epoch, ts), now);
+    }
+    PendingEvent event;
+    event.id = iter->id;
+    event.localDelay = GlobalDelayToLocalDelay (now, ts - now);
+    pending.push_back (event);
+  }
+  m_epochs.clear ();
+  m_firstEpoch = nEpochs;
+  m_eventsThreshold = std::max (MIN_EVENTS_THRESHOLD, 2 * pending.size ());
+}
+
+void
+LocalClock::DoAdjustClock (double frequency, Time offset)
+{
+  NS_LOG_FUNCTION (this << frequency << offset);
+  Ptr<PerfectClockModelImpl> model = DynamicCast<PerfectClockModelImpl> (m_clock);
+  NS_ABORT_MSG_IF (model == 0, "Only a PerfectClockModelImpl can be adjusted in place");
+  model->SetFrequency (frequency);
+  model->SetOffset (offset);
 }
 
 Time 
@@ -132,40 +328,173 @@ Time
 LocalClock::GlobalToLocalDelay (Time globalDelay)
 {
   NS_LOG_FUNCTION (this << globalDelay);
-  return m_clock->GlobalToLocalDelay (globalDelay);
+  return GlobalDelayToLocalDelay (Simulator::Now (), globalDelay);
 }
 
 Time 
 LocalClock::LocalToGlobalDelay (Time localDelay)
 {
   NS_LOG_FUNCTION (this << localDelay);
-  return m_clock->LocalToGlobalDelay (localDelay);
+  return LocalDelayToGlobalDelay (Simulator::Now (), localDelay);
 }
 
 void 
 LocalClock::InsertEvent (EventId event)
 {
-  for (EventList::iterator i = m_events.begin (); i != m_events.end ();)
+  if (m_events.size () >= m_eventsThreshold)
+  {
+    RemoveExpiredEvents ();
+  }
+  ScheduledEvent scheduled;
+  scheduled.id = event;
+  scheduled.epoch = m_firstEpoch + m_epochs.size ();
+  m_events.push_back (scheduled);
+}
+
+void
+LocalClock::NotifyEventMoved (uint32_t uid)
+{
+  m_movedUidBound = std::max (m_movedUidBound, uid + 1);
+}
+
+void
+LocalClock::NotifyEventRescheduled (uint32_t uid, Time oldTs, Time newTs)
+{
+  NotifyEventMoved (uid);
+  m_eventRescheduledTrace (oldTs, newTs);
+}
+
+void
+LocalClock::RemoveExpiredEvents (void)
+{
+  NS_LOG_FUNCTION (this << m_events.size ());
+  //The EventIds of m_events hold the current time of their events, the simulator checks them without any lookup
+  LocalTimeSimulatorImpl *simImpl = LocalTimeSimulatorImpl::GetCurrent ();
+  uint32_t firstEpoch = m_firstEpoch + m_epochs.size ();
+  EventList::iterator last = m_events.begin ();
+  for (EventList::iterator i = m_events.begin (); i != m_events.end (); ++i)
+  {
+    if (!simImpl->IsTrackedExpired (i->id))
+    {
+      firstEpoch = std::min (firstEpoch, i->epoch);
+      *last = *i;
+      ++last;
+    }
+  }
+  m_events.erase (last, m_events.end ());
+  m_eventsThreshold = std::max (MIN_EVENTS_THRESHOLD, 2 * m_events.size ());
+  TrimEpochs (firstEpoch);
+}
+
+std::size_t
+LocalClock::FindLazyEvent (uint32_t uid) const
+{
+  if (m_epochs.empty () || uid >= m_epochs.back ().uid)
+  {
+    return m_events.size ();
+  }
+  //Only the events scheduled through this clock are re-timed
+  std::size_t low = 0;
+  std::size_t high = m_events.size ();
+  while (low < high)
   {
-    if (i->IsExpired ())
+    std::size_t mid = low + (high - low) / 2;
+    if (m_events[mid].id.GetUid () < uid)
     {
-      i = m_events.erase (i);
+      low = mid + 1;
     }
     else
     {
-      ++i;
+      high = mid;
     }
+  }
+  if (low == m_events.size () || m_events[low].id.GetUid () != uid || m_events[low].epoch >= m_firstEpoch + m_epochs.size ())
+  {
+    return m_events.size ();
+  }
+  return low;
+}
+
+bool
+LocalClock::ReTime (uint32_t uid, Time &ts)
+{
+  std::size_t i = FindLazyEvent (uid);
+  if (i == m_events.size ())
+  {
+    return false;
+  }
+  NS_LOG_FUNCTION (this << uid << ts);
+  //Rounding to the time step may make the event due slightly before its old time, it then runs at its old time
+  ScheduledEvent &event = m_events[i];
+  ts = Max (Replay (event.epoch, ts), ts);
+  event.id = EventId (event.id.PeekEventImpl (), ts.GetTimeStep (), event.id.GetContext (), uid);
+  event.epoch = m_firstEpoch + m_epochs.size ();
+  return true;
+}
+
+Time
+LocalClock::PeekReTime (uint32_t uid, Time ts) const
+{
+  std::size_t i = FindLazyEvent (uid);
+  if (i == m_events.size ())
+  {
+    return ts;
+  }
+  return Max (Replay (m_events[i].epoch, ts), ts);
+}
+
+void
+LocalClock::AddEpoch (uint32_t uid, Ptr<ClockModel> model)
+{
+  NS_LOG_FUNCTION (this << uid << model);
+  Epoch epoch;
+  epoch.uid = uid;
+  epoch.time = Simulator::Now ();
+  epoch.model = model;
+  if (m_events.empty ())
+  {
+    TrimEpochs (m_firstEpoch + m_epochs.size ());
+  }
+  m_epochs.push_back (epoch);
+}
 
+Time
+LocalClock::Replay (uint32_t epoch, Time ts) const
+{
+  NS_ASSERT (epoch >= m_firstEpoch);
+  //Same conversions as an eager update at each epoch: keep the remaining local delay
+  for (std::size_t j = epoch - m_firstEpoch; j < m_epochs.size (); ++j)
+  {
+    const Epoch &epoch = m_epochs[j];
+    Ptr<ClockModel> next = j + 1 < m_epochs.size () ? m_epochs[j + 1].model : m_clock;
+    Time localDelay = epoch.model->GlobalDelayToLocalDelay (epoch.time, Max (ts - epoch.time, Time (0)));
+    ts = epoch.time + next->LocalDelayToGlobalDelay (epoch.time, localDelay);
   }
-  m_events.push_back (event);
+  return ts;
 }
 
-EventId 
-LocalClock::ReSchedule (Time globalTimeStamp, EventImpl *impl, Ptr<ClockModel> oldclock)
+void
+LocalClock::TrimEpochs (uint32_t first)
 {
-  NS_LOG_FUNCTION (this << globalTimeStamp << impl);
-  Time globalOldDurationRemain = globalTimeStamp - Simulator::Now ();
-  Time localOldDurationRemain = oldclock->GlobalToLocalDelay (globalOldDurationRemain);
-  return Simulator::Schedule (localOldDurationRemain, impl);
+  NS_ASSERT (first >= m_firstEpoch && first <= m_firstEpoch + m_epochs.size ());
+  m_epochs.erase (m_epochs.begin (), m_epochs.begin () + (first - m_firstEpoch));
+  m_firstEpoch = first;
 }
+
+void
+LocalClock::NotifyNewAggregate (void)
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<Node> node = GetObject<Node> ();
+  if (node != 0)
+  {
+    LocalTimeSimulatorImpl *simImpl = LocalTimeSimulatorImpl::GetCurrent ();
+    if (simImpl != 0)
+    {
+      simImpl -> SetNodeClock (node -> GetId (), this);
+    }
+  }
+  Object::NotifyNewAggregate ();
+}
+
 }//namespace ns3
\ No newline at end of file
@@ -23,10 +23,14 @@
 #include "ns3/object.h"
 #include "ns3/object-factory.h"
 #include "ns3/clock-model.h"
+#include "ns3/perfect-clock-model-impl.h"
 #include "ns3/scheduler.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "ns3/simulator.h"
+#include <vector>
 namespace ns3 {
 /**
  * \file
@@ -71,6 +75,12 @@ public:
    */
 
   Time GetLocalTime ();
+  /**
+   * \brief Same as GetLocalTime (), without logging and inline for a PerfectClockModelImpl, for the timestamps
+   * taken on every packet.
+   * \return Node time
+   */
+  Time GetTimestamp (void) const;
   /**
    * \brief associate a clock model implementation to the clock of the node.
    * This function is going to be called every time a change on the node clock happens 
@@ -79,6 +89,80 @@ public:
    * \param ClockModel associate to this node.
    */
   void SetClock (Ptr<ClockModel> new_clock_model);
+  /**
+   * \brief Change the frequency and the offset of the clock model in place, so that LT = f*GT + offset.
+   * No new ClockModel is created, the pending events are rescheduled as in SetClock ().
+   * The clock model must be a PerfectClockModelImpl.
+   * \param frequency New frequency of the clock
+   * \param offset New offset of the clock
+   */
+  void AdjustClock (double frequency, Time offset);
+
+  /** In-place update of one clock, applied by AdjustClocks (). */
+  struct Adjustment
+  {
+    /** The clock to update, its model must be a PerfectClockModelImpl. */
+    Ptr<LocalClock> clock;
+    /** New frequency of the clock. */
+    double frequency;
+    /** New offset of the clock. */
+    Time offset;
+  };
+  /**
+   * \brief Update several clocks at the same instant, i.e. a synchronization round.
+   * The remaining local delays of all the pending events are computed with the models before the update,
+   * then all the models are updated, then all the events are rescheduled in a single pass on the scheduler.
+   * \param clocks Clocks to update
+   * \param models New clock model of each clock, in the same order
+   */
+  static void SetClocks (const std::vector<Ptr<LocalClock> > &clocks, const std::vector<Ptr<ClockModel> > &models);
+  /**
+   * \brief Same as SetClocks (), with the models of the clocks changed in place as in AdjustClock ().
+   * \param adjustments Update of each clock
+   */
+  static void AdjustClocks (const std::vector<Adjustment> &adjustments);
+
+  /** Event waiting to be rescheduled after a clock update. */
+  struct PendingEvent
+  {
+    /** The event, as scheduled before the update. */
+    EventId id;
+    /** Local delay left before the event, measured with the clock model before the update. */
+    Time localDelay;
+  };
+  /** Container type for the events to reschedule after a clock update. */
+  typedef std::vector<PendingEvent> PendingEvents;
+  /** Event moved to a new global time by a clock update, traced once every clock of the update is rescheduled. */
+  struct MovedEvent
+  {
+    /** Global time of the event before the update. */
+    Time oldTs;
+    /** Global time of the event after the update. */
+    Time newTs;
+  };
+  /** Container type for the events moved by a clock update. */
+  typedef std::vector<MovedEvent> MovedEvents;
+
+  /**
+   * \brief Called by LocalTimeSimulatorImpl, with lazy rescheduling, when an event of the node reaches the head of the scheduler.
+   * If the event was scheduled by this clock before a lazy update, compute the global time at which it is due with the 
+   * current clock model, as the updates would have done it if they had rescheduled the event.
+   * 
+   * The event keeps its uid, the simulator moves its scheduler entry if its global time has changed.
+   * 
+   * \param uid Uid of the event
+   * \param ts Global time of the event in the scheduler, receives the global time under the current clock model, never before it
+   * \return true if the event has been re-timed
+   */
+  bool ReTime (uint32_t uid, Time &ts);
+  /**
+   * \brief Same as ReTime (), without re-timing the event.
+   * 
+   * \param uid Uid of the event
+   * \param ts Global time of the event in the scheduler
+   * \return Global time of the event under the current clock model, \p ts if the event is not left behind by a lazy update
+   */
+  Time PeekReTime (uint32_t uid, Time ts) const;
 
   /**
    * \brief Transform Time from Global (simulator time) to Local(Local Node Time).
@@ -106,36 +190,208 @@ public:
    * \return Global Absolute Time  
    */
   Time LocalToGlobalDelay (Time localDelay);
+  /**
+   * \brief Translate a global delay, counted from \p globalTime, into a local delay.
+   * The conversion is done inline for a PerfectClockModelImpl, and by the clock model otherwise.
+   * \param globalTime Global time at which the delay starts
+   * \param globalDelay Delay in global time
+   * \return Delay in local time
+   */
+  Time GlobalDelayToLocalDelay (Time globalTime, Time globalDelay);
+  /**
+   * \brief Translate a local delay, counted from \p globalTime, into a global delay. LocalTimeSimulatorImpl calls this
+   * for every event scheduled by the node, with the current time it already knows.
+   * The conversion is done inline for a PerfectClockModelImpl, and by the clock model otherwise.
+   * \param globalTime Global time at which the delay starts
+   * \param localDelay Delay in local time
+   * \return Delay in global time, never negative
+   */
+  Time LocalDelayToGlobalDelay (Time globalTime, Time localDelay);
   
   /**
    * \brief Insert a event in m_events to keep track of the events scheduled by this node.  
+   * Expired events are removed lazily, once the list has doubled since the last removal, 
+   * so that the insertion is amortized O(1).
    * \param event EventId to be inserted
    */
   void InsertEvent (EventId event);
   /**
-   * Return true if SetClock function has been called.
+   * \brief Called by LocalTimeSimulatorImpl when an event of this clock is moved to a new global time. The event keeps its uid.
+   * The EventRescheduled trace is fired by the caller, once the pending events of the node are tracked again.
+   * \param uid Uid of the event
+   */
+  void NotifyEventMoved (uint32_t uid);
+  /**
+   * \brief Called by LocalTimeSimulatorImpl when ReTime () moves an event of this clock to a new global time.
+   * Same as NotifyEventMoved (), and fire the EventRescheduled trace.
+   * \param uid Uid of the event
+   * \param oldTs Global time of the event before it was moved
+   * \param newTs Global time of the event after it was moved
    */
+  void NotifyEventRescheduled (uint32_t uid, Time oldTs, Time newTs);
+  /**
+   * \return Bound on the uids of the events of this clock that have been moved: the events with a greater or 
+   * equal uid are still due at the global time they were scheduled at
+   */
+  uint32_t GetMovedUidBound (void) const;
+
+  /**
+   * TracedCallback signature for the update of the clock model.
+   *
+   * \param [in] oldLocalTime Local time at the update, with the clock model before the update
+   * \param [in] newLocalTime Local time at the update, with the clock model after the update
+   */
+  typedef void (* ClockUpdateTracedCallback)(Time oldLocalTime, Time newLocalTime);
+  /**
+   * TracedCallback signature for an event moved by a clock update.
+   *
+   * \param [in] oldTs Global time of the event before it was moved
+   * \param [in] newTs Global time of the event after it was moved
+   */
+  typedef void (* EventRescheduledTracedCallback)(Time oldTs, Time newTs);
   
+protected:
+  /**
+   * \brief Register this clock in the clock table of LocalTimeSimulatorImpl when it is aggregated to a node.
+   */
+  virtual void NotifyNewAggregate (void);
+
 private:
-  
   /**
-   * \brief ReSchedule an Event in the main simulator. This function calculate the remaining 
-   * time for the event to be executed and reschedule the event.
+   * \brief Set the clock model, and the affine fast path if it is a PerfectClockModelImpl.
+   * \param model The clock model
+   */
+  void SetClockModel (Ptr<ClockModel> model);
+  /**
+   * \return The clock model
+   */
+  Ptr<ClockModel> GetClockModel (void) const;
+
+  /**
+   * \brief Move the live events of the node to \p pending, with the local time that remains before each of them. 
+   * This must be called before the clock model is updated.
    * 
-   * \param globalTimeStamp globaltime of the vent to be rechedule
-   * \param impl Event implementation
-   * \param oldClock Clock before the update 
+   * \param pending Container that receives the events
+   */
+  void TakePendingEvents (PendingEvents &pending);
+  /**
+   * \brief Fire the EventRescheduled trace for the events moved by a clock update.
+   * \param moved The events moved by the update, in uid order
+   */
+  void FireEventRescheduled (const MovedEvents &moved);
+  /**
+   * \brief Change the frequency and offset of the clock model in place, without rescheduling.
+   * \param frequency New frequency of the clock
+   * \param offset New offset of the clock
+   */
+  void DoAdjustClock (double frequency, Time offset);
+  /**
+   * \brief Record a lazy update, the pending events are left in the scheduler and re-timed by ReTime ().
+   * \param uid Uid of the next event, the events scheduled before the update have a smaller uid
+   * \param model Clock model before the update, it must not change afterwards
+   */
+  void AddEpoch (uint32_t uid, Ptr<ClockModel> model);
+  /**
+   * \param uid Uid of an event
+   * \return Index of the event in m_events if it has been timed before some lazy updates, the size of m_events otherwise
    */
-  EventId ReSchedule (Time globalTimeStamp, EventImpl *impl, Ptr<ClockModel> oldClock);
+  std::size_t FindLazyEvent (uint32_t uid) const;
+  /**
+   * \brief Compute the global time of an event timed before some lazy updates, under the current clock model.
+   * \param epoch Index of the first lazy update that applies to the event
+   * \param ts Global time of the event when it was last timed
+   * \return Global time of the event
+   */
+  Time Replay (uint32_t epoch, Time ts) const;
+  /**
+   * \brief Forget the lazy updates that apply to none of the events tracked in m_events.
+   * \param first Index of the first lazy update to keep
+   */
+  void TrimEpochs (uint32_t first);
+
+  /**
+   * \brief Remove the expired events from m_events and set the size of the list that triggers the next removal.
+   */
+  void RemoveExpiredEvents (void);
 
   //Clock implementation for the local clock
   Ptr<ClockModel> m_clock;  
-  typedef std::list<EventId> EventList;
-  //List of events schedulled by this node.           
+  //m_clock if it is a PerfectClockModelImpl, whose conversions are then called without virtual dispatch, 0 otherwise
+  PerfectClockModelImpl *m_affine;
+  /** Event scheduled by this node. */
+  struct ScheduledEvent
+  {
+    /** The event, with its current global time. */
+    EventId id;
+    /** Index of the first lazy update that applies to the event, i.e. the number of lazy updates recorded when it was last timed. */
+    uint32_t epoch;
+  };
+  typedef std::vector<ScheduledEvent> EventList;
+  //List of events schedulled by this node, may contain expired events. It is sorted by uid, since events are only appended
+  //and keep their uid when they are moved.
   EventList m_events;      
+  //Size of m_events that triggers the next removal of expired events
+  std::size_t m_eventsThreshold;
+  /** Clock update that has not been applied to the pending events yet. */
+  struct Epoch
+  {
+    /** Uid of the first event scheduled after the update. */
+    uint32_t uid;
+    /** Global time of the update. */
+    Time time;
+    /** Clock model before the update. */
+    Ptr<ClockModel> model;
+  };
+  //Lazy updates, oldest first
+  std::vector<Epoch> m_epochs;
+  //Index of the first lazy update kept in m_epochs
+  uint32_t m_firstEpoch;
+  //One more than the largest uid of the events of this clock that have been moved
+  uint32_t m_movedUidBound;
+
+  /** Trace source fired when the clock model is updated. */
+  TracedCallback<Time, Time> m_clockUpdateTrace;
+  /** Trace source fired when an event of this clock is moved to a new global time. */
+  TracedCallback<Time, Time> m_eventRescheduledTrace;
   
 };
 
+inline Time
+LocalClock::GlobalDelayToLocalDelay (Time globalTime, Time globalDelay)
+{
+  if (m_affine != 0)
+  {
+    return TimeStep (m_affine->GlobalDelayToLocalDelayTs (globalTime.GetTimeStep (), globalDelay.GetTimeStep ()));
+  }
+  return m_clock->GlobalDelayToLocalDelay (globalTime, globalDelay);
+}
+
+inline Time
+LocalClock::LocalDelayToGlobalDelay (Time globalTime, Time localDelay)
+{
+  if (m_affine != 0)
+  {
+    return TimeStep (m_affine->LocalDelayToGlobalDelayTs (globalTime.GetTimeStep (), localDelay.GetTimeStep ()));
+  }
+  return m_clock->LocalDelayToGlobalDelay (globalTime, localDelay);
+}
+
+inline Time
+LocalClock::GetTimestamp (void) const
+{
+  if (m_affine != 0)
+  {
+    return TimeStep (m_affine->GlobalToLocalTs (Simulator::Now ().GetTimeStep ()));
+  }
+  return m_clock->GetLocalTime ();
+}
+
+inline uint32_t
+LocalClock::GetMovedUidBound (void) const
+{
+  return m_movedUidBound;
+}
+
 }// namespace ns3
 
 #endif /* LOCAL_CLOCK_H */
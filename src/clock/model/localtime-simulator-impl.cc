@@ -20,8 +20,8 @@
 
 
 #include "localtime-simulator-impl.h"
-#include "perfect-clock-model-impl.h"
 #include "ns3/double.h"
+#include "ns3/boolean.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
 #include "ns3/ptr.h"
@@ -29,6 +29,14 @@
 #include "ns3/assert.h"
 #include "ns3/node-list.h"
 #include "ns3/node.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
 
 
    
@@ -45,6 +53,9 @@ NS_LOG_COMPONENT_DEFINE ("LocalTimeSimulatorImpl");
 
 NS_OBJECT_ENSURE_REGISTERED (LocalTimeSimulatorImpl);
 
+/** The LocalTimeSimulatorImpl that runs the events of the calling thread, when it is not the simulator implementation. */
+static thread_local LocalTimeSimulatorImpl *g_current = 0;
+
 TypeId
 LocalTimeSimulatorImpl::GetTypeId (void)
 {
@@ -52,6 +63,12 @@ LocalTimeSimulatorImpl::GetTypeId (void)
     .SetParent<DefaultSimulatorImpl> ()
     .SetGroupName ("Core")
     .AddConstructor<LocalTimeSimulatorImpl> ()
+    .AddAttribute ("LazyRescheduling",
+                   "When the clock of a node is slowed down, leave its pending events in the scheduler "
+                   "and re-time them when they reach its head, instead of rescheduling them all at once.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LocalTimeSimulatorImpl::m_lazyRescheduling),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -73,6 +90,9 @@ LocalTimeSimulatorImpl::LocalTimeSimulatorImpl()
   m_unscheduledEvents = 0;
   m_eventCount = 0;
   m_eventsWithContextEmpty = true;
+  m_tombstoneSweepThreshold = 1024;
+  m_lazyRescheduling = false;
+  m_nFailedVariants = 0;
   m_main = SystemThread::Self();
 }
 
@@ -94,6 +114,7 @@ LocalTimeSimulatorImpl::DoDispose (void)
       next.impl->Unref ();
     }
   m_events = 0;
+  m_clocks.clear ();
   SimulatorImpl::DoDispose ();
 }
 void
@@ -143,21 +164,23 @@ LocalTimeSimulatorImpl::ProcessOneEvent (void)
 
   Scheduler::Event next = m_events->RemoveNext ();
 
-  //Do not process events that have been cancelled by a node due to clock update
-  CancelEventsMap::iterator it = m_cancelEventMap.begin();
-  while(it != m_cancelEventMap.end ())
-  {
-    if (it->first == next.key.m_uid)
+  //Events left behind by a lazy clock update are re-timed with the current clock of their node
+  if (m_lazyRescheduling && next.key.m_context != Simulator::NO_CONTEXT && !next.impl->IsCancelled ())
     {
-      m_unscheduledEvents--;
-      if (it->second.GetTs () < m_currentTs)
-      {
-        m_cancelEventMap.erase (it);
-      }
-      return;
+      LocalClock *clock = GetClock (next.key.m_context);
+      Time ts = TimeStep (next.key.m_ts);
+      if (clock != 0 && clock -> ReTime (next.key.m_uid, ts) && ts.GetTimeStep () != (int64_t) next.key.m_ts)
+        {
+          //The event keeps its uid, and the new scheduler entry takes over the reference of the old one
+          Scheduler::Event ev = next;
+          ev.key.m_ts = ts.GetTimeStep ();
+          m_events->Insert (ev);
+          NS_LOG_DEBUG("RETIME EVENT " << next.key.m_uid);
+          RecordMove (next.key.m_uid, next.key.m_ts, ev.key.m_ts);
+          clock -> NotifyEventRescheduled (next.key.m_uid, TimeStep (next.key.m_ts), ts);
+          return;
+        }
     }
-    it++;
-  }
 
   NS_ASSERT (next.key.m_ts >= m_currentTs);
   m_unscheduledEvents--;
@@ -223,10 +246,7 @@ void
 LocalTimeSimulatorImpl::Run (void)
 {
   NS_LOG_FUNCTION (this);
-  // Set the current threadId as the main threadId
-  m_main = SystemThread::Self();
-  ProcessEventsWithContext ();
-  m_stop = false;
+  PrepareRun ();
 
   while (!m_events->IsEmpty () && !m_stop) 
     {
@@ -237,6 +257,38 @@ LocalTimeSimulatorImpl::Run (void)
   NS_ASSERT (!m_events->IsEmpty () || m_unscheduledEvents == 0);
 }
 
+void
+LocalTimeSimulatorImpl::PrepareRun (void)
+{
+  // Set the current threadId as the main threadId
+  m_main = SystemThread::Self();
+  ProcessEventsWithContext ();
+  m_stop = false;
+
+  //Fill the clock table with the nodes created so far
+  m_clocks.clear ();
+  for (uint32_t i = 0; i < NodeList::GetNNodes (); ++i)
+  {
+    m_clocks.push_back (NodeList::GetNode (i) -> GetObject<LocalClock> ());
+  }
+}
+
+bool
+LocalTimeSimulatorImpl::IsLocalFinished (void) const
+{
+  return m_events->IsEmpty () || m_stop;
+}
+
+uint64_t
+LocalTimeSimulatorImpl::NextTs (void) const
+{
+  if (IsLocalFinished ())
+    {
+      return GetMaximumSimulationTime ().GetTimeStep ();
+    }
+  return m_events->PeekNext ().key.m_ts;
+}
+
 void 
 LocalTimeSimulatorImpl::Stop (void)
 {
@@ -256,47 +308,148 @@ LocalTimeSimulatorImpl::Schedule (Time const &localDelay, EventImpl *event)
 {
   NS_LOG_INFO (this << localDelay.GetTimeStep () << event);
   NS_ASSERT_MSG (SystemThread::Equals (m_main), "Simulator::Schedule Thread-unsafe invocation!");
-  Time tAbsolute;
 
-  //Avoid context that do not correspond to any node
-  if ( m_currentContext == uint32_t(4294967295))                                                                                                
+  LocalClock *clock = GetClock (m_currentContext);
+  if (clock == 0)
   {
-    tAbsolute = CalculateAbsoluteTime (localDelay);
-  }
-  else
-  {                           
-    // Obtain nodes clock from the context
-    Ptr <Node>  n = NodeList::GetNode (m_currentContext);
-    Ptr <LocalClock> clock = n -> GetObject <LocalClock> ();
-    if (clock == nullptr)
-    {
-      //If there is no clock attach we create a perfectClock (localTime = globalTime)
-      Ptr<PerfectClockModelImpl> perfectClock = CreateObject<PerfectClockModelImpl> ();
-      clock = CreateObject<LocalClock> ();
-      clock -> SetAttribute ("ClockModel", PointerValue (perfectClock));
-      n -> AggregateObject (clock);
-    }
-    Time globalTimeDelay = clock -> LocalToGlobalDelay (localDelay);
-    tAbsolute = CalculateAbsoluteTime (globalTimeDelay);
-    //Insert eventId in the list of scheduled events by the node.
-    EventId eventId = EventId(event, tAbsolute.GetTimeStep (), GetContext (), m_uid);
-    Time localTimeStamp = clock -> GetLocalTime () + localDelay;
-    clock -> InsertEvent (eventId);
+    //Nodes without clock and contexts that do not correspond to any node run on global time
+    Scheduler::Event ev = InsertScheduler (event, CalculateAbsoluteTime (localDelay), m_currentContext);
+    return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
   }
 
-  Scheduler::Event ev = InsertScheduler (event,tAbsolute);
+  Time globalTimeDelay = clock -> LocalDelayToGlobalDelay (TimeStep (m_currentTs), localDelay);
+  Scheduler::Event ev = InsertScheduler (event, CalculateAbsoluteTime (globalTimeDelay), m_currentContext);
   EventId eventId = EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+  //Insert eventId in the list of scheduled events by the node.
+  clock -> InsertEvent (eventId);
   NS_LOG_DEBUG("SCHEDULE EVENT  " << eventId.GetUid ());
   return eventId;
 }
 
+LocalTimeSimulatorImpl *
+LocalTimeSimulatorImpl::GetCurrent (void)
+{
+  if (g_current != 0)
+    {
+      return g_current;
+    }
+  return PeekPointer (DynamicCast<LocalTimeSimulatorImpl> (Simulator::GetImplementation ()));
+}
+
+void
+LocalTimeSimulatorImpl::SetCurrent (LocalTimeSimulatorImpl *impl)
+{
+  g_current = impl;
+}
+
+LocalClock *
+LocalTimeSimulatorImpl::GetClock (uint32_t context)
+{
+  if (context < m_clocks.size ())
+  {
+    return PeekPointer (m_clocks[context]);
+  }
+  //Cache miss: the node has been created after the last lookup
+  if (context >= NodeList::GetNNodes ())
+  {
+    return 0;
+  }
+  for (uint32_t i = m_clocks.size (); i <= context; ++i)
+  {
+    m_clocks.push_back (NodeList::GetNode (i) -> GetObject<LocalClock> ());
+  }
+  return PeekPointer (m_clocks[context]);
+}
+
+void
+LocalTimeSimulatorImpl::SetNodeClock (uint32_t context, Ptr<LocalClock> clock)
+{
+  NS_LOG_FUNCTION (this << context << clock);
+  if (context >= m_clocks.size ())
+  {
+    m_clocks.resize (context + 1);
+  }
+  m_clocks[context] = clock;
+}
+
+void
+LocalTimeSimulatorImpl::ReserveClocks (uint32_t nContexts)
+{
+  NS_LOG_FUNCTION (this << nContexts);
+  m_clocks.reserve (nContexts);
+}
+
+void
+LocalTimeSimulatorImpl::RecordMove (uint32_t uid, uint64_t oldTs, uint64_t ts)
+{
+  std::pair<MovedEventsMap::iterator, bool> result = m_movedEvents.insert (std::make_pair (uid, Tombstone ()));
+  Tombstone &tombstone = result.first->second;
+  tombstone.lastTs = std::max (result.second ? oldTs : tombstone.lastTs, ts);
+  tombstone.ts = ts;
+  if (result.second)
+    {
+      CollectTombstones ();
+    }
+}
+
+void
+LocalTimeSimulatorImpl::CollectTombstones (void)
+{
+  if (m_movedEvents.size () < m_tombstoneSweepThreshold)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this << m_movedEvents.size ());
+
+  //A tombstone is only kept to give its current time to the EventIds handed out before the event moved.
+  //Once all the times the event has had are in the past, the plain check of these EventIds gives the same answer.
+  for (MovedEventsMap::iterator it = m_movedEvents.begin (); it != m_movedEvents.end (); )
+    {
+      if (it->second.lastTs < m_currentTs)
+        {
+          it = m_movedEvents.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+  m_tombstoneSweepThreshold = std::max<std::size_t> (1024, 2 * m_movedEvents.size ());
+}
+
+uint64_t
+LocalTimeSimulatorImpl::GetCurrentTs (const EventId &id) const
+{
+  if (m_movedEvents.empty ())
+    {
+      return id.GetTs ();
+    }
+  //Only the events of a node older than its last moved event may have moved, the others skip the lookup
+  uint32_t context = id.GetContext ();
+  if (context >= m_clocks.size () || m_clocks[context] == 0 || id.GetUid () >= m_clocks[context] -> GetMovedUidBound ())
+    {
+      return id.GetTs ();
+    }
+  MovedEventsMap::const_iterator it = m_movedEvents.find (id.GetUid ());
+  return it != m_movedEvents.end () ? it->second.ts : id.GetTs ();
+}
+
+bool
+LocalTimeSimulatorImpl::IsExpiredAt (const EventId &id, uint64_t ts) const
+{
+  return id.PeekEventImpl () == 0 ||
+         ts < m_currentTs ||
+         (ts == m_currentTs && id.GetUid () <= m_currentUid) ||
+         id.PeekEventImpl ()->IsCancelled ();
+}
+
 Scheduler::Event 
-LocalTimeSimulatorImpl::InsertScheduler (EventImpl *event, Time tAbsolute)
+LocalTimeSimulatorImpl::InsertScheduler (EventImpl *event, Time tAbsolute, uint32_t context)
 {
   Scheduler::Event ev;
   ev.impl = event;
   ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
-  ev.key.m_context = GetContext ();
+  ev.key.m_context = context;
   ev.key.m_uid = m_uid;
   m_uid++;
   m_unscheduledEvents++;
@@ -374,15 +527,32 @@ LocalTimeSimulatorImpl::Now (void) const
 
 Time 
 LocalTimeSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  Time delay = GetGlobalDelayLeft (id);
+  uint32_t context = id.GetContext ();
+  if (delay.IsZero () || context >= m_clocks.size () || m_clocks[context] == 0)
+    {
+      return delay;
+    }
+  //Measured by the clock of the node that runs the event, as the delay it was scheduled with
+  return m_clocks[context] -> GlobalDelayToLocalDelay (TimeStep (m_currentTs), delay);
+}
+
+Time
+LocalTimeSimulatorImpl::GetGlobalDelayLeft (const EventId &id) const
 {
   if (IsExpired (id))
     {
       return TimeStep (0);
     }
-  else
+  Time ts = TimeStep (GetCurrentTs (id));
+  uint32_t context = id.GetContext ();
+  if (m_lazyRescheduling && context < m_clocks.size () && m_clocks[context] != 0)
     {
-      return TimeStep (id.GetTs () - m_currentTs);
+      //An event left behind by a lazy clock update is due later than its scheduler entry
+      ts = m_clocks[context] -> PeekReTime (id.GetUid (), ts);
     }
+  return ts - TimeStep (m_currentTs);
 }
 
 void
@@ -401,13 +571,15 @@ LocalTimeSimulatorImpl::Remove (const EventId &id)
         }
       return;
     }
-  if (IsExpired (id))
+  //The event may have been moved by a clock update since the EventId was handed out
+  uint64_t ts = GetCurrentTs (id);
+  if (IsExpiredAt (id, ts))
     {
       return;
     }
   Scheduler::Event event;
   event.impl = id.PeekEventImpl ();
-  event.key.m_ts = id.GetTs ();
+  event.key.m_ts = ts;
   event.key.m_context = id.GetContext ();
   event.key.m_uid = id.GetUid ();
   m_events->Remove (event);
@@ -415,6 +587,10 @@ LocalTimeSimulatorImpl::Remove (const EventId &id)
   // whenever we remove an event from the event list, we have to unref it.
   event.impl->Unref ();
   m_unscheduledEvents--;
+  if (ts != id.GetTs ())
+    {
+      m_movedEvents.erase (id.GetUid ());
+    }
 }
 
 void 
@@ -428,16 +604,126 @@ LocalTimeSimulatorImpl::Cancel (const EventId &id)
 }
 
 void
-LocalTimeSimulatorImpl::CancelRescheduling (const EventId &id, const EventId &newId)
+LocalTimeSimulatorImpl::ReSchedule (LocalClock *clock, const LocalClock::PendingEvents &events, LocalClock::MovedEvents &moved)
 {
-  NS_LOG_FUNCTION (this);
-  if (!IsExpired (id))
+  NS_LOG_FUNCTION (this << clock << events.size ());
+  for (LocalClock::PendingEvents::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      const EventId &id = i->id;
+      Time globalTimeDelay = clock -> LocalDelayToGlobalDelay (TimeStep (m_currentTs), i->localDelay);
+      uint64_t ts = CalculateAbsoluteTime (globalTimeDelay).GetTimeStep ();
+      //The event keeps its uid, so it cannot be moved before the event being executed
+      if (ts == m_currentTs && id.GetUid () <= m_currentUid)
+        {
+          ts++;
+        }
+      if (ts != id.GetTs ())
+        {
+          //The scheduler entry is moved with its reference, the EventIds of the event stay valid
+          NS_LOG_DEBUG("RESCHEDULE EVENT " << id.GetUid ());
+          Scheduler::Event ev;
+          ev.impl = id.PeekEventImpl ();
+          ev.key.m_ts = id.GetTs ();
+          ev.key.m_context = id.GetContext ();
+          ev.key.m_uid = id.GetUid ();
+          m_events->Remove (ev);
+          ev.key.m_ts = ts;
+          m_events->Insert (ev);
+          RecordMove (id.GetUid (), id.GetTs (), ts);
+          clock -> InsertEvent (EventId (ev.impl, ts, ev.key.m_context, ev.key.m_uid));
+          clock -> NotifyEventMoved (id.GetUid ());
+          LocalClock::MovedEvent move;
+          move.oldTs = TimeStep (id.GetTs ());
+          move.newTs = TimeStep (ts);
+          moved.push_back (move);
+        }
+      else
+        {
+          clock -> InsertEvent (id);
+        }
+    }
+}
+
+std::size_t
+LocalTimeSimulatorImpl::GetTombstoneCount (void) const
+{
+  return m_movedEvents.size ();
+}
+
+bool
+LocalTimeSimulatorImpl::IsLazyRescheduling (void) const
+{
+  return m_lazyRescheduling;
+}
+
+uint32_t
+LocalTimeSimulatorImpl::GetNextUid (void) const
+{
+  return m_uid;
+}
+
+uint32_t
+LocalTimeSimulatorImpl::Fork (uint32_t nVariants, uint32_t nParallel)
+{
+  NS_LOG_FUNCTION (this << nVariants << nParallel);
+  NS_ASSERT_MSG (SystemThread::Equals (m_main), "LocalTimeSimulatorImpl::Fork Thread-unsafe invocation!");
+  NS_ABORT_MSG_IF (nParallel == 0, "LocalTimeSimulatorImpl::Fork needs to run at least one variant at a time");
+
+  //The events handed over by other threads are part of the checkpoint, and the output
+  //buffered so far must not be written again by each variant
+  ProcessEventsWithContext ();
+  std::cout.flush ();
+  std::cerr.flush ();
+  std::fflush (0);
+
+  m_nFailedVariants = 0;
+  std::vector<pid_t> variants;
+  for (uint32_t variant = 0; variant < nVariants; ++variant)
+    {
+      if (variants.size () == nParallel)
+        {
+          WaitVariant (variants);
+        }
+      pid_t pid = fork ();
+      NS_ABORT_MSG_IF (pid < 0, "LocalTimeSimulatorImpl::Fork: fork failed: " << std::strerror (errno));
+      if (pid == 0)
+        {
+          NS_LOG_DEBUG ("Variant " << variant << " forked");
+          return variant;
+        }
+      variants.push_back (pid);
+    }
+  while (!variants.empty ())
+    {
+      WaitVariant (variants);
+    }
+  return nVariants;
+}
+
+void
+LocalTimeSimulatorImpl::WaitVariant (std::vector<pid_t> &variants)
+{
+  //The variants are waited for in the order they were forked, the other children of the process are left alone
+  pid_t pid = variants.front ();
+  variants.erase (variants.begin ());
+  int status;
+  while (waitpid (pid, &status, 0) < 0)
+    {
+      NS_ABORT_MSG_IF (errno != EINTR, "LocalTimeSimulatorImpl::Fork: waitpid failed: " << std::strerror (errno));
+    }
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
     {
-      NS_LOG_DEBUG("CANCEL DUE TO RESCHEDULING EVENT " << id.GetUid ());
-      m_cancelEventMap.insert (std::make_pair (id.GetUid (), newId));
+      NS_LOG_WARN ("Variant process " << pid << " failed with status " << status);
+      m_nFailedVariants++;
     }
 }
 
+uint32_t
+LocalTimeSimulatorImpl::GetNFailedVariants (void) const
+{
+  return m_nFailedVariants;
+}
+
 bool
 LocalTimeSimulatorImpl::IsExpired (const EventId &id) const
 {
@@ -460,37 +746,14 @@ LocalTimeSimulatorImpl::IsExpired (const EventId &id) const
       return true;
     }
 
-  //Check the maping between events to ensure that events are expired. Event1 has been reschedule with the same implbut different time  Event2.
-  //When as for Event1 (that is been "cancacelled") need to know if Event2 is cancel. 
+  //An event moved by a clock update keeps its uid, the EventId may hold the time it had before
+  return IsExpiredAt (id, GetCurrentTs (id));
+}
 
-  CancelEventsMap::const_iterator it = m_cancelEventMap.begin();
-  while (it != m_cancelEventMap.end ())
-  {
-    if (it ->first == id.GetUid ())
-    {
-      if (!it->second.IsExpired ())
-      {
-        return false;
-      }
-      else
-      {
-        return true;
-      }   
-    }
-    it++;
-  }
-  if (id.PeekEventImpl () == 0 ||
-      id.GetTs () < m_currentTs ||
-      (id.GetTs () == m_currentTs &&
-       id.GetUid () <= m_currentUid) ||
-      id.PeekEventImpl ()->IsCancelled ()) 
-    {
-      return true;
-    }
-  else
-    {
-      return false;
-    }
+bool
+LocalTimeSimulatorImpl::IsTrackedExpired (const EventId &id) const
+{
+  return IsExpiredAt (id, id.GetTs ());
 }
 
 Time 
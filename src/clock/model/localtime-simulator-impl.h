@@ -22,7 +22,9 @@
 
 #include "ns3/default-simulator-impl.h"
 #include "ns3/local-clock.h"
-#include <map>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
 
 
 
@@ -43,10 +45,11 @@ namespace ns3{
 
     *  When an event is scheduled using Simulator::Schedule() function, the delay is understood as being a local-time delay. 
     The delay is then translated into a global-time delay before being inserted into the scheduler (the scheduler only operates in the global-time domain.
-    * When a clock model is updated, LocalTimeSimulatorImpl keeps track of the events that have been rescheduled, and will not execute the old events.
+    * When a clock model is updated, LocalTimeSimulatorImpl moves the events that have been rescheduled to their new global time.
 
-  When Simulator::Schedule() is called, the Node object  is retrieved from the NodeList using the current context of the simulator. 
-  When the context do not correspond to any node, delays are considered to be in global time.
+  When Simulator::Schedule() is called, the LocalClock of the node is retrieved from a clock table indexed by the current context of the simulator. 
+  The table is filled when Run() starts and updated when a LocalClock is aggregated to a node.
+  When the context do not correspond to any node, or the node has no clock, delays are considered to be in global time.
 
   When Simulator::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event) no further actions are taken. the delay is considered 
   to be in global time. This is because when a call to ScheduleWithContext happen, is due to a packet transmission within the channel. 
@@ -59,16 +62,16 @@ namespace ns3{
   When Simulator::ScheduleNow() is called, a call to Schedule() function with local-time delay 0 is done.
 
   One of the things to take into account is that Simulator::Now()  returns the current global time and not the local time.
-  Another particularity of this implementation resides in the CancelEventsMap map located in LocalTimeSimulatorImpl. When events are 
-  rescheduled, old events id (as key) with their corresponding new events (as value) are inserted in this map. As explained in the LocalClock 
-  section, we cannot use  Simulator::Cancel() to remove old events or their implementation would be lost.
-  In order not to execute events that should not be invoked (because the execution time attach to the event does not correspond to the new clock of
-  the node), ProcessOneEvent() function is slightly modifyied and checks the CancelEventsMap. 
-  If the EventId that is going to be executed is found as the map key, the event is skipped.
-
-  Other problem arises from the fact that the original event is never again valid, when rescheduling events. Any process (i.e Applications) that 
-  schedule events will never realize about the change of EventId due to the rescheduling. Therefore, there is a need to map between the original 
-  events and the reschedule events.
+  Simulator::GetDelayLeft() returns a local-time delay, measured by the clock of the node the event runs on, so that it 
+  matches the delay the event was scheduled with. Timer and Watchdog therefore run in the local time of their node. 
+  GetGlobalDelayLeft() gives the delay in global time.
+
+  When events are rescheduled due to a clock update, their scheduler entries are moved to the new global time and keep 
+  their uid. The EventIds handed out before the update still identify the events, but hold their old time: the current time 
+  of the moved events is kept in the MovedEventsMap, hashed by uid. IsExpired(), GetDelayLeft(), Cancel() and Remove() 
+  only look it up for events older than the last moved event of their node, the events scheduled since then skip it, and 
+  ProcessOneEvent() never does. Once all the times a moved event has had are in the past, its entry is no longer needed and
+  is garbage collected.
  * 
  */
 
@@ -109,8 +112,8 @@ public:
 
     
   /**
-   *  \brief This function apart from what it provides in DefaultSimulatorImpl, provides also a way to chech if events that have been reschedule due
-   * to a clock update are expired.
+   *  \brief This function apart from what it provides in DefaultSimulatorImpl, also checks the events that have been rescheduled due
+   * to a clock update with their current time.
    *  
    * \param id Event id to check
    */
@@ -125,26 +128,167 @@ public:
   virtual EventId Schedule (const Time &delay, EventImpl *event);
 
   /**
-   * \brief This function is only call when the node  reschedule an event. Instead of calling to cancel() it shoudl call to
-   * CancelRescheduling. Cancel() method will invalidate the event implementation and would be impossible to reschedule the event with another time. 
+   * \brief Reschedule the events of a node after its clock has been updated. The scheduler entry of each event is moved 
+   * to the global time given by the new clock, the event keeps its uid and its context, so that its EventIds stay valid.
+   * This is done in one pass, without going through Simulator::Schedule () for every event.
    * 
-   * \param id Event Id that want to be removed.
-  */
-  void CancelRescheduling (const EventId &id, const EventId &newId);
+   * \param clock The updated clock of the node
+   * \param events The live events of the node, with the local delay left before the update
+   * \param moved Receives the events whose global time has changed, for the EventRescheduled trace that the caller
+   * fires once the events of every updated clock are rescheduled
+   */
+  void ReSchedule (LocalClock *clock, const LocalClock::PendingEvents &events, LocalClock::MovedEvents &moved);
 
-private:
+  /**
+   * \brief Set the clock used to translate the delays of the events scheduled in a context. 
+   * LocalClock calls this function when it is aggregated to a node, so that Schedule () finds the clock 
+   * with a single lookup in the clock table instead of an aggregate search.
+   * 
+   * \param context Context of the node, i.e. the node id
+   * \param clock Clock of the node
+   */
+  void SetNodeClock (uint32_t context, Ptr<LocalClock> clock);
+  /**
+   * \brief Allocate the clock table at once, before the clocks of many nodes are set.
+   *
+   * \param nContexts Number of contexts of the table
+   */
+  void ReserveClocks (uint32_t nContexts);
+
+  /**
+   * \brief Same as IsExpired (), for an EventId that holds the current time of its event, as the ones tracked by LocalClock.
+   * The time of the events moved by clock updates is not looked up.
+   *
+   * \param id Event id to check
+   * \return true if the event has expired
+   */
+  bool IsTrackedExpired (const EventId &id) const;
+  /**
+   * \param id Event id
+   * \return Delay left before the event in global time, 0 if it has expired
+   */
+  Time GetGlobalDelayLeft (const EventId &id) const;
+
+  /**
+   * \brief Number of events moved due to rescheduling that are still tracked by the simulator.
+   * \return The size of the MovedEventsMap
+   */
+  std::size_t GetTombstoneCount (void) const;
 
-  /** \brief Process the next event. Check if the event to invoke is one of the events that is been 
-   * canceled by the clock update function. We  don't invoke those events. This is done in order to maintain the event implementation. 
+  /**
+   * \return true if a clock slowdown leaves the pending events of the node in the scheduler, to be re-timed when they reach its head
+   */
+  bool IsLazyRescheduling (void) const;
+  /**
+   * \return Uid of the next event, the events scheduled so far have a smaller uid
+   */
+  uint32_t GetNextUid (void) const;
+
+  /**
+   * \brief Fork the process into variants that each go on with the simulation from its current state.
+   *
+   * The checkpoint is the image of the process: the scheduler, the clock tables, the clock models and the pending events
+   * of the nodes are shared copy-on-write with the variants, so a warmup run once is not run again by each of them.
+   * The events hold arbitrary callbacks, they cannot be serialized.
+   *
+   * Fork () must be called from the main thread between two calls to Run (). Each variant returns with its index,
+   * typically changes the clock parameters, runs the rest of the simulation and exits, with a non-zero status on failure.
+   * The calling process returns once all the variants have exited, and is left in the state of the checkpoint.
+   * Streams are flushed before the fork, but files still open are shared by the variants: the traces of a variant
+   * should be opened after the fork, in a file of its own.
+   *
+   * \param nVariants Number of variants
+   * \param nParallel Maximum number of variants run at the same time
+   * \return Index of the variant in a variant, \p nVariants in the calling process
+   */
+  virtual uint32_t Fork (uint32_t nVariants, uint32_t nParallel);
+  /**
+   * \return Number of variants of the last call to Fork () that did not exit with status 0
+   */
+  uint32_t GetNFailedVariants (void) const;
+
+  /**
+   * \brief Get the LocalTimeSimulatorImpl that runs the events of the calling thread.
+   * This is the simulator implementation itself, unless a MultithreadedLocalTimeSimulatorImpl
+   * runs the thread on one of its partitions.
+   *
+   * \return The LocalTimeSimulatorImpl of the calling thread, or 0 if the simulator implementation is not one
+   */
+  static LocalTimeSimulatorImpl * GetCurrent (void);
+  /**
+   * \brief Set the LocalTimeSimulatorImpl that runs the events of the calling thread.
+   * \param impl The partition run by the thread, or 0 to use the simulator implementation
+   */
+  static void SetCurrent (LocalTimeSimulatorImpl *impl);
+
+protected:
+
+  /** \brief Process the next event. With lazy rescheduling, an event left behind by a clock update is moved to its 
+   * new global time instead of being invoked.
    */
   void ProcessOneEvent (void);
   /** Move events from a different context into the main event queue. */
   void ProcessEventsWithContext (void);
+  /** Prepare a call to Run (): set the main thread, insert the events with context and fill the clock table. */
+  void PrepareRun (void);
+  /** \return true if there are no more events or the simulation has been stopped */
+  bool IsLocalFinished (void) const;
+  /** \return Timestamp of the next event, the maximum simulation time if IsLocalFinished () */
+  uint64_t NextTs (void) const;
+
+  /** Flag calling for the end of the simulation. */
+  bool m_stop;
+  /** The event priority queue. */
+  Ptr<Scheduler> m_events;
+  /**
+   * Number of events that have been inserted but not yet scheduled,
+   *  not counting the Destroy events; this is used for validation
+   */
+  int m_unscheduledEvents;
+
+private:
   /** Function that insert and event in the scheduler */
-  Scheduler::Event InsertScheduler (EventImpl *impl, Time tAbsolute);
+  Scheduler::Event InsertScheduler (EventImpl *impl, Time tAbsolute, uint32_t context);
+  /**
+   * \brief Get the clock of the node that corresponds to a context. The clock table is filled when Run () starts 
+   * and completed lazily for the nodes created afterwards.
+   * 
+   * \param context Context of the node
+   * \return The clock of the node, or 0 if the context does not correspond to a node with a clock
+   */
+  LocalClock * GetClock (uint32_t context);
   /** Calculate absoulte time*/
   Time CalculateAbsoluteTime (Time delay);
- 
+  /**
+   * \brief Record the new time of an event moved by a clock update.
+   * \param uid Uid of the event
+   * \param oldTs Timestamp of the event before the move
+   * \param ts Timestamp of the event after the move
+   */
+  void RecordMove (uint32_t uid, uint64_t oldTs, uint64_t ts);
+  /**
+   * \brief Drop the tombstones that are no longer needed to answer IsExpired ().
+   * The sweep only runs once the number of tombstones has doubled since
+   * the previous sweep, so its cost is amortized over the events moved.
+   */
+  void CollectTombstones (void);
+  /**
+   * \param id Event id
+   * \return Current timestamp of the event, which differs from the one of \p id if the event has been moved since
+   */
+  uint64_t GetCurrentTs (const EventId &id) const;
+  /**
+   * \param id Event id
+   * \param ts Current timestamp of the event
+   * \return true if the event has expired
+   */
+  bool IsExpiredAt (const EventId &id, uint64_t ts) const;
+  /**
+   * \brief Wait for the oldest variant forked by Fork () to exit.
+   * \param variants Process ids of the variants still running, the one waited for is removed
+   */
+  void WaitVariant (std::vector<pid_t> &variants);
+
   /** Wrap an event with its execution context. */
   struct EventWithContext {
     /** The event context. */
@@ -170,10 +314,11 @@ private:
   typedef std::list<EventId> DestroyEvents;
   /** The container of events to run at Destroy. */
   DestroyEvents m_destroyEvents;
-  /** Flag calling for the end of the simulation. */
-  bool m_stop;
-  /** The event priority queue. */
-  Ptr<Scheduler> m_events;
+
+  /** Container type for the clocks of the nodes, indexed by context. */
+  typedef std::vector<Ptr<LocalClock> > ClockTable;
+  /** The clocks of the nodes, null for the nodes without clock. */
+  ClockTable m_clocks;
 
   /** Next event unique id. */
   uint32_t m_uid;
@@ -185,18 +330,25 @@ private:
   uint32_t m_currentContext;
   /** The event count. */
   uint64_t m_eventCount;
-  /** Container type for the events that has been cancelled due to rescheduling. Map between the old event id and the new event that has been 
-   * reschedule
+  /** Entry left behind by an event that has been moved due to rescheduling. */
+  struct Tombstone {
+    /** Current timestamp of the event. */
+    uint64_t ts;
+    /** Latest timestamp the event has had, the entry is needed until it is in the past. */
+    uint64_t lastTs;
+  };
+  /** Container type for the events that have been moved due to rescheduling. Hash map between the uid of the event 
+   * and its current time, so that the EventIds handed out before the move pay a constant-time lookup.
   */
-  typedef std::map<uint32_t, EventId> CancelEventsMap;
+  typedef std::unordered_map<uint32_t, Tombstone> MovedEventsMap;
 
-  CancelEventsMap m_cancelEventMap;
-
-  /**
-   * Number of events that have been inserted but not yet scheduled,
-   *  not counting the Destroy events; this is used for validation
-   */
-  int m_unscheduledEvents;
+  MovedEventsMap m_movedEvents;
+  /** Number of tombstones that triggers the next sweep. */
+  std::size_t m_tombstoneSweepThreshold;
+  /** Re-time the events of a node when they reach the head of the scheduler, instead of rescheduling them on a clock slowdown. */
+  bool m_lazyRescheduling;
+  /** Number of variants of the last fork that failed. */
+  uint32_t m_nFailedVariants;
 
   /** Main execution thread. */
   SystemThread::ThreadId m_main;
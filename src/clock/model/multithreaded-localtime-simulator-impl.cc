@@ -0,0 +1,570 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-localtime-simulator-impl.h"
+#include "ns3/simulator.h"
+#include "ns3/system-thread.h"
+#include "ns3/uinteger.h"
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/net-device.h"
+#include "ns3/channel.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <thread>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::MultithreadedLocalTimeSimulatorImpl implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedLocalTimeSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedLocalTimeSimulatorImpl);
+
+class MultithreadedLocalTimeSimulatorImpl::Partition : public LocalTimeSimulatorImpl
+{
+public:
+  /**
+   * Constructor.
+   * \param index Index of the partition
+   */
+  Partition (uint32_t index);
+  /** Destructor. */
+  ~Partition ();
+
+  /** Prepare the partition to be run by the calling thread. */
+  void Prepare (void);
+  /** \return Timestamp of the next event, the maximum simulation time if the partition has finished */
+  uint64_t GetNextTs (void) const;
+  /**
+   * \brief Run the events of the partition that are due before the end of the window.
+   * \param end End of the window, excluded
+   */
+  void RunWindow (uint64_t end);
+  /**
+   * \brief Push an event on the inbound queue of another partition.
+   * \param target Partition of the node
+   * \param context Context of the node
+   * \param delay Global-time delay, not smaller than the lookahead
+   * \param event Event implementation
+   */
+  void Send (Partition *target, uint32_t context, const Time &delay, EventImpl *event);
+  /** Schedule the events pushed on the inbound queue since the previous call. */
+  void Receive (void);
+
+  virtual void DoDispose (void);
+
+private:
+  /** Event sent by another partition. */
+  struct Message
+  {
+    /** Absolute timestamp. */
+    uint64_t ts;
+    /** Context of the node. */
+    uint32_t context;
+    /** Partition that sent the event. */
+    uint32_t source;
+    /** Rank of the event among the ones sent by the same partition. */
+    uint64_t seq;
+    /** The event implementation. */
+    EventImpl *event;
+    /** Next message of the queue. */
+    Message *next;
+  };
+  /**
+   * \param a A message
+   * \param b Another message
+   * \return true if \p a is scheduled before \p b
+   */
+  static bool IsBefore (const Message *a, const Message *b);
+
+  /** Index of the partition. */
+  uint32_t m_index;
+  /** End of the current window. */
+  uint64_t m_windowEnd;
+  /** Number of events sent to other partitions. */
+  uint64_t m_sent;
+  /** Inbound queue, a list pushed by the other threads and taken whole by the thread of the partition. */
+  std::atomic<Message *> m_inbox;
+};
+
+MultithreadedLocalTimeSimulatorImpl::Partition::Partition (uint32_t index)
+  : m_index (index),
+    m_windowEnd (0),
+    m_sent (0),
+    m_inbox (0)
+{
+}
+
+MultithreadedLocalTimeSimulatorImpl::Partition::~Partition ()
+{
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Partition::Prepare (void)
+{
+  PrepareRun ();
+}
+
+uint64_t
+MultithreadedLocalTimeSimulatorImpl::Partition::GetNextTs (void) const
+{
+  return NextTs ();
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Partition::RunWindow (uint64_t end)
+{
+  m_windowEnd = end;
+  while (!IsLocalFinished () && NextTs () < end)
+    {
+      ProcessOneEvent ();
+    }
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Partition::Send (Partition *target, uint32_t context, const Time &delay, EventImpl *event)
+{
+  Message *message = new Message;
+  message->ts = (Now () + delay).GetTimeStep ();
+  message->context = context;
+  message->source = m_index;
+  message->seq = m_sent++;
+  message->event = event;
+  NS_ABORT_MSG_IF (message->ts < m_windowEnd, "Event scheduled for node " << context << " in another partition "
+                   "with a delay smaller than the lookahead");
+
+  message->next = target->m_inbox.load (std::memory_order_relaxed);
+  while (!target->m_inbox.compare_exchange_weak (message->next, message, std::memory_order_release,
+                                                 std::memory_order_relaxed))
+    {
+    }
+}
+
+bool
+MultithreadedLocalTimeSimulatorImpl::Partition::IsBefore (const Message *a, const Message *b)
+{
+  if (a->ts != b->ts)
+    {
+      return a->ts < b->ts;
+    }
+  if (a->source != b->source)
+    {
+      return a->source < b->source;
+    }
+  return a->seq < b->seq;
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Partition::Receive (void)
+{
+  Message *message = m_inbox.exchange (0, std::memory_order_acquire);
+  if (message == 0)
+    {
+      return;
+    }
+  std::vector<Message *> messages;
+  for (; message != 0; message = message->next)
+    {
+      messages.push_back (message);
+    }
+  //The order of the queue depends on the threads, the order of the uids must not
+  std::sort (messages.begin (), messages.end (), &Partition::IsBefore);
+  for (std::vector<Message *>::const_iterator i = messages.begin (); i != messages.end (); ++i)
+    {
+      ScheduleWithContext ((*i)->context, TimeStep ((*i)->ts) - Now (), (*i)->event);
+      delete *i;
+    }
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Partition::DoDispose (void)
+{
+  Message *message = m_inbox.exchange (0, std::memory_order_acquire);
+  while (message != 0)
+    {
+      Message *next = message->next;
+      message->event->Unref ();
+      delete message;
+      message = next;
+    }
+  LocalTimeSimulatorImpl::DoDispose ();
+}
+
+thread_local MultithreadedLocalTimeSimulatorImpl::Partition *MultithreadedLocalTimeSimulatorImpl::m_current = 0;
+
+TypeId
+MultithreadedLocalTimeSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedLocalTimeSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<MultithreadedLocalTimeSimulatorImpl> ()
+    .AddAttribute ("Partitions",
+                   "Number of partitions of the nodes, each one is run by its own thread.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&MultithreadedLocalTimeSimulatorImpl::m_nPartitions),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("LookAhead",
+                   "Maximum lookahead between partitions, in global time. When zero, the lookahead "
+                   "is only given by the delays of the channels between partitions.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&MultithreadedLocalTimeSimulatorImpl::m_maxLookAhead),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+MultithreadedLocalTimeSimulatorImpl::MultithreadedLocalTimeSimulatorImpl ()
+  : m_nPartitions (2),
+    m_lookAhead (0),
+    m_stopTs (Time::Max ().GetTimeStep ()),
+    m_stop (false),
+    m_barrierCount (0),
+    m_barrierGeneration (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+MultithreadedLocalTimeSimulatorImpl::~MultithreadedLocalTimeSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_partitions.size (); ++i)
+    {
+      m_partitions[i]->Dispose ();
+    }
+  m_partitions.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i < m_partitions.size (); ++i)
+    {
+      m_current = PeekPointer (m_partitions[i]);
+      LocalTimeSimulatorImpl::SetCurrent (m_current);
+      m_partitions[i]->Destroy ();
+    }
+  m_current = 0;
+  LocalTimeSimulatorImpl::SetCurrent (0);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  //The simulator sets the scheduler once the attributes are set, the partitions can then be created
+  if (m_partitions.empty ())
+    {
+      for (uint32_t i = 0; i < m_nPartitions; ++i)
+        {
+          m_partitions.push_back (CreateObject<Partition> (i));
+        }
+    }
+  for (uint32_t i = 0; i < m_partitions.size (); ++i)
+    {
+      m_partitions[i]->SetScheduler (schedulerFactory);
+    }
+}
+
+MultithreadedLocalTimeSimulatorImpl::Partition *
+MultithreadedLocalTimeSimulatorImpl::GetCurrentPartition (void) const
+{
+  return m_current != 0 ? m_current : PeekPointer (m_partitions[0]);
+}
+
+uint32_t
+MultithreadedLocalTimeSimulatorImpl::GetNPartitions (void) const
+{
+  return m_nPartitions;
+}
+
+uint32_t
+MultithreadedLocalTimeSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context == Simulator::NO_CONTEXT)
+    {
+      return 0;
+    }
+  return context % m_nPartitions;
+}
+
+Time
+MultithreadedLocalTimeSimulatorImpl::GetLookAhead (void) const
+{
+  return TimeStep (m_lookAhead);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::CalculateLookAhead (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_lookAhead = m_maxLookAhead.IsStrictlyPositive () ? m_maxLookAhead.GetTimeStep () : Time::Max ().GetTimeStep ();
+
+  // The channel delays are global-time delays, they do not depend on the clocks of the nodes
+  for (NodeList::Iterator node = NodeList::Begin (); node != NodeList::End (); ++node)
+    {
+      uint32_t partition = GetPartition ((*node)->GetId ());
+      for (uint32_t i = 0; i < (*node)->GetNDevices (); ++i)
+        {
+          Ptr<Channel> channel = (*node)->GetDevice (i)->GetChannel ();
+          if (channel == 0)
+            {
+              continue;
+            }
+          for (uint32_t j = 0; j < channel->GetNDevices (); ++j)
+            {
+              if (GetPartition (channel->GetDevice (j)->GetNode ()->GetId ()) == partition)
+                {
+                  continue;
+                }
+              TimeValue delay;
+              NS_ABORT_MSG_UNLESS (channel->GetAttributeFailSafe ("Delay", delay),
+                                   "Channel " << channel->GetInstanceTypeId ().GetName () << " between partitions has no delay");
+              m_lookAhead = std::min<uint64_t> (m_lookAhead, delay.Get ().GetTimeStep ());
+            }
+        }
+    }
+  NS_ABORT_MSG_IF (m_lookAhead == 0, "The lookahead between partitions is zero");
+  NS_LOG_DEBUG ("LOOKAHEAD " << TimeStep (m_lookAhead));
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::WaitBarrier (void)
+{
+  uint32_t generation = m_barrierGeneration.load (std::memory_order_acquire);
+  if (m_barrierCount.fetch_add (1, std::memory_order_acq_rel) + 1 == m_nPartitions)
+    {
+      m_barrierCount.store (0, std::memory_order_relaxed);
+      m_barrierGeneration.fetch_add (1, std::memory_order_release);
+      return;
+    }
+  for (uint32_t spin = 0; m_barrierGeneration.load (std::memory_order_acquire) == generation; ++spin)
+    {
+      //There may be more threads than cores, the core is given away after a short spin
+      if (spin >= 64)
+        {
+          std::this_thread::yield ();
+        }
+    }
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::RunPartition (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+  Partition *partition = PeekPointer (m_partitions[index]);
+  m_current = partition;
+  LocalTimeSimulatorImpl::SetCurrent (partition);
+  {
+    CriticalSection cs (m_prepareMutex);
+    partition->Prepare ();
+  }
+
+  while (true)
+    {
+      //The other partitions are between two windows, the flags and the queues are stable
+      WaitBarrier ();
+      partition->Receive ();
+      m_nextTs[index] = partition->GetNextTs ();
+      bool stop = m_stop.load ();
+      uint64_t stopTs = m_stopTs.load ();
+      WaitBarrier ();
+
+      uint64_t next = *std::min_element (m_nextTs.begin (), m_nextTs.end ());
+      if (stop || next >= stopTs)
+        {
+          break;
+        }
+      //No partition can receive an event before next + lookahead
+      uint64_t end = stopTs - next > m_lookAhead ? next + m_lookAhead : stopTs;
+      partition->RunWindow (end);
+    }
+
+  m_current = 0;
+  LocalTimeSimulatorImpl::SetCurrent (0);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  CalculateLookAhead ();
+  m_stop = false;
+  m_nextTs.assign (m_nPartitions, 0);
+
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 1; i < m_nPartitions; ++i)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&MultithreadedLocalTimeSimulatorImpl::RunPartition, this).Bind (i));
+      thread->Start ();
+      threads.push_back (thread);
+    }
+  RunPartition (0);
+  for (uint32_t i = 0; i < threads.size (); ++i)
+    {
+      threads[i]->Join ();
+    }
+
+  //A stop time that has been reached does not apply to the next run
+  if (*std::min_element (m_nextTs.begin (), m_nextTs.end ()) >= m_stopTs)
+    {
+      m_stopTs = Time::Max ().GetTimeStep ();
+    }
+}
+
+bool
+MultithreadedLocalTimeSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  for (uint32_t i = 0; i < m_partitions.size (); ++i)
+    {
+      if (m_partitions[i]->GetNextTs () < m_stopTs)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  //The other partitions stop at the end of the current window
+  GetCurrentPartition ()->Stop ();
+  m_stop = true;
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Stop (const Time &delay)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep ());
+  uint64_t ts = (GetCurrentPartition ()->Now () + delay).GetTimeStep ();
+  uint64_t stopTs = m_stopTs.load ();
+  while (ts < stopTs && !m_stopTs.compare_exchange_weak (stopTs, ts))
+    {
+    }
+}
+
+EventId
+MultithreadedLocalTimeSimulatorImpl::Schedule (const Time &delay, EventImpl *event)
+{
+  return GetCurrentPartition ()->Schedule (delay, event);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << delay.GetTimeStep () << event);
+  Partition *target = PeekPointer (m_partitions[GetPartition (context)]);
+  if (m_current == 0 || m_current == target)
+    {
+      target->ScheduleWithContext (context, delay, event);
+      return;
+    }
+  m_current->Send (target, context, delay, event);
+}
+
+EventId
+MultithreadedLocalTimeSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return GetCurrentPartition ()->ScheduleNow (event);
+}
+
+EventId
+MultithreadedLocalTimeSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  return GetCurrentPartition ()->ScheduleDestroy (event);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Remove (const EventId &id)
+{
+  GetCurrentPartition ()->Remove (id);
+}
+
+void
+MultithreadedLocalTimeSimulatorImpl::Cancel (const EventId &id)
+{
+  GetCurrentPartition ()->Cancel (id);
+}
+
+bool
+MultithreadedLocalTimeSimulatorImpl::IsExpired (const EventId &id) const
+{
+  return GetCurrentPartition ()->IsExpired (id);
+}
+
+Time
+MultithreadedLocalTimeSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  return GetCurrentPartition ()->Now ();
+}
+
+Time
+MultithreadedLocalTimeSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  return GetCurrentPartition ()->GetDelayLeft (id);
+}
+
+Time
+MultithreadedLocalTimeSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return GetCurrentPartition ()->GetMaximumSimulationTime ();
+}
+
+uint32_t
+MultithreadedLocalTimeSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+uint32_t
+MultithreadedLocalTimeSimulatorImpl::GetContext (void) const
+{
+  return GetCurrentPartition ()->GetContext ();
+}
+
+uint64_t
+MultithreadedLocalTimeSimulatorImpl::GetEventCount (void) const
+{
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < m_partitions.size (); ++i)
+    {
+      count += m_partitions[i]->GetEventCount ();
+    }
+  return count;
+}
+
+} // namespace ns3
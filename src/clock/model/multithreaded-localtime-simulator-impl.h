@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef MULTITHREADED_LOCALTIME_SIMULATOR_IMPL_H
+#define MULTITHREADED_LOCALTIME_SIMULATOR_IMPL_H
+
+#include "ns3/localtime-simulator-impl.h"
+#include "ns3/system-mutex.h"
+#include <atomic>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::MultithreadedLocalTimeSimulatorImpl declaration.
+ */
+
+namespace ns3{
+
+/**
+ *  \ingroup simulator
+ *
+ * @brief Shared-memory parallel version of LocalTimeSimulatorImpl.
+ *
+ * The nodes are split in partitions, node i belongs to partition i modulo the number of partitions and the events
+ * without context belong to partition 0. Each partition is a LocalTimeSimulatorImpl with its own scheduler, clock
+ * table and tombstones, run by its own thread. The calls to Simulator are forwarded to the partition of the calling
+ * thread, so that local-time delays, clock updates and lazy rescheduling work as in LocalTimeSimulatorImpl.
+ *
+ * The partitions are synchronized conservatively. All the threads agree on the timestamp T of the next event, then
+ * each partition runs its events before T + lookahead, without any lock. An event scheduled with
+ * Simulator::ScheduleWithContext () for a node of another partition is pushed on the inbound queue of that partition,
+ * a lock-free list drained by its thread between two windows. Received events are sorted by timestamp and sender,
+ * so that a run does not depend on the interleaving of the threads.
+ *
+ * The lookahead is the smallest delay of the channels between nodes of different partitions, bounded by the
+ * LookAhead attribute. Channel delays are global-time delays, so the lookahead does not depend on the clocks of the
+ * nodes. Scheduling an event in another partition with a smaller delay is a fatal error.
+ *
+ * The events of a partition must only touch the state of its nodes. Events without context run in partition 0 and
+ * must not adjust the clocks of other partitions. EventIds are only meaningful in the partition that created them.
+ * The models are not made thread-safe by this class: in particular packets share buffers and metadata that are not
+ * protected, so that a network can only be split along channels once those are made thread-safe.
+ */
+class MultithreadedLocalTimeSimulatorImpl : public SimulatorImpl
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  MultithreadedLocalTimeSimulatorImpl ();
+  /** Destructor. */
+  ~MultithreadedLocalTimeSimulatorImpl ();
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (const Time &delay);
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+  virtual uint64_t GetEventCount (void) const;
+
+  /**
+   * \return Number of partitions, i.e. of threads that run the simulation
+   */
+  uint32_t GetNPartitions (void) const;
+  /**
+   * \param context Context of a node, or Simulator::NO_CONTEXT
+   * \return Partition that runs the events of the context
+   */
+  uint32_t GetPartition (uint32_t context) const;
+  /**
+   * \return Lookahead of the last call to Run ()
+   */
+  Time GetLookAhead (void) const;
+
+private:
+  /** LocalTimeSimulatorImpl run by one thread, with its inbound queue. */
+  class Partition;
+
+  virtual void DoDispose (void);
+  /** Compute the lookahead from the delays of the channels between partitions. */
+  void CalculateLookAhead (void);
+  /**
+   * \brief Run the windows of a partition until the simulation ends.
+   * \param index Index of the partition
+   */
+  void RunPartition (uint32_t index);
+  /** Wait until all the threads have reached the barrier. */
+  void WaitBarrier (void);
+  /** \return The partition of the calling thread, partition 0 outside of Run () */
+  Partition * GetCurrentPartition (void) const;
+
+  /** Number of partitions. */
+  uint32_t m_nPartitions;
+  /** The partitions, created with the scheduler. */
+  std::vector<Ptr<Partition> > m_partitions;
+  /** Timestamp of the next event of each partition, published between two barriers. */
+  std::vector<uint64_t> m_nextTs;
+  /** Maximum lookahead, 0 if unbounded. */
+  Time m_maxLookAhead;
+  /** Lookahead of the current run, in time steps. */
+  uint64_t m_lookAhead;
+  /** Global time at which the simulation stops. */
+  std::atomic<uint64_t> m_stopTs;
+  /** Flag calling for the end of the simulation. */
+  std::atomic<bool> m_stop;
+  /** Number of threads that have reached the barrier. */
+  std::atomic<uint32_t> m_barrierCount;
+  /** Number of times that the barrier has been passed. */
+  std::atomic<uint32_t> m_barrierGeneration;
+  /** Serializes the preparation of the partitions, which reads the node list. */
+  SystemMutex m_prepareMutex;
+  /** Partition run by the calling thread, 0 outside of Run (). */
+  static thread_local Partition *m_current;
+};
+
+}// namespace ns3
+
+#endif /* MULTITHREADED_LOCALTIME_SIMULATOR_IMPL_H */
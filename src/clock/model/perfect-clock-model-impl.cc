@@ -24,6 +24,8 @@
 #include "ns3/simulator.h"
 #include "ns3/double.h"
 #include "ns3/timer.h"
+#include "ns3/abort.h"
+#include <algorithm>
 
 
 namespace ns3 {
@@ -41,11 +43,13 @@ PerfectClockModelImpl::GetTypeId (void)
     .AddConstructor<PerfectClockModelImpl> ()
     .AddAttribute ("Frequency", "Frequency difference between clocks",
                   DoubleValue(1),
-                  MakeDoubleAccessor (&PerfectClockModelImpl::m_frequency),
+                  MakeDoubleAccessor (&PerfectClockModelImpl::SetFrequency,
+                                      &PerfectClockModelImpl::GetFrequency),
                   MakeDoubleChecker <double> ())
     .AddAttribute ("Offset", "Offset between clocks",
                   TimeValue(Seconds (0)),
-                  MakeTimeAccessor (&PerfectClockModelImpl::m_offset),
+                  MakeTimeAccessor (&PerfectClockModelImpl::SetOffset,
+                                    &PerfectClockModelImpl::GetOffset),
                   MakeTimeChecker ()) 
   ;
   return tid;
@@ -54,7 +58,7 @@ PerfectClockModelImpl::GetTypeId (void)
 PerfectClockModelImpl::PerfectClockModelImpl ()
 {
   NS_LOG_FUNCTION (this);
-  m_frequency = 2;
+  SetFrequency (1);
 }
 
 PerfectClockModelImpl::~PerfectClockModelImpl ()
@@ -62,13 +66,39 @@ PerfectClockModelImpl::~PerfectClockModelImpl ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+PerfectClockModelImpl::SetFrequency (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+  NS_ABORT_MSG_UNLESS (frequency > 0, "The frequency of a clock must be positive");
+  m_frequency = int64x64_t (frequency);
+  m_period = int64x64_t (1) / m_frequency;
+}
+
+double
+PerfectClockModelImpl::GetFrequency (void) const
+{
+  return m_frequency.GetDouble ();
+}
+
+void
+PerfectClockModelImpl::SetOffset (Time offset)
+{
+  NS_LOG_FUNCTION (this << offset);
+  m_offset = offset;
+}
+
+Time
+PerfectClockModelImpl::GetOffset (void) const
+{
+  return m_offset;
+}
+
 Time 
 PerfectClockModelImpl::GetLocalTime ()
 {
   NS_LOG_FUNCTION (this);
-  Time localTime;
-  Time globalTime = Simulator::Now () ;
-  localTime = GlobalToLocalTime(globalTime);
+  Time localTime = TimeStep (GlobalToLocalTs (Simulator::Now ().GetTimeStep ()));
   NS_LOG_DEBUG ("LOCALTIME " << localTime);
   return localTime;
 }
@@ -77,39 +107,41 @@ Time
 PerfectClockModelImpl::GlobalToLocalTime (Time globalTime)
 {
   NS_LOG_FUNCTION(this << globalTime);
-  Time localTime = Time ((globalTime).GetDouble () * m_frequency) + m_offset; 
-  return localTime;
+  return TimeStep (GlobalToLocalTs (globalTime.GetTimeStep ()));
 }
 
 Time 
 PerfectClockModelImpl::LocalToGlobalTime (Time localTime)
 {
   NS_LOG_FUNCTION (this << localTime);
-  Time globalTime = Time (((localTime).GetDouble () - m_offset) / m_frequency) ;
-  return globalTime;
+  return TimeStep (LocalToGlobalTs (localTime.GetTimeStep ()));
 }
 
 Time 
 PerfectClockModelImpl::GlobalToLocalDelay (Time globaldDelay)
 {
   NS_LOG_FUNCTION (this << globaldDelay); 
-  Time localDelay;
-  Time globalTime = Simulator::Now();
-  Time localAbsTime = GlobalToLocalTime (globaldDelay + globalTime);
-  localDelay = localAbsTime - GetLocalTime ();
-  return localDelay;
+  return GlobalDelayToLocalDelay (Simulator::Now (), globaldDelay);
 }
 
 Time 
 PerfectClockModelImpl::LocalToGlobalDelay (Time localDelay)
 {
   NS_LOG_FUNCTION (this << localDelay);
-  Time globalDelay;
-  Time localTime = GetLocalTime ();
-  Time globalAbsTime = LocalToGlobalTime (localDelay + localTime);
-  NS_LOG_DEBUG ("GLOBAL DELAY ABS " << globalAbsTime);
-  globalDelay = globalAbsTime - Simulator::Now ();
-  NS_LOG_DEBUG ("RETURNED TIME " << globalDelay);
-  return globalDelay;
+  return LocalDelayToGlobalDelay (Simulator::Now (), localDelay);
+}
+
+Time
+PerfectClockModelImpl::GlobalDelayToLocalDelay (Time globalTime, Time globalDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << globalDelay);
+  return TimeStep (GlobalDelayToLocalDelayTs (globalTime.GetTimeStep (), globalDelay.GetTimeStep ()));
+}
+
+Time
+PerfectClockModelImpl::LocalDelayToGlobalDelay (Time globalTime, Time localDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << localDelay);
+  return TimeStep (LocalDelayToGlobalDelayTs (globalTime.GetTimeStep (), localDelay.GetTimeStep ()));
+}
 }
-}
\ No newline at end of file
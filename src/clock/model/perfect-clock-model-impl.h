@@ -22,6 +22,8 @@
 
 #include "ns3/clock-model.h"
 #include "ns3/object.h"
+#include "ns3/int64x64.h"
+#include <algorithm>
 
 namespace ns3 {
 /**
@@ -33,6 +35,11 @@ namespace ns3 {
  * The slope of the function is determined by the frequency value differece. So if for example the frequency is set to 2.
  * Local clock will be two times slower that the global time. When local time says 2 global time will be saying 4.
  * Also a initial offest is possible to set up. So LT = f*GT + offset 
+ *
+ * Conversions are done on integer time steps with the frequency stored as an int64x64_t fixed-point number, so they
+ * do not lose precision on long simulations. Global to local rounds down, LT = floor (f*GT) + offset, and local to 
+ * global returns the earliest global time whose local time reaches the requested one. Therefore converting a time 
+ * back and forth gives the original time exactly: global times when f >= 1, local times when f <= 1.
  */
 
 class PerfectClockModelImpl : public ClockModel
@@ -48,13 +55,122 @@ public:
   Time LocalToGlobalTime (Time localtime);
   Time GlobalToLocalDelay (Time globaldDelay);
   Time LocalToGlobalDelay (Time localdelay);
+  Time GlobalDelayToLocalDelay (Time globalTime, Time globalDelay);
+  Time LocalDelayToGlobalDelay (Time globalTime, Time localDelay);
+
+  /**
+   * \param frequency Frequency of the clock, must be positive
+   */
+  void SetFrequency (double frequency);
+  /**
+   * \return Frequency of the clock
+   */
+  double GetFrequency (void) const;
+  /**
+   * \param offset Offset of the clock
+   */
+  void SetOffset (Time offset);
+  /**
+   * \return Offset of the clock
+   */
+  Time GetOffset (void) const;
+
+  /**
+   * \param globalTs Global time in time steps
+   * \return Local time in time steps
+   */
+  int64_t GlobalToLocalTs (int64_t globalTs) const;
+  /**
+   * \param localTs Local time in time steps
+   * \return Earliest global time in time steps whose local time is not before \p localTs
+   */
+  int64_t LocalToGlobalTs (int64_t localTs) const;
+  /**
+   * \brief Same as GlobalDelayToLocalDelay (), without virtual call nor logging, for LocalClock.
+   * \param globalTs Global time at which the delay starts, in time steps
+   * \param globalDelayTs Delay in global time, in time steps
+   * \return Delay in local time, in time steps
+   */
+  int64_t GlobalDelayToLocalDelayTs (int64_t globalTs, int64_t globalDelayTs) const;
+  /**
+   * \brief Same as LocalDelayToGlobalDelay (), without virtual call nor logging, for LocalClock.
+   * \param globalTs Global time at which the delay starts, in time steps
+   * \param localDelayTs Delay in local time, in time steps
+   * \return Delay in global time, in time steps, never negative
+   */
+  int64_t LocalDelayToGlobalDelayTs (int64_t globalTs, int64_t localDelayTs) const;
 
 private:
+  /**
+   * \brief Product of a positive fixed-point factor by a number of time steps, rounded down.
+   * Same result as (factor * int64x64_t (ts)).GetHigh (), with a single 128 by 64 bits product
+   * when int64x64_t is implemented on 128 bits integers.
+   * \param factor Positive factor
+   * \param ts Number of time steps
+   * \return The product, rounded down
+   */
+  static int64_t MulTs (int64x64_t factor, int64_t ts);
+
 //Frequency of the clock
-  double m_frequency;
+  int64x64_t m_frequency;
+//Inverse of the frequency, used to estimate local to global conversions
+  int64x64_t m_period;
   Time m_offset;
 };
 
+inline int64_t
+PerfectClockModelImpl::MulTs (int64x64_t factor, int64_t ts)
+{
+#if defined (INT64X64_USE_128)
+  uint64_t magnitude = ts < 0 ? -(uint64_t) ts : ts;
+  uint128_t product = ((((uint128_t) factor.GetHigh ()) << 64) | factor.GetLow ()) * magnitude;
+  if (ts < 0)
+    {
+      product = -product;
+    }
+  return (int64_t) (((int128_t) product) >> 64);
+#else
+  return (factor * int64x64_t (ts)).GetHigh ();
+#endif
+}
+
+inline int64_t
+PerfectClockModelImpl::GlobalToLocalTs (int64_t globalTs) const
+{
+  return MulTs (m_frequency, globalTs) + m_offset.GetTimeStep ();
+}
+
+inline int64_t
+PerfectClockModelImpl::LocalToGlobalTs (int64_t localTs) const
+{
+  //The product by the period is only an estimate, it is corrected to the 
+  //earliest global time step that the exact forward conversion maps to localTs or later
+  int64_t globalTs = MulTs (m_period, localTs - m_offset.GetTimeStep ());
+  while (GlobalToLocalTs (globalTs) < localTs)
+    {
+      ++globalTs;
+    }
+  while (GlobalToLocalTs (globalTs - 1) >= localTs)
+    {
+      --globalTs;
+    }
+  return globalTs;
+}
+
+inline int64_t
+PerfectClockModelImpl::GlobalDelayToLocalDelayTs (int64_t globalTs, int64_t globalDelayTs) const
+{
+  return GlobalToLocalTs (globalTs + globalDelayTs) - GlobalToLocalTs (globalTs);
+}
+
+inline int64_t
+PerfectClockModelImpl::LocalDelayToGlobalDelayTs (int64_t globalTs, int64_t localDelayTs) const
+{
+  int64_t globalAbsTs = LocalToGlobalTs (GlobalToLocalTs (globalTs) + localDelayTs);
+  //With f < 1 several global times share the current local time, the earliest one may be in the past
+  return std::max (globalAbsTs, globalTs) - globalTs;
+}
+
 
 }//namespace ns3
 #endif /* PERFECT_CLOCK_MODEL_IMPL_H */
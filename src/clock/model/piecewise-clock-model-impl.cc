@@ -0,0 +1,259 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/piecewise-clock-model-impl.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/abort.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PiecewiseClockModelImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (PiecewiseClockModelImpl);
+
+TypeId
+PiecewiseClockModelImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PiecewiseClockModelImpl")
+    .SetParent<ClockModel> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<PiecewiseClockModelImpl> ()
+  ;
+  return tid;
+}
+
+PiecewiseClockModelImpl::PiecewiseClockModelImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PiecewiseClockModelImpl::~PiecewiseClockModelImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+PiecewiseClockModelImpl::AddSegment (const Segment &segment)
+{
+  NS_LOG_FUNCTION (this << segment.globalStart << segment.localStart << segment.frequency);
+  NS_ABORT_MSG_UNLESS (segment.frequency > 0, "The frequency of a clock must be positive");
+  NS_ABORT_MSG_IF (segment.globalStart < Simulator::Now (), "A segment cannot start in the past");
+
+  Piece piece;
+  piece.globalStart = segment.globalStart.GetTimeStep ();
+  piece.localStart = segment.localStart.GetTimeStep ();
+  piece.frequency = int64x64_t (segment.frequency);
+  piece.period = int64x64_t (1) / piece.frequency;
+  if (!m_pieces.empty ())
+    {
+      const Piece &last = m_pieces.back ();
+      NS_ABORT_MSG_UNLESS (piece.globalStart > last.globalStart, "Segments must be ordered by global start time");
+      NS_ABORT_MSG_IF (piece.localStart < GlobalToLocalTs (last, piece.globalStart),
+                       "The local time of a segment cannot go backwards");
+    }
+  m_pieces.push_back (piece);
+}
+
+void
+PiecewiseClockModelImpl::AddSegment (Time globalStart, double frequency)
+{
+  Segment segment;
+  segment.globalStart = globalStart;
+  segment.localStart = m_pieces.empty () ? globalStart : TimeStep (GlobalToLocalTs (globalStart.GetTimeStep ()));
+  segment.frequency = frequency;
+  AddSegment (segment);
+}
+
+void
+PiecewiseClockModelImpl::AddSegments (const std::vector<Segment> &segments)
+{
+  NS_LOG_FUNCTION (this << segments.size ());
+  for (std::vector<Segment>::const_iterator i = segments.begin (); i != segments.end (); ++i)
+    {
+      AddSegment (*i);
+    }
+}
+
+void
+PiecewiseClockModelImpl::LoadSegments (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream input (filename.c_str ());
+  NS_ABORT_MSG_UNLESS (input.is_open (), "Could not open clock trajectory " << filename);
+
+  std::string line;
+  while (std::getline (input, line))
+    {
+      std::istringstream fields (line);
+      std::vector<double> values;
+      double value;
+      while (fields >> value)
+        {
+          values.push_back (value);
+        }
+      if (values.empty () && (line.find_first_not_of (" \t\r") == std::string::npos
+                              || line[line.find_first_not_of (" \t\r")] == '#'))
+        {
+          continue;
+        }
+      if (values.size () == 2)
+        {
+          AddSegment (Seconds (values[0]), values[1]);
+        }
+      else
+        {
+          NS_ABORT_MSG_UNLESS (values.size () == 3, "Malformed clock trajectory line: " << line);
+          Segment segment;
+          segment.globalStart = Seconds (values[0]);
+          segment.localStart = Seconds (values[1]);
+          segment.frequency = values[2];
+          AddSegment (segment);
+        }
+    }
+}
+
+uint32_t
+PiecewiseClockModelImpl::GetNSegments (void) const
+{
+  return m_pieces.size ();
+}
+
+int64_t
+PiecewiseClockModelImpl::GlobalToLocalTs (const Piece &piece, int64_t globalTs)
+{
+  return piece.localStart + (piece.frequency * int64x64_t (globalTs - piece.globalStart)).GetHigh ();
+}
+
+int64_t
+PiecewiseClockModelImpl::GlobalToLocalTs (int64_t globalTs) const
+{
+  NS_ASSERT_MSG (!m_pieces.empty (), "The clock trajectory has no segment");
+  //Last segment that starts at or before globalTs, the first one is extrapolated backwards
+  std::size_t low = 1;
+  std::size_t high = m_pieces.size ();
+  while (low < high)
+    {
+      std::size_t mid = low + (high - low) / 2;
+      if (globalTs < m_pieces[mid].globalStart)
+        {
+          high = mid;
+        }
+      else
+        {
+          low = mid + 1;
+        }
+    }
+  return GlobalToLocalTs (m_pieces[low - 1], globalTs);
+}
+
+int64_t
+PiecewiseClockModelImpl::LocalToGlobalTs (int64_t localTs) const
+{
+  NS_ASSERT_MSG (!m_pieces.empty (), "The clock trajectory has no segment");
+  //Last segment that starts strictly before localTs, the first one is extrapolated backwards
+  std::size_t low = 1;
+  std::size_t high = m_pieces.size ();
+  while (low < high)
+    {
+      std::size_t mid = low + (high - low) / 2;
+      if (localTs <= m_pieces[mid].localStart)
+        {
+          high = mid;
+        }
+      else
+        {
+          low = mid + 1;
+        }
+    }
+  const Piece &piece = m_pieces[low - 1];
+
+  //The product by the period is only an estimate, it is corrected to the
+  //earliest global time step that the exact forward conversion maps to localTs or later
+  int64_t globalTs = piece.globalStart + (piece.period * int64x64_t (localTs - piece.localStart)).GetHigh ();
+  while (GlobalToLocalTs (piece, globalTs) < localTs)
+    {
+      ++globalTs;
+    }
+  while (GlobalToLocalTs (piece, globalTs - 1) >= localTs)
+    {
+      --globalTs;
+    }
+  //localTs is not reached within the segment: the clock steps to it at the start of the next one
+  if (low < m_pieces.size () && globalTs > m_pieces[low].globalStart)
+    {
+      globalTs = m_pieces[low].globalStart;
+    }
+  return globalTs;
+}
+
+Time
+PiecewiseClockModelImpl::GetLocalTime ()
+{
+  NS_LOG_FUNCTION (this);
+  return TimeStep (GlobalToLocalTs (Simulator::Now ().GetTimeStep ()));
+}
+
+Time
+PiecewiseClockModelImpl::GlobalToLocalTime (Time globalTime)
+{
+  NS_LOG_FUNCTION (this << globalTime);
+  return TimeStep (GlobalToLocalTs (globalTime.GetTimeStep ()));
+}
+
+Time
+PiecewiseClockModelImpl::LocalToGlobalTime (Time localTime)
+{
+  NS_LOG_FUNCTION (this << localTime);
+  return TimeStep (LocalToGlobalTs (localTime.GetTimeStep ()));
+}
+
+Time
+PiecewiseClockModelImpl::GlobalToLocalDelay (Time globaldDelay)
+{
+  NS_LOG_FUNCTION (this << globaldDelay);
+  return GlobalDelayToLocalDelay (Simulator::Now (), globaldDelay);
+}
+
+Time
+PiecewiseClockModelImpl::LocalToGlobalDelay (Time localDelay)
+{
+  NS_LOG_FUNCTION (this << localDelay);
+  return LocalDelayToGlobalDelay (Simulator::Now (), localDelay);
+}
+
+Time
+PiecewiseClockModelImpl::GlobalDelayToLocalDelay (Time globalTime, Time globalDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << globalDelay);
+  int64_t globalTs = globalTime.GetTimeStep ();
+  return TimeStep (GlobalToLocalTs (globalTs + globalDelay.GetTimeStep ()) - GlobalToLocalTs (globalTs));
+}
+
+Time
+PiecewiseClockModelImpl::LocalDelayToGlobalDelay (Time globalTime, Time localDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << localDelay);
+  int64_t globalTs = globalTime.GetTimeStep ();
+  int64_t globalAbsTs = LocalToGlobalTs (GlobalToLocalTs (globalTs) + localDelay.GetTimeStep ());
+  return TimeStep (std::max (globalAbsTs, globalTs) - globalTs);
+}
+}
@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PIECEWISE_CLOCK_MODEL_IMPL_H
+#define PIECEWISE_CLOCK_MODEL_IMPL_H
+
+#include "ns3/clock-model.h"
+#include "ns3/object.h"
+#include "ns3/int64x64.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+/**
+ * \file Clock
+ * ns3::PiecewiseClockModelImpl declaration
+ *
+ * @brief This class represents a clock that follows a whole piecewise-affine trajectory.
+ * Each segment starts at a global time, with a local time and a frequency, so that within a segment
+ * LT = localStart + f*(GT - globalStart). Before the first segment the first one is extrapolated.
+ *
+ * A known drift profile can therefore be described by a single clock model, without calling LocalClock::SetClock ()
+ * at every change of frequency, which would reschedule all the pending events of the node.
+ * Conversions look up the segment with a binary search. They use the same integer arithmetic as PerfectClockModelImpl.
+ *
+ * Segments can be given as a vector, loaded from a file or appended one by one while the simulation runs.
+ * They are kept in a std::deque, so appending a segment never moves the previous ones. A segment cannot start in the
+ * past, and the events already scheduled keep the global time computed when they were scheduled.
+ *
+ * The local time must never go backwards: a segment cannot start at a local time earlier than the one reached
+ * by the previous segment. It can start later, which models a step of the clock.
+ */
+
+class PiecewiseClockModelImpl : public ClockModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  /** Description of a segment of the trajectory. */
+  struct Segment
+  {
+    /** Global time at which the segment starts. */
+    Time globalStart;
+    /** Local time at globalStart. */
+    Time localStart;
+    /** Frequency of the clock during the segment. */
+    double frequency;
+  };
+
+  PiecewiseClockModelImpl ();
+  ~PiecewiseClockModelImpl ();
+
+  Time GetLocalTime ();
+  Time GlobalToLocalTime (Time globalTime);
+  Time LocalToGlobalTime (Time localtime);
+  Time GlobalToLocalDelay (Time globaldDelay);
+  Time LocalToGlobalDelay (Time localdelay);
+  Time GlobalDelayToLocalDelay (Time globalTime, Time globalDelay);
+  Time LocalDelayToGlobalDelay (Time globalTime, Time localDelay);
+
+  /**
+   * \brief Append a segment to the trajectory.
+   * \param segment Segment to append, it must start after the last segment
+   */
+  void AddSegment (const Segment &segment);
+  /**
+   * \brief Append a segment that starts at the local time reached by the trajectory at \p globalStart,
+   * i.e. a change of frequency without a step. The first segment starts with local time equal to global time.
+   * \param globalStart Global time at which the segment starts
+   * \param frequency Frequency of the clock during the segment
+   */
+  void AddSegment (Time globalStart, double frequency);
+  /**
+   * \brief Append several segments to the trajectory.
+   * \param segments Segments to append, ordered by global start time
+   */
+  void AddSegments (const std::vector<Segment> &segments);
+  /**
+   * \brief Append the segments described in a text file.
+   * Each line holds either "<global start> <frequency>" or "<global start> <local start> <frequency>",
+   * with times in seconds. The first form is appended with AddSegment (Time, double). Empty lines and
+   * lines starting with '#' are ignored.
+   * \param filename Name of the file
+   */
+  void LoadSegments (std::string filename);
+  /**
+   * \return Number of segments of the trajectory
+   */
+  uint32_t GetNSegments (void) const;
+
+private:
+  /** Segment of the trajectory, in time steps. */
+  struct Piece
+  {
+    /** Global time at which the segment starts. */
+    int64_t globalStart;
+    /** Local time at globalStart. */
+    int64_t localStart;
+    /** Frequency of the clock during the segment. */
+    int64x64_t frequency;
+    /** Inverse of the frequency, used to estimate local to global conversions. */
+    int64x64_t period;
+  };
+  /** Container type for the segments, appending does not move the previous ones. */
+  typedef std::deque<Piece> Pieces;
+
+  /**
+   * \param globalTs Global time in time steps
+   * \return Local time in time steps
+   */
+  int64_t GlobalToLocalTs (int64_t globalTs) const;
+  /**
+   * \param localTs Local time in time steps
+   * \return Earliest global time in time steps whose local time is not before \p localTs
+   */
+  int64_t LocalToGlobalTs (int64_t localTs) const;
+  /**
+   * \param piece Segment used for the conversion
+   * \param globalTs Global time in time steps
+   * \return Local time in time steps
+   */
+  static int64_t GlobalToLocalTs (const Piece &piece, int64_t globalTs);
+
+  /** The segments, ordered by global start time. */
+  Pieces m_pieces;
+};
+
+
+}//namespace ns3
+#endif /* PIECEWISE_CLOCK_MODEL_IMPL_H */
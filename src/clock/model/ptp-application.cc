@@ -0,0 +1,440 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/ptp-application.h"
+#include "ns3/hardware-timestamp-tag.h"
+#include "ns3/perfect-clock-model-impl.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/channel.h"
+#include "ns3/packet.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/int64x64.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::PtpApplication, ns3::PtpMaster and ns3::PtpSlave implementations.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("PtpApplication");
+
+NS_OBJECT_ENSURE_REGISTERED (PtpApplication);
+NS_OBJECT_ENSURE_REGISTERED (PtpMaster);
+NS_OBJECT_ENSURE_REGISTERED (PtpSlave);
+
+TypeId
+PtpApplication::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PtpApplication")
+    .SetParent<Application> ()
+    .SetGroupName ("Clock")
+    .AddAttribute ("Domain", "Domain of the port, the messages of the other domains are ignored",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PtpApplication::m_domain),
+                   MakeUintegerChecker<uint8_t> ())
+  ;
+  return tid;
+}
+
+PtpApplication::PtpApplication ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PtpApplication::~PtpApplication ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+Mac48Address
+PtpApplication::GetMulticastAddress (void)
+{
+  static Mac48Address address ("01:1b:19:00:00:00");
+  return address;
+}
+
+void
+PtpApplication::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_clock = 0;
+  Application::DoDispose ();
+}
+
+void
+PtpApplication::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_clock = GetNode ()->GetObject<LocalClock> ();
+  GetNode ()->RegisterProtocolHandler (MakeCallback (&PtpApplication::Receive, this), PROTOCOL, 0);
+}
+
+void
+PtpApplication::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_timer.Cancel ();
+  GetNode ()->UnregisterProtocolHandler (MakeCallback (&PtpApplication::Receive, this));
+}
+
+Time
+PtpApplication::GetTimestamp (void) const
+{
+  return m_clock != 0 ? m_clock->GetTimestamp () : Simulator::Now ();
+}
+
+uint64_t
+PtpApplication::GetClockIdentity (void) const
+{
+  return GetNode ()->GetId ();
+}
+
+Time
+PtpApplication::Send (Ptr<NetDevice> device, PtpHeader &header, const Address &to)
+{
+  NS_LOG_FUNCTION (this << device << to);
+  header.SetDomain (m_domain);
+  header.SetSourceClockIdentity (GetClockIdentity ());
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  Time timestamp = GetTimestamp ();
+  device->Send (packet, to, PROTOCOL);
+  //A device installed by HardwareTimestampHelper stamps the packet when its transmission starts
+  HardwareTimestampTag tag;
+  if (packet->PeekPacketTag (tag) && !tag.GetTxTimestamp ().IsNegative ())
+    {
+      timestamp = tag.GetTxTimestamp ();
+    }
+  return timestamp;
+}
+
+void
+PtpApplication::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t,
+                         const Address &from, const Address &, NetDevice::PacketType)
+{
+  NS_LOG_FUNCTION (this << device << packet << from);
+  Time timestamp = GetTimestamp ();
+  HardwareTimestampTag tag;
+  if (packet->PeekPacketTag (tag) && !tag.GetRxTimestamp ().IsNegative ())
+    {
+      timestamp = tag.GetRxTimestamp ();
+    }
+  PtpHeader header;
+  //Frames shorter than the smallest message, or than their own type of message, are dropped
+  if (packet->GetSize () < header.GetSerializedSize () || packet->PeekHeader (header) == 0)
+    {
+      NS_LOG_LOGIC ("Dropping a frame of " << packet->GetSize () << " bytes, too short for a PTP message");
+      return;
+    }
+  if (header.GetDomain () != m_domain || header.GetSourceClockIdentity () == GetClockIdentity ())
+    {
+      return;
+    }
+  HandleMessage (device, header, timestamp, from);
+}
+
+TypeId
+PtpMaster::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PtpMaster")
+    .SetParent<PtpApplication> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<PtpMaster> ()
+    .AddAttribute ("SyncInterval", "Interval between two Sync messages, in local time",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&PtpMaster::m_syncInterval),
+                   MakeTimeChecker (TimeStep (1)))
+  ;
+  return tid;
+}
+
+PtpMaster::PtpMaster ()
+  : m_sequenceId (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PtpMaster::~PtpMaster ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+PtpMaster::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  PtpApplication::StartApplication ();
+  SendSync ();
+}
+
+void
+PtpMaster::SendSync (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_sequenceId++;
+  int8_t logInterval = (int8_t) std::floor (std::log2 (m_syncInterval.GetSeconds ()) + 0.5);
+  for (uint32_t i = 0; i < GetNode ()->GetNDevices (); ++i)
+    {
+      Ptr<NetDevice> device = GetNode ()->GetDevice (i);
+      //Loopback devices have no channel
+      if (device->GetChannel () == 0)
+        {
+          continue;
+        }
+      PtpHeader sync;
+      sync.SetMessageType (PtpHeader::SYNC);
+      sync.SetSequenceId (m_sequenceId);
+      sync.SetLogMessageInterval (logInterval);
+      sync.SetTimestamp (GetTimestamp ());
+      Time t1 = Send (device, sync, GetMulticastAddress ());
+
+      PtpHeader followUp;
+      followUp.SetMessageType (PtpHeader::FOLLOW_UP);
+      followUp.SetSequenceId (m_sequenceId);
+      followUp.SetLogMessageInterval (logInterval);
+      followUp.SetTimestamp (t1);
+      Send (device, followUp, GetMulticastAddress ());
+    }
+  m_timer = Simulator::Schedule (m_syncInterval, &PtpMaster::SendSync, this);
+}
+
+void
+PtpMaster::HandleMessage (Ptr<NetDevice> device, const PtpHeader &header, Time timestamp, const Address &from)
+{
+  NS_LOG_FUNCTION (this << device << timestamp << from);
+  if (header.GetMessageType () != PtpHeader::DELAY_REQ)
+    {
+      return;
+    }
+  PtpHeader response;
+  response.SetMessageType (PtpHeader::DELAY_RESP);
+  response.SetSequenceId (header.GetSequenceId ());
+  response.SetLogMessageInterval (0x7f);
+  response.SetTimestamp (timestamp);
+  response.SetRequestingClockIdentity (header.GetSourceClockIdentity ());
+  Send (device, response, from);
+}
+
+TypeId
+PtpSlave::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PtpSlave")
+    .SetParent<PtpApplication> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<PtpSlave> ()
+    .AddAttribute ("Kp", "Proportional gain of the servo",
+                   DoubleValue (0.7),
+                   MakeDoubleAccessor (&PtpSlave::m_kp),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("Ki", "Integral gain of the servo",
+                   DoubleValue (0.3),
+                   MakeDoubleAccessor (&PtpSlave::m_ki),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("StepThreshold", "Offsets larger than this are removed by a step of the clock, 0 to only step the first one",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&PtpSlave::m_stepThreshold),
+                   MakeTimeChecker ())
+    .AddAttribute ("MaxFrequencyCorrection", "Largest relative frequency correction of the servo",
+                   DoubleValue (1e-3),
+                   MakeDoubleAccessor (&PtpSlave::m_maxFrequencyCorrection),
+                   MakeDoubleChecker<double> (0, 0.5))
+    .AddAttribute ("DelayReqDelay", "Delay between a Follow_Up and the Delay_Req that follows, in seconds of local time",
+                   StringValue ("ns3::UniformRandomVariable[Min=0.0|Max=0.1]"),
+                   MakePointerAccessor (&PtpSlave::m_delayReqDelay),
+                   MakePointerChecker<RandomVariableStream> ())
+    .AddTraceSource ("Offset", "Offset from the master measured by the slave, before its correction",
+                     MakeTraceSourceAccessor (&PtpSlave::m_offsetTrace),
+                     "ns3::PtpSlave::OffsetTracedCallback")
+  ;
+  return tid;
+}
+
+PtpSlave::PtpSlave ()
+  : m_syncSequenceId (0),
+    m_waitFollowUp (false),
+    m_hasSync (false),
+    m_delayReqSequenceId (0),
+    m_waitDelayResp (false),
+    m_hasPathDelay (false),
+    m_locked (false),
+    m_drift (0),
+    m_frequency (1)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+PtpSlave::~PtpSlave ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+PtpSlave::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_device = 0;
+  m_delayReqDelay = 0;
+  PtpApplication::DoDispose ();
+}
+
+int64_t
+PtpSlave::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_delayReqDelay->SetStream (stream);
+  return 1;
+}
+
+Time
+PtpSlave::GetOffset (void) const
+{
+  return m_offset;
+}
+
+Time
+PtpSlave::GetMeanPathDelay (void) const
+{
+  return m_meanPathDelay;
+}
+
+void
+PtpSlave::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  PtpApplication::StartApplication ();
+  Ptr<PerfectClockModelImpl> model;
+  if (m_clock != 0)
+    {
+      PointerValue clockModel;
+      m_clock->GetAttribute ("ClockModel", clockModel);
+      model = clockModel.Get<PerfectClockModelImpl> ();
+    }
+  NS_ABORT_MSG_IF (model == 0, "The node of a PtpSlave needs a LocalClock with a PerfectClockModelImpl");
+  m_frequency = model->GetFrequency ();
+}
+
+void
+PtpSlave::HandleMessage (Ptr<NetDevice> device, const PtpHeader &header, Time timestamp, const Address &from)
+{
+  NS_LOG_FUNCTION (this << device << timestamp << from);
+  switch (header.GetMessageType ())
+    {
+    case PtpHeader::SYNC:
+      m_device = device;
+      m_master = from;
+      m_syncSequenceId = header.GetSequenceId ();
+      m_t2 = timestamp;
+      m_waitFollowUp = true;
+      break;
+    case PtpHeader::FOLLOW_UP:
+      {
+        if (!m_waitFollowUp || header.GetSequenceId () != m_syncSequenceId)
+          {
+            return;
+          }
+        m_waitFollowUp = false;
+        Time t1 = header.GetTimestamp ();
+        m_syncDelay = m_t2 - t1;
+        if (m_hasPathDelay)
+          {
+            m_offset = m_syncDelay - m_meanPathDelay;
+            m_offsetTrace (m_offset, m_meanPathDelay);
+            Servo (m_offset, m_hasSync ? t1 - m_lastT1 : Time (0));
+          }
+        m_lastT1 = t1;
+        m_hasSync = true;
+        if (!m_timer.IsRunning ())
+          {
+            m_timer = Simulator::Schedule (Seconds (m_delayReqDelay->GetValue ()), &PtpSlave::SendDelayReq, this);
+          }
+        break;
+      }
+    case PtpHeader::DELAY_RESP:
+      if (!m_waitDelayResp || header.GetRequestingClockIdentity () != GetClockIdentity ()
+          || header.GetSequenceId () != m_delayReqSequenceId)
+        {
+          return;
+        }
+      m_waitDelayResp = false;
+      m_meanPathDelay = TimeStep ((m_delayReqSyncDelay + header.GetTimestamp () - m_t3).GetTimeStep () / 2);
+      m_hasPathDelay = true;
+      break;
+    default:
+      break;
+    }
+}
+
+void
+PtpSlave::SendDelayReq (void)
+{
+  NS_LOG_FUNCTION (this);
+  PtpHeader request;
+  request.SetMessageType (PtpHeader::DELAY_REQ);
+  request.SetSequenceId (++m_delayReqSequenceId);
+  request.SetLogMessageInterval (0x7f);
+  request.SetTimestamp (GetTimestamp ());
+  m_delayReqSyncDelay = m_syncDelay;
+  m_t3 = Send (m_device, request, m_master);
+  m_waitDelayResp = true;
+}
+
+void
+PtpSlave::Servo (Time offset, Time interval)
+{
+  NS_LOG_FUNCTION (this << offset << interval);
+  if (!m_locked || (m_stepThreshold.IsStrictlyPositive () && Abs (offset) > m_stepThreshold))
+    {
+      m_locked = true;
+      AdjustClock (m_frequency * (1 - m_drift), offset);
+      return;
+    }
+  if (!interval.IsStrictlyPositive ())
+    {
+      return;
+    }
+  //PI controller on the offset, scaled by the interval into a relative frequency correction
+  double rate = offset.GetSeconds () / interval.GetSeconds ();
+  double kiTerm = m_ki * rate;
+  double correction = m_kp * rate + m_drift + kiTerm;
+  m_drift = std::max (-m_maxFrequencyCorrection, std::min (m_drift + kiTerm, m_maxFrequencyCorrection));
+  correction = std::max (-m_maxFrequencyCorrection, std::min (correction, m_maxFrequencyCorrection));
+  AdjustClock (m_frequency * (1 - correction), Time (0));
+}
+
+void
+PtpSlave::AdjustClock (double frequency, Time step)
+{
+  NS_LOG_FUNCTION (this << frequency << step);
+  int64_t now = Simulator::Now ().GetTimeStep ();
+  int64_t local = m_clock->GetTimestamp ().GetTimeStep () - step.GetTimeStep ();
+  //Same product as the one of PerfectClockModelImpl, so that the local time only moves by the step
+  int64_t offset = local - (int64x64_t (frequency) * int64x64_t (now)).GetHigh ();
+  m_clock->AdjustClock (frequency, TimeStep (offset));
+  //The timestamps of the slave that are still to be used are moved with the local time
+  m_syncDelay -= step;
+}
+
+}
@@ -0,0 +1,283 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PTP_APPLICATION_H
+#define PTP_APPLICATION_H
+
+#include "ns3/application.h"
+#include "ns3/local-clock.h"
+#include "ns3/ptp-header.h"
+#include "ns3/net-device.h"
+#include "ns3/mac48-address.h"
+#include "ns3/event-id.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::PtpApplication, ns3::PtpMaster and ns3::PtpSlave declarations.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup Clock
+ *
+ * @brief Port of the IEEE 1588 (PTPv2) protocol, base of PtpMaster and PtpSlave.
+ *
+ * The messages are carried directly over Ethernet, as in annex F of the standard: ether type 0x88F7, Sync and
+ * Follow_Up sent to the multicast address 01-1B-19-00-00-00, Delay_Req and Delay_Resp sent to the other end, so that
+ * the slaves of a shared medium do not receive the requests of each other. The port receives the messages of all the
+ * devices of its node, so it works on any device that carries ether types, as CsmaNetDevice and SimpleNetDevice do.
+ *
+ * The timestamps are taken in the local time of the node, from its LocalClock, or in global time if the node has no
+ * clock. When the devices have been installed with HardwareTimestampHelper, the timestamps of the HardwareTimestampTag
+ * are used. Otherwise the port stamps the messages itself, when it sends them and when it receives them.
+ *
+ * Each port has a single timer, whose event is reused for all its periodic messages.
+ */
+class PtpApplication : public Application
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  PtpApplication ();
+  virtual ~PtpApplication ();
+
+  /** Ether type of the PTP messages. */
+  static const uint16_t PROTOCOL = 0x88F7;
+  /** \return Multicast address of the Sync and Follow_Up messages */
+  static Mac48Address GetMulticastAddress (void);
+
+protected:
+  virtual void DoDispose (void);
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  /**
+   * \brief Handle a message of the domain of the port.
+   * \param device Device that received the message
+   * \param header Header of the message
+   * \param timestamp Local time at which the message was received
+   * \param from Address of the sender
+   */
+  virtual void HandleMessage (Ptr<NetDevice> device, const PtpHeader &header, Time timestamp, const Address &from) = 0;
+
+  /**
+   * \brief Send a message, with the source and the domain of the port.
+   * \param device Device to send the message on
+   * \param header Header of the message
+   * \param to Destination address
+   * \return Local time at which the transmission of the message started
+   */
+  Time Send (Ptr<NetDevice> device, PtpHeader &header, const Address &to);
+  /**
+   * \return Local time of the node now
+   */
+  Time GetTimestamp (void) const;
+  /**
+   * \return Clock identity of the node
+   */
+  uint64_t GetClockIdentity (void) const;
+
+  /** Clock of the node, 0 if the node runs on global time. */
+  Ptr<LocalClock> m_clock;
+  /** The timer of the port. */
+  EventId m_timer;
+
+private:
+  /**
+   * \brief Protocol handler of the PTP messages.
+   * \param device Device that received the packet
+   * \param packet The packet
+   * \param protocol Ether type of the packet
+   * \param from Address of the sender
+   * \param to Destination address
+   * \param packetType Type of the packet
+   */
+  void Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                const Address &from, const Address &to, NetDevice::PacketType packetType);
+
+  /** Domain of the port. */
+  uint8_t m_domain;
+};
+
+/**
+ * \ingroup Clock
+ *
+ * @brief Master port of the IEEE 1588 protocol, with the two-step delay request-response mechanism.
+ *
+ * The master sends a Sync followed by a Follow_Up holding the precise origin timestamp of the Sync, every
+ * SyncInterval of its local time, on every device of its node. It answers each Delay_Req with a Delay_Resp holding the
+ * receive timestamp of the request. A node with many devices, as the center of a star, therefore runs a single master
+ * and a single timer for all its slaves.
+ *
+ * When the transmission of a Sync does not start at once, the device has not stamped it yet when the Follow_Up is
+ * sent, and the precise origin timestamp is the time at which it was queued.
+ */
+class PtpMaster : public PtpApplication
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  PtpMaster ();
+  virtual ~PtpMaster ();
+
+private:
+  virtual void StartApplication (void);
+  virtual void HandleMessage (Ptr<NetDevice> device, const PtpHeader &header, Time timestamp, const Address &from);
+
+  /** Send a Sync and its Follow_Up on each device, and schedule the next ones. */
+  void SendSync (void);
+
+  /** Interval between two Sync, in local time. */
+  Time m_syncInterval;
+  /** Sequence id of the last Sync. */
+  uint16_t m_sequenceId;
+};
+
+/**
+ * \ingroup Clock
+ *
+ * @brief Slave port of the IEEE 1588 protocol, whose servo adjusts the LocalClock of its node in place.
+ *
+ * The slave stamps the Sync it receives (t2), and takes the precise origin timestamp (t1) from the Follow_Up. After
+ * each Follow_Up, it sends a Delay_Req (stamped t3) after a random delay, and receives its receive timestamp (t4) in
+ * the Delay_Resp. The mean path delay is ((t2 - t1) + (t4 - t3)) / 2, and the offset from the master is
+ * t2 - t1 - mean path delay.
+ *
+ * The servo is a PI controller, as the one of linuxptp. The first offset, and any offset larger than StepThreshold, is
+ * removed by a step of the clock. The following ones are fed to the controller, whose output is a relative frequency
+ * correction r applied to the free-running frequency f0 of the clock: f = f0 (1 - r). The clock is adjusted with
+ * LocalClock::AdjustClock (), without a step of the local time, so its model must be a PerfectClockModelImpl.
+ */
+class PtpSlave : public PtpApplication
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  PtpSlave ();
+  virtual ~PtpSlave ();
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random variables used by this application.
+   * \param stream First stream index to use
+   * \return The number of stream indices assigned by this application
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \return Last offset from the master measured, before its correction
+   */
+  Time GetOffset (void) const;
+  /**
+   * \return Mean path delay to the master
+   */
+  Time GetMeanPathDelay (void) const;
+
+  /**
+   * TracedCallback signature for the offsets measured.
+   * \param [in] offset Offset of the local time from the master
+   * \param [in] meanPathDelay Mean path delay to the master
+   */
+  typedef void (* OffsetTracedCallback)(Time offset, Time meanPathDelay);
+
+private:
+  virtual void DoDispose (void);
+  virtual void StartApplication (void);
+  virtual void HandleMessage (Ptr<NetDevice> device, const PtpHeader &header, Time timestamp, const Address &from);
+
+  /** Send a Delay_Req to the master. */
+  void SendDelayReq (void);
+  /**
+   * \brief Correct the offset from the master, by a step or by the PI controller.
+   * \param offset Offset of the local time from the master
+   * \param interval Interval between the last two Sync, in local time of the master
+   */
+  void Servo (Time offset, Time interval);
+  /**
+   * \brief Adjust the frequency of the clock, and step its local time.
+   * \param frequency New frequency of the clock
+   * \param step Step of the local time
+   */
+  void AdjustClock (double frequency, Time step);
+
+  /** Proportional gain of the servo. */
+  double m_kp;
+  /** Integral gain of the servo. */
+  double m_ki;
+  /** Offsets larger than this are removed by a step of the clock. */
+  Time m_stepThreshold;
+  /** Largest relative frequency correction of the servo. */
+  double m_maxFrequencyCorrection;
+  /** Delay between a Follow_Up and the Delay_Req that follows, in local time. */
+  Ptr<RandomVariableStream> m_delayReqDelay;
+
+  /** Device on which the master was heard. */
+  Ptr<NetDevice> m_device;
+  /** Address of the master. */
+  Address m_master;
+  /** Sequence id of the last Sync. */
+  uint16_t m_syncSequenceId;
+  /** true if the last Sync waits for its Follow_Up. */
+  bool m_waitFollowUp;
+  /** Receive timestamp of the last Sync. */
+  Time m_t2;
+  /** true once a Sync has been received with its Follow_Up. */
+  bool m_hasSync;
+  /** Precise origin timestamp of the last Sync received with its Follow_Up. */
+  Time m_lastT1;
+  /** Difference t2 - t1 of the last Sync received with its Follow_Up. */
+  Time m_syncDelay;
+  /** Sequence id of the last Delay_Req. */
+  uint16_t m_delayReqSequenceId;
+  /** true if the last Delay_Req waits for its Delay_Resp. */
+  bool m_waitDelayResp;
+  /** Transmit timestamp of the last Delay_Req. */
+  Time m_t3;
+  /** Difference t2 - t1 of the Sync before the last Delay_Req. */
+  Time m_delayReqSyncDelay;
+  /** true once the mean path delay has been measured. */
+  bool m_hasPathDelay;
+  /** Mean path delay to the master. */
+  Time m_meanPathDelay;
+  /** Last offset from the master. */
+  Time m_offset;
+  /** true once the first offset has been corrected. */
+  bool m_locked;
+  /** Integral term of the servo, as a relative frequency correction. */
+  double m_drift;
+  /** Free-running frequency of the clock. */
+  double m_frequency;
+  /** Offsets measured. */
+  TracedCallback<Time, Time> m_offsetTrace;
+};
+
+}
+
+#endif /* PTP_APPLICATION_H */
@@ -0,0 +1,272 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/ptp-header.h"
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::PtpHeader implementation.
+ */
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (PtpHeader);
+
+/** Size of the common header of PTPv2. */
+static const uint32_t PTP_COMMON_HEADER_SIZE = 34;
+/** Size of a timestamp. */
+static const uint32_t PTP_TIMESTAMP_SIZE = 10;
+/** Size of a port identity. */
+static const uint32_t PTP_PORT_IDENTITY_SIZE = 10;
+/** Port number of the single port of a node. */
+static const uint16_t PTP_PORT_NUMBER = 1;
+/** Two-step flag of the flag field. */
+static const uint16_t PTP_TWO_STEP_FLAG = 0x0200;
+
+TypeId
+PtpHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::PtpHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<PtpHeader> ()
+  ;
+  return tid;
+}
+
+PtpHeader::PtpHeader ()
+  : m_messageType (SYNC),
+    m_domain (0),
+    m_sequenceId (0),
+    m_sourceClockIdentity (0),
+    m_logMessageInterval (0),
+    m_timestamp (0),
+    m_requestingClockIdentity (0)
+{
+}
+
+void
+PtpHeader::SetMessageType (MessageType type)
+{
+  m_messageType = type;
+}
+
+PtpHeader::MessageType
+PtpHeader::GetMessageType (void) const
+{
+  return (MessageType) m_messageType;
+}
+
+void
+PtpHeader::SetDomain (uint8_t domain)
+{
+  m_domain = domain;
+}
+
+uint8_t
+PtpHeader::GetDomain (void) const
+{
+  return m_domain;
+}
+
+void
+PtpHeader::SetSequenceId (uint16_t sequenceId)
+{
+  m_sequenceId = sequenceId;
+}
+
+uint16_t
+PtpHeader::GetSequenceId (void) const
+{
+  return m_sequenceId;
+}
+
+void
+PtpHeader::SetSourceClockIdentity (uint64_t clockIdentity)
+{
+  m_sourceClockIdentity = clockIdentity;
+}
+
+uint64_t
+PtpHeader::GetSourceClockIdentity (void) const
+{
+  return m_sourceClockIdentity;
+}
+
+void
+PtpHeader::SetLogMessageInterval (int8_t logInterval)
+{
+  m_logMessageInterval = logInterval;
+}
+
+int8_t
+PtpHeader::GetLogMessageInterval (void) const
+{
+  return m_logMessageInterval;
+}
+
+void
+PtpHeader::SetTimestamp (Time timestamp)
+{
+  m_timestamp = timestamp.GetNanoSeconds ();
+}
+
+Time
+PtpHeader::GetTimestamp (void) const
+{
+  return NanoSeconds (m_timestamp);
+}
+
+void
+PtpHeader::SetRequestingClockIdentity (uint64_t clockIdentity)
+{
+  m_requestingClockIdentity = clockIdentity;
+}
+
+uint64_t
+PtpHeader::GetRequestingClockIdentity (void) const
+{
+  return m_requestingClockIdentity;
+}
+
+TypeId
+PtpHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+PtpHeader::GetSerializedSize (void) const
+{
+  uint32_t size = PTP_COMMON_HEADER_SIZE + PTP_TIMESTAMP_SIZE;
+  if (m_messageType == DELAY_RESP)
+    {
+      size += PTP_PORT_IDENTITY_SIZE;
+    }
+  return size;
+}
+
+void
+PtpHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  //Common header, the transport specific nibble is 0
+  i.WriteU8 (m_messageType & 0x0f);
+  i.WriteU8 (2);
+  i.WriteHtonU16 (GetSerializedSize ());
+  i.WriteU8 (m_domain);
+  i.WriteU8 (0);
+  i.WriteHtonU16 (m_messageType == SYNC ? PTP_TWO_STEP_FLAG : 0);
+  i.WriteHtonU64 (0);
+  i.WriteHtonU32 (0);
+  i.WriteHtonU64 (m_sourceClockIdentity);
+  i.WriteHtonU16 (PTP_PORT_NUMBER);
+  i.WriteHtonU16 (m_sequenceId);
+  uint8_t control;
+  switch (m_messageType)
+    {
+    case SYNC: control = 0; break;
+    case DELAY_REQ: control = 1; break;
+    case FOLLOW_UP: control = 2; break;
+    case DELAY_RESP: control = 3; break;
+    default: control = 5;
+    }
+  i.WriteU8 (control);
+  i.WriteU8 (m_logMessageInterval);
+
+  //Timestamp, the seconds rounded down so that the nanoseconds are positive
+  int64_t seconds = m_timestamp / 1000000000;
+  int64_t nanoSeconds = m_timestamp % 1000000000;
+  if (nanoSeconds < 0)
+    {
+      seconds--;
+      nanoSeconds += 1000000000;
+    }
+  i.WriteHtonU16 ((uint16_t) (seconds >> 32));
+  i.WriteHtonU32 ((uint32_t) seconds);
+  i.WriteHtonU32 ((uint32_t) nanoSeconds);
+
+  if (m_messageType == DELAY_RESP)
+    {
+      i.WriteHtonU64 (m_requestingClockIdentity);
+      i.WriteHtonU16 (PTP_PORT_NUMBER);
+    }
+}
+
+uint32_t
+PtpHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  //A truncated message is not read
+  if (start.GetRemainingSize () < PTP_COMMON_HEADER_SIZE + PTP_TIMESTAMP_SIZE)
+    {
+      return 0;
+    }
+  m_messageType = i.ReadU8 () & 0x0f;
+  if (start.GetRemainingSize () < GetSerializedSize ())
+    {
+      return 0;
+    }
+  i.ReadU8 ();
+  i.ReadNtohU16 ();
+  m_domain = i.ReadU8 ();
+  i.ReadU8 ();
+  i.ReadNtohU16 ();
+  i.ReadNtohU64 ();
+  i.ReadNtohU32 ();
+  m_sourceClockIdentity = i.ReadNtohU64 ();
+  i.ReadNtohU16 ();
+  m_sequenceId = i.ReadNtohU16 ();
+  i.ReadU8 ();
+  m_logMessageInterval = (int8_t) i.ReadU8 ();
+
+  //Sign extension of the 48 bits of seconds
+  int64_t seconds = ((int64_t) ((uint64_t) i.ReadNtohU16 () << 48)) >> 16;
+  seconds |= i.ReadNtohU32 ();
+  int64_t nanoSeconds = i.ReadNtohU32 ();
+  m_timestamp = seconds * 1000000000 + nanoSeconds;
+
+  if (m_messageType == DELAY_RESP)
+    {
+      m_requestingClockIdentity = i.ReadNtohU64 ();
+      i.ReadNtohU16 ();
+    }
+  return GetSerializedSize ();
+}
+
+void
+PtpHeader::Print (std::ostream &os) const
+{
+  switch (m_messageType)
+    {
+    case SYNC: os << "Sync"; break;
+    case DELAY_REQ: os << "Delay_Req"; break;
+    case FOLLOW_UP: os << "Follow_Up"; break;
+    case DELAY_RESP: os << "Delay_Resp"; break;
+    default: os << "type " << (uint32_t) m_messageType;
+    }
+  os << " domain=" << (uint32_t) m_domain
+     << " seq=" << m_sequenceId
+     << " source=" << m_sourceClockIdentity
+     << " timestamp=" << NanoSeconds (m_timestamp);
+  if (m_messageType == DELAY_RESP)
+    {
+      os << " requester=" << m_requestingClockIdentity;
+    }
+}
+
+}
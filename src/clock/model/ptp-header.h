@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PTP_HEADER_H
+#define PTP_HEADER_H
+
+#include "ns3/header.h"
+#include "ns3/nstime.h"
+
+/**
+ * \file
+ * \ingroup Clock
+ * ns3::PtpHeader declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup Clock
+ *
+ * @brief Header of the IEEE 1588 (PTPv2) messages exchanged by PtpMaster and PtpSlave.
+ *
+ * The header is serialized as the common header of PTPv2 (34 bytes) followed by the timestamp of the message
+ * (10 bytes: 48 bits of seconds and 32 bits of nanoseconds), and for a Delay_Resp by the port identity of the
+ * requester (10 bytes). The correction field is always 0. The seconds are signed, as a local time may be negative.
+ *
+ * The port identity of a node is its clock identity, the id of the node, and the port number 1.
+ */
+class PtpHeader : public Header
+{
+public:
+  /** Type of a message. */
+  enum MessageType
+  {
+    SYNC = 0x0,
+    DELAY_REQ = 0x1,
+    FOLLOW_UP = 0x8,
+    DELAY_RESP = 0x9
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  PtpHeader ();
+
+  /**
+   * \param type Type of the message
+   */
+  void SetMessageType (MessageType type);
+  /**
+   * \return Type of the message
+   */
+  MessageType GetMessageType (void) const;
+  /**
+   * \param domain Domain of the message
+   */
+  void SetDomain (uint8_t domain);
+  /**
+   * \return Domain of the message
+   */
+  uint8_t GetDomain (void) const;
+  /**
+   * \param sequenceId Sequence id of the message
+   */
+  void SetSequenceId (uint16_t sequenceId);
+  /**
+   * \return Sequence id of the message
+   */
+  uint16_t GetSequenceId (void) const;
+  /**
+   * \param clockIdentity Clock identity of the sender
+   */
+  void SetSourceClockIdentity (uint64_t clockIdentity);
+  /**
+   * \return Clock identity of the sender
+   */
+  uint64_t GetSourceClockIdentity (void) const;
+  /**
+   * \param logInterval Base 2 logarithm of the interval between two messages of this type, in seconds
+   */
+  void SetLogMessageInterval (int8_t logInterval);
+  /**
+   * \return Base 2 logarithm of the interval between two messages of this type, in seconds
+   */
+  int8_t GetLogMessageInterval (void) const;
+  /**
+   * \param timestamp Timestamp carried by the message: the origin timestamp of a Sync or a Delay_Req, the precise
+   * origin timestamp of a Follow_Up, the receive timestamp of a Delay_Resp
+   */
+  void SetTimestamp (Time timestamp);
+  /**
+   * \return Timestamp carried by the message, at the resolution of a nanosecond
+   */
+  Time GetTimestamp (void) const;
+  /**
+   * \param clockIdentity Clock identity of the sender of the Delay_Req answered by a Delay_Resp
+   */
+  void SetRequestingClockIdentity (uint64_t clockIdentity);
+  /**
+   * \return Clock identity of the sender of the Delay_Req answered by a Delay_Resp
+   */
+  uint64_t GetRequestingClockIdentity (void) const;
+
+  // inherited function, no need to doc.
+  virtual TypeId GetInstanceTypeId (void) const;
+  // inherited function, no need to doc.
+  virtual uint32_t GetSerializedSize (void) const;
+  // inherited function, no need to doc.
+  virtual void Serialize (Buffer::Iterator start) const;
+  // inherited function, no need to doc.
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  // inherited function, no need to doc.
+  virtual void Print (std::ostream &os) const;
+
+private:
+  /** Type of the message. */
+  uint8_t m_messageType;
+  /** Domain of the message. */
+  uint8_t m_domain;
+  /** Sequence id of the message. */
+  uint16_t m_sequenceId;
+  /** Clock identity of the sender. */
+  uint64_t m_sourceClockIdentity;
+  /** Base 2 logarithm of the message interval. */
+  int8_t m_logMessageInterval;
+  /** Timestamp of the message in nanoseconds. */
+  int64_t m_timestamp;
+  /** Clock identity of the requester, for a Delay_Resp. */
+  uint64_t m_requestingClockIdentity;
+};
+
+}
+
+#endif /* PTP_HEADER_H */
@@ -0,0 +1,266 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "ns3/stochastic-clock-model-impl.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/abort.h"
+#include <algorithm>
+
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("StochasticClockModelImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (StochasticClockModelImpl);
+
+TypeId
+StochasticClockModelImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::StochasticClockModelImpl")
+    .SetParent<ClockModel> ()
+    .SetGroupName ("Clock")
+    .AddConstructor<StochasticClockModelImpl> ()
+    .AddAttribute ("Frequency", "Nominal frequency of the clock",
+                   DoubleValue (1),
+                   MakeDoubleAccessor (&StochasticClockModelImpl::m_frequency),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("Offset", "Local time at global time 0",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&StochasticClockModelImpl::m_offset),
+                   MakeTimeChecker ())
+    .AddAttribute ("Step", "Interval of global time during which the frequency is constant",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&StochasticClockModelImpl::m_step),
+                   MakeTimeChecker (TimeStep (1)))
+    .AddAttribute ("WhiteFrequencyNoise", "Standard deviation of the white fractional frequency noise of each step",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&StochasticClockModelImpl::m_whiteNoise),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("RandomWalkFrequencyNoise", "Standard deviation of the change of the random walk fractional "
+                   "frequency noise between two steps",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&StochasticClockModelImpl::m_randomWalkNoise),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("BlockSize", "Number of steps generated at once",
+                   UintegerValue (1024),
+                   MakeUintegerAccessor (&StochasticClockModelImpl::m_blockSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Window", "Number of blocks kept in memory once the simulation has passed them",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&StochasticClockModelImpl::m_window),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+StochasticClockModelImpl::StochasticClockModelImpl ()
+  : m_first (0),
+    m_walk (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_normal = CreateObject<NormalRandomVariable> ();
+}
+
+StochasticClockModelImpl::~StochasticClockModelImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+StochasticClockModelImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_normal = 0;
+  m_steps.clear ();
+  ClockModel::DoDispose ();
+}
+
+int64_t
+StochasticClockModelImpl::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_normal->SetStream (stream);
+  return 1;
+}
+
+uint32_t
+StochasticClockModelImpl::GetNSteps (void) const
+{
+  return m_steps.size ();
+}
+
+void
+StochasticClockModelImpl::GenerateBlock (void)
+{
+  NS_LOG_FUNCTION (this << m_first + m_steps.size ());
+  int64_t stepTs = m_step.GetTimeStep ();
+
+  //Drop the oldest blocks once the simulation has passed them
+  uint64_t now = Simulator::Now ().GetTimeStep () / stepTs;
+  while (m_steps.size () >= (uint64_t) m_window * m_blockSize && m_first + m_blockSize <= now)
+    {
+      m_steps.erase (m_steps.begin (), m_steps.begin () + m_blockSize);
+      m_first += m_blockSize;
+    }
+
+  //All the draws of the block first, two per step
+  m_draws.resize (2 * m_blockSize);
+  for (std::vector<double>::iterator i = m_draws.begin (); i != m_draws.end (); ++i)
+    {
+      *i = m_normal->GetValue ();
+    }
+  //Fractional frequency deviation of each step, in place of the white noise draws
+  for (uint32_t i = 0; i < m_blockSize; ++i)
+    {
+      m_walk += m_randomWalkNoise * m_draws[m_blockSize + i];
+      m_draws[i] = m_frequency * (1 + m_walk + m_whiteNoise * m_draws[i]);
+    }
+
+  //Integrate the frequency to get the local time at the start of each step
+  int64_t localStart = m_steps.empty () ? m_offset.GetTimeStep () : m_steps.back ().localStart
+    + (m_steps.back ().frequency * int64x64_t (stepTs)).GetHigh ();
+  for (uint32_t i = 0; i < m_blockSize; ++i)
+    {
+      NS_ABORT_MSG_UNLESS (m_draws[i] > 0, "The frequency noise made the frequency of the clock negative");
+      Step step;
+      step.localStart = localStart;
+      step.frequency = int64x64_t (m_draws[i]);
+      step.period = int64x64_t (1) / step.frequency;
+      m_steps.push_back (step);
+      localStart += (step.frequency * int64x64_t (stepTs)).GetHigh ();
+    }
+}
+
+const StochasticClockModelImpl::Step &
+StochasticClockModelImpl::GetStep (uint64_t index)
+{
+  NS_ABORT_MSG_IF (index < m_first, "Time before the window of the clock trajectory");
+  while (index >= m_first + m_steps.size ())
+    {
+      GenerateBlock ();
+    }
+  return m_steps[index - m_first];
+}
+
+int64_t
+StochasticClockModelImpl::GlobalToLocalTs (int64_t globalTs)
+{
+  int64_t stepTs = m_step.GetTimeStep ();
+  uint64_t index = globalTs / stepTs;
+  const Step &step = GetStep (index);
+  return step.localStart + (step.frequency * int64x64_t (globalTs - (int64_t) index * stepTs)).GetHigh ();
+}
+
+int64_t
+StochasticClockModelImpl::LocalToGlobalTs (int64_t localTs)
+{
+  int64_t stepTs = m_step.GetTimeStep ();
+  GetStep (m_first);
+  while (m_steps.back ().localStart < localTs)
+    {
+      GenerateBlock ();
+    }
+  NS_ABORT_MSG_IF (localTs <= m_steps.front ().localStart && m_first > 0, "Time before the window of the clock trajectory");
+
+  //Last step that starts strictly before localTs, the first one is extrapolated backwards
+  struct LocalStartBefore
+  {
+    bool operator() (int64_t ts, const Step &step) const
+    {
+      return ts <= step.localStart;
+    }
+  };
+  Steps::const_iterator it = std::upper_bound (m_steps.begin () + 1, m_steps.end (), localTs, LocalStartBefore ());
+  uint64_t index = m_first + (it - m_steps.begin ()) - 1;
+  const Step &step = m_steps[index - m_first];
+  int64_t globalStart = (int64_t) index * stepTs;
+
+  //The product by the period is only an estimate, it is corrected to the
+  //earliest global time step that the exact forward conversion maps to localTs or later
+  int64_t globalTs = globalStart + (step.period * int64x64_t (localTs - step.localStart)).GetHigh ();
+  while (step.localStart + (step.frequency * int64x64_t (globalTs - globalStart)).GetHigh () < localTs)
+    {
+      ++globalTs;
+    }
+  while (step.localStart + (step.frequency * int64x64_t (globalTs - 1 - globalStart)).GetHigh () >= localTs)
+    {
+      --globalTs;
+    }
+  return std::min (globalTs, globalStart + stepTs);
+}
+
+double
+StochasticClockModelImpl::GetFrequency (Time globalTime)
+{
+  return GetStep (globalTime.GetTimeStep () / m_step.GetTimeStep ()).frequency.GetDouble ();
+}
+
+Time
+StochasticClockModelImpl::GetLocalTime ()
+{
+  NS_LOG_FUNCTION (this);
+  return TimeStep (GlobalToLocalTs (Simulator::Now ().GetTimeStep ()));
+}
+
+Time
+StochasticClockModelImpl::GlobalToLocalTime (Time globalTime)
+{
+  NS_LOG_FUNCTION (this << globalTime);
+  return TimeStep (GlobalToLocalTs (globalTime.GetTimeStep ()));
+}
+
+Time
+StochasticClockModelImpl::LocalToGlobalTime (Time localTime)
+{
+  NS_LOG_FUNCTION (this << localTime);
+  return TimeStep (LocalToGlobalTs (localTime.GetTimeStep ()));
+}
+
+Time
+StochasticClockModelImpl::GlobalToLocalDelay (Time globaldDelay)
+{
+  NS_LOG_FUNCTION (this << globaldDelay);
+  return GlobalDelayToLocalDelay (Simulator::Now (), globaldDelay);
+}
+
+Time
+StochasticClockModelImpl::LocalToGlobalDelay (Time localDelay)
+{
+  NS_LOG_FUNCTION (this << localDelay);
+  return LocalDelayToGlobalDelay (Simulator::Now (), localDelay);
+}
+
+Time
+StochasticClockModelImpl::GlobalDelayToLocalDelay (Time globalTime, Time globalDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << globalDelay);
+  int64_t globalTs = globalTime.GetTimeStep ();
+  return TimeStep (GlobalToLocalTs (globalTs + globalDelay.GetTimeStep ()) - GlobalToLocalTs (globalTs));
+}
+
+Time
+StochasticClockModelImpl::LocalDelayToGlobalDelay (Time globalTime, Time localDelay)
+{
+  NS_LOG_FUNCTION (this << globalTime << localDelay);
+  int64_t globalTs = globalTime.GetTimeStep ();
+  int64_t globalAbsTs = LocalToGlobalTs (GlobalToLocalTs (globalTs) + localDelay.GetTimeStep ());
+  return TimeStep (std::max (globalAbsTs, globalTs) - globalTs);
+}
+}
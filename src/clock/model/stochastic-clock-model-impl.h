@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef STOCHASTIC_CLOCK_MODEL_IMPL_H
+#define STOCHASTIC_CLOCK_MODEL_IMPL_H
+
+#include "ns3/clock-model.h"
+#include "ns3/object.h"
+#include "ns3/int64x64.h"
+#include "ns3/random-variable-stream.h"
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+/**
+ * \file Clock
+ * ns3::StochasticClockModelImpl declaration
+ *
+ * @brief This class represents a free-running oscillator, whose frequency is perturbed by random noise.
+ *
+ * Global time is divided in steps of constant length. During step k the frequency of the clock is
+ * f_k = Frequency * (1 + y_k), where the fractional frequency deviation y_k is the sum of two noises:
+ *  - white frequency noise, independent draws of standard deviation WhiteFrequencyNoise. Its Allan
+ *    deviation is WhiteFrequencyNoise * sqrt (Step / tau).
+ *  - random walk frequency noise, whose increments between two steps have a standard deviation
+ *    RandomWalkFrequencyNoise. Its Allan deviation is about RandomWalkFrequencyNoise * sqrt (tau / (3 Step)).
+ *
+ * The local time is the integral of the frequency, starting at Offset: the model is piecewise affine, like
+ * PiecewiseClockModelImpl, and the local time at the start of each step is cached. A conversion is therefore an
+ * interpolation in the table of steps, found by a division for global times and by a binary search for local times.
+ * No random number is drawn by a conversion.
+ *
+ * Steps are generated on demand, a block at a time: the normal draws of the whole block are taken from the
+ * random variable stream, then the frequencies and the local times are computed in tight loops over the block.
+ * Only the last Window blocks are kept once the simulation has passed them, so that the memory used does not
+ * grow with the duration of the simulation. Converting a time that precedes the kept blocks is an error.
+ *
+ * The draws come from a NormalRandomVariable. Its stream is assigned automatically, or with AssignStreams (),
+ * and the substream is selected by the run number, as for any random variable of ns-3.
+ */
+
+class StochasticClockModelImpl : public ClockModel
+{
+public:
+  static TypeId GetTypeId (void);
+
+  StochasticClockModelImpl ();
+  ~StochasticClockModelImpl ();
+
+  Time GetLocalTime ();
+  Time GlobalToLocalTime (Time globalTime);
+  Time LocalToGlobalTime (Time localtime);
+  Time GlobalToLocalDelay (Time globaldDelay);
+  Time LocalToGlobalDelay (Time localdelay);
+  Time GlobalDelayToLocalDelay (Time globalTime, Time globalDelay);
+  Time LocalDelayToGlobalDelay (Time globalTime, Time localDelay);
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random variables used by this model.
+   * \param stream First stream index to use
+   * \return The number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+  /**
+   * \param globalTime A global time
+   * \return Frequency of the clock at \p globalTime
+   */
+  double GetFrequency (Time globalTime);
+  /**
+   * \return Number of steps kept in memory
+   */
+  uint32_t GetNSteps (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /** Step of the trajectory. */
+  struct Step
+  {
+    /** Local time at the start of the step. */
+    int64_t localStart;
+    /** Frequency of the clock during the step. */
+    int64x64_t frequency;
+    /** Inverse of the frequency, used to estimate local to global conversions. */
+    int64x64_t period;
+  };
+  /** Container type for the steps, the oldest blocks are dropped from the front. */
+  typedef std::deque<Step> Steps;
+
+  /** Generate the next block of steps, and drop the oldest ones the simulation has passed. */
+  void GenerateBlock (void);
+  /**
+   * \param index Index of a step since the start of the simulation
+   * \return The step, generated if needed
+   */
+  const Step & GetStep (uint64_t index);
+  /**
+   * \param globalTs Global time in time steps
+   * \return Local time in time steps
+   */
+  int64_t GlobalToLocalTs (int64_t globalTs);
+  /**
+   * \param localTs Local time in time steps
+   * \return Earliest global time in time steps whose local time is not before \p localTs
+   */
+  int64_t LocalToGlobalTs (int64_t localTs);
+
+  /** Nominal frequency. */
+  double m_frequency;
+  /** Local time at global time 0. */
+  Time m_offset;
+  /** Length of a step. */
+  Time m_step;
+  /** Standard deviation of the white frequency noise. */
+  double m_whiteNoise;
+  /** Standard deviation of the increments of the random walk frequency noise. */
+  double m_randomWalkNoise;
+  /** Number of steps of a block. */
+  uint32_t m_blockSize;
+  /** Number of blocks kept once the simulation has passed them. */
+  uint32_t m_window;
+
+  /** Source of the normal draws. */
+  Ptr<NormalRandomVariable> m_normal;
+  /** The steps kept in memory. */
+  Steps m_steps;
+  /** Index of the first step kept in memory. */
+  uint64_t m_first;
+  /** Current value of the random walk. */
+  double m_walk;
+  /** Draws of the block being generated. */
+  std::vector<double> m_draws;
+};
+
+
+}//namespace ns3
+#endif /* STOCHASTIC_CLOCK_MODEL_IMPL_H */
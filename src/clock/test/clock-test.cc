@@ -2,13 +2,28 @@
 
 #include "ns3/test.h"
 #include "ns3/localtime-simulator-impl.h"
+#include "ns3/multithreaded-localtime-simulator-impl.h"
 #include "ns3/local-clock.h"
 #include "ns3/perfect-clock-model-impl.h"
+#include "ns3/piecewise-clock-model-impl.h"
+#include "ns3/stochastic-clock-model-impl.h"
+#include "ns3/clock-helper.h"
+#include "ns3/hardware-timestamp-tag.h"
+#include "ns3/ptp-application.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#ifdef NS3_CLOCK_TEST_POINT_TO_POINT
+#include "ns3/point-to-point-helper.h"
+#include "ns3/data-rate.h"
+#endif
 #include "ns3/log.h"
 #include "ns3/node.h"
 #include "ns3/simulator.h"
 #include "ns3/double.h"
 #include "ns3/core-module.h"
+#include <algorithm>
+#include <fstream>
+#include <unistd.h>
 
 using namespace ns3;
 
@@ -248,6 +263,1510 @@ EventSchedulTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+* This test checks that the events moved by a clock update run exactly once and that the
+* entries kept for their old EventIds are collected once they are no longer needed.
+*/
+class TombstoneTestCase : public TestCase
+{
+public:
+  TombstoneTestCase ();
+  virtual ~TombstoneTestCase ();
+  virtual void DoRun (void);
+
+  void Start (void);
+  void Event (uint32_t i);
+  void Update (double freq);
+
+  Ptr<LocalClock> m_clock;
+  std::vector<uint32_t> m_runs;
+  std::vector<EventId> m_ids;
+  uint32_t m_rescheduled;
+};
+
+TombstoneTestCase::TombstoneTestCase ()
+  : TestCase ("Check that rescheduled events run once and their tombstones are collected")
+{
+}
+
+TombstoneTestCase::~TombstoneTestCase ()
+{
+}
+
+void
+TombstoneTestCase::Start (void)
+{
+  for (uint32_t i = 0; i < m_runs.size (); ++i)
+    {
+      m_ids.push_back (Simulator::Schedule (MilliSeconds (i), &TombstoneTestCase::Event, this, i));
+    }
+}
+
+void
+TombstoneTestCase::Event (uint32_t i)
+{
+  m_runs[i]++;
+}
+
+void
+TombstoneTestCase::Update (double freq)
+{
+  Ptr<ClockModel> model = CreateObject<PerfectClockModelImpl> ();
+  model -> SetAttribute ("Frequency", DoubleValue (freq));
+  m_rescheduled += std::count (m_runs.begin (), m_runs.end (), 0);
+  m_clock -> SetClock (model);
+}
+
+void
+TombstoneTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<ClockModel> model = CreateObject<PerfectClockModelImpl> ();
+  model -> SetAttribute ("Frequency", DoubleValue (1));
+  m_clock = CreateObject<LocalClock> ();
+  m_clock -> SetAttribute ("ClockModel", PointerValue (model));
+  node -> AggregateObject (m_clock);
+
+  uint32_t n = 2000;
+  m_runs.assign (n, 0);
+  m_rescheduled = 0;
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (0), &TombstoneTestCase::Start, this);
+  //Every update reschedules the events that are still pending
+  for (uint32_t i = 1; i < 8; ++i)
+    {
+      Simulator::ScheduleWithContext (node -> GetId (), MilliSeconds (100 * i) + MicroSeconds (500),
+                                      &TombstoneTestCase::Update, this, i % 2 ? 2 : 1);
+    }
+  Ptr<LocalTimeSimulatorImpl> impl = DynamicCast<LocalTimeSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_ASSERT_MSG_NE (impl, 0, "Not using the local-time simulator");
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_runs[i], 1, "Event " << i << " did not run exactly once");
+      NS_TEST_ASSERT_MSG_EQ (m_ids[i].IsExpired (), true, "Event " << i << " is still pending");
+    }
+  NS_TEST_EXPECT_MSG_LT (impl -> GetTombstoneCount (), m_rescheduled / 2, "Tombstones have not been collected");
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks that nodes without clock schedule in global time and that a clock aggregated while
+* the simulation runs is used for the next events of the node.
+*/
+class ClockTableTestCase : public TestCase
+{
+public:
+  ClockTableTestCase ();
+  virtual ~ClockTableTestCase ();
+  virtual void DoRun (void);
+
+  void Start (Time delay, Time expected);
+  void Check (Time expected);
+  void AddClock (double freq);
+
+  Ptr<Node> m_node;
+  uint32_t m_checks;
+};
+
+ClockTableTestCase::ClockTableTestCase ()
+  : TestCase ("Check the clock lookup of nodes with and without clock")
+{
+}
+
+ClockTableTestCase::~ClockTableTestCase ()
+{
+}
+
+void
+ClockTableTestCase::Start (Time delay, Time expected)
+{
+  Simulator::Schedule (delay, &ClockTableTestCase::Check, this, expected);
+}
+
+void
+ClockTableTestCase::Check (Time expected)
+{
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), expected, "Wrong global time");
+  m_checks++;
+}
+
+void
+ClockTableTestCase::AddClock (double freq)
+{
+  Ptr<ClockModel> model = CreateObject<PerfectClockModelImpl> ();
+  model -> SetAttribute ("Frequency", DoubleValue (freq));
+  Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+  clock -> SetAttribute ("ClockModel", PointerValue (model));
+  m_node -> AggregateObject (clock);
+}
+
+void
+ClockTableTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  m_node = CreateObject<Node> ();
+  m_checks = 0;
+
+  //Without clock the delay is a global delay
+  Simulator::ScheduleWithContext (m_node -> GetId (), Seconds (1), &ClockTableTestCase::Start, this, Seconds (2), Seconds (3));
+  //Local time runs twice as fast as global time once the clock is aggregated
+  Simulator::ScheduleWithContext (m_node -> GetId (), Seconds (4), &ClockTableTestCase::AddClock, this, 2);
+  Simulator::ScheduleWithContext (m_node -> GetId (), Seconds (5), &ClockTableTestCase::Start, this, Seconds (2), Seconds (6));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_checks, 2, "Events did not run");
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks that the conversions of PerfectClockModelImpl are exact over a 10^9 seconds horizon:
+* converting back and forth gives the original time, and the fused delay conversion matches the absolute conversions.
+*/
+class ClockConversionTestCase : public TestCase
+{
+public:
+  ClockConversionTestCase ();
+  virtual ~ClockConversionTestCase ();
+  virtual void DoRun (void);
+};
+
+ClockConversionTestCase::ClockConversionTestCase ()
+  : TestCase ("Check that the fixed-point conversions of the perfect clock are exact")
+{
+}
+
+ClockConversionTestCase::~ClockConversionTestCase ()
+{
+}
+
+void
+ClockConversionTestCase::DoRun (void)
+{
+  double frequencies[] = {0.25, 0.5, 0.999999, 1, 1.000001, 1.0001, 2, 3.3};
+  Time offsets[] = {Seconds (0), Seconds (-1.5), NanoSeconds (123456789)};
+  int64_t horizon = Seconds (1e9).GetTimeStep ();
+
+  for (uint32_t f = 0; f < sizeof (frequencies) / sizeof (double); ++f)
+    {
+      for (uint32_t o = 0; o < sizeof (offsets) / sizeof (Time); ++o)
+        {
+          Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+          model -> SetAttribute ("Frequency", DoubleValue (frequencies[f]));
+          model -> SetAttribute ("Offset", TimeValue (offsets[o]));
+          //The clock converts the delays inline, without the virtual calls to the model
+          Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+          clock -> SetAttribute ("ClockModel", PointerValue (model));
+
+          for (uint64_t i = 0; i < 2000; ++i)
+            {
+              Time global = TimeStep ((i * 0x9E3779B97F4A7C15ULL) % horizon);
+              Time local = model -> GlobalToLocalTime (global);
+              for (int64_t sign = -1; sign <= 1; sign += 2)
+                {
+                  int64_t ts = sign * global.GetTimeStep ();
+                  NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (TimeStep (ts)),
+                                         TimeStep ((int64x64_t (frequencies[f]) * int64x64_t (ts)).GetHigh ()) + offsets[o],
+                                         "Product by the frequency differs from int64x64_t at " << ts);
+                }
+              Time back = model -> LocalToGlobalTime (local);
+              NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (back), local, "Global time does not map back to " << local);
+              NS_TEST_ASSERT_MSG_LT (model -> GlobalToLocalTime (back - TimeStep (1)), local, "Not the earliest global time of " << local);
+              if (frequencies[f] >= 1)
+                {
+                  NS_TEST_ASSERT_MSG_EQ (back, global, "Round trip of global time " << global << " with frequency " << frequencies[f]);
+                }
+              else
+                {
+                  Time localOnly = TimeStep ((i * 0xC2B2AE3D27D4EB4FULL) % horizon);
+                  NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (model -> LocalToGlobalTime (localOnly)), localOnly,
+                                         "Round trip of local time " << localOnly << " with frequency " << frequencies[f]);
+                }
+
+              Time delay = TimeStep ((i * 0xD6E8FEB86659FD93ULL) % (horizon / 1000));
+              Time expected = Max (model -> LocalToGlobalTime (local + delay) - global, Time (0));
+              NS_TEST_ASSERT_MSG_EQ (model -> LocalDelayToGlobalDelay (global, delay), expected, "Wrong fused delay conversion");
+              NS_TEST_ASSERT_MSG_EQ (model -> GlobalDelayToLocalDelay (global, delay),
+                                     model -> GlobalToLocalTime (global + delay) - local, "Wrong fused delay conversion");
+              NS_TEST_ASSERT_MSG_EQ (clock -> LocalDelayToGlobalDelay (global, delay), expected, "Wrong inline delay conversion");
+              NS_TEST_ASSERT_MSG_EQ (clock -> GlobalDelayToLocalDelay (global, delay),
+                                     model -> GlobalDelayToLocalDelay (global, delay), "Wrong inline delay conversion");
+            }
+        }
+    }
+}
+
+/**
+* This test checks the piecewise clock model: segment lookup in both directions, steps of the local time,
+* loading the trajectory from a file, appending segments while the simulation runs and scheduling across segments.
+*/
+class PiecewiseClockTestCase : public TestCase
+{
+public:
+  PiecewiseClockTestCase ();
+  virtual ~PiecewiseClockTestCase ();
+  virtual void DoRun (void);
+
+  void CheckModel (Ptr<PiecewiseClockModelImpl> model);
+  void Start (Time delay, Time expected);
+  void Check (Time expected);
+  void Append (Ptr<PiecewiseClockModelImpl> model);
+
+  uint32_t m_checks;
+};
+
+PiecewiseClockTestCase::PiecewiseClockTestCase ()
+  : TestCase ("Check the piecewise clock model")
+{
+}
+
+PiecewiseClockTestCase::~PiecewiseClockTestCase ()
+{
+}
+
+void
+PiecewiseClockTestCase::CheckModel (Ptr<PiecewiseClockModelImpl> model)
+{
+  NS_TEST_ASSERT_MSG_EQ (model -> GetNSegments (), 3, "Wrong number of segments");
+  NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (Seconds (5)), Seconds (5), "Wrong local time in first segment");
+  NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (Seconds (15)), Seconds (12.5), "Wrong local time in second segment");
+  NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (Seconds (25)), Seconds (40), "Wrong local time in third segment");
+  NS_TEST_ASSERT_MSG_EQ (model -> LocalToGlobalTime (Seconds (12.5)), Seconds (15), "Wrong global time in second segment");
+  NS_TEST_ASSERT_MSG_EQ (model -> LocalToGlobalTime (Seconds (40)), Seconds (25), "Wrong global time in third segment");
+  //Local times skipped by the step are reached at the start of the third segment
+  NS_TEST_ASSERT_MSG_EQ (model -> LocalToGlobalTime (Seconds (20)), Seconds (20), "Wrong global time in the step");
+
+  for (uint64_t i = 0; i < 2000; ++i)
+    {
+      Time global = TimeStep ((i * 0x9E3779B97F4A7C15ULL) % Seconds (40).GetTimeStep ());
+      Time local = model -> GlobalToLocalTime (global);
+      Time back = model -> LocalToGlobalTime (local);
+      NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (back), local, "Global time does not map back to " << local);
+      NS_TEST_ASSERT_MSG_LT (model -> GlobalToLocalTime (back - TimeStep (1)), local, "Not the earliest global time of " << local);
+    }
+}
+
+void
+PiecewiseClockTestCase::Start (Time delay, Time expected)
+{
+  Simulator::Schedule (delay, &PiecewiseClockTestCase::Check, this, expected);
+}
+
+void
+PiecewiseClockTestCase::Check (Time expected)
+{
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), expected, "Wrong global time");
+  m_checks++;
+}
+
+void
+PiecewiseClockTestCase::Append (Ptr<PiecewiseClockModelImpl> model)
+{
+  model -> AddSegment (Seconds (30), 1);
+  NS_TEST_EXPECT_MSG_EQ (model -> GetNSegments (), 4, "Segment not appended");
+  NS_TEST_EXPECT_MSG_EQ (model -> GlobalToLocalTime (Seconds (35)), Seconds (55), "Wrong local time in appended segment");
+}
+
+void
+PiecewiseClockTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+
+  Ptr<PiecewiseClockModelImpl> model = CreateObject<PiecewiseClockModelImpl> ();
+  std::vector<PiecewiseClockModelImpl::Segment> segments (3);
+  segments[0].globalStart = Seconds (0);
+  segments[0].localStart = Seconds (0);
+  segments[0].frequency = 1;
+  segments[1].globalStart = Seconds (10);
+  segments[1].localStart = Seconds (10);
+  segments[1].frequency = 0.5;
+  segments[2].globalStart = Seconds (20);
+  segments[2].localStart = Seconds (30);
+  segments[2].frequency = 2;
+  model -> AddSegments (segments);
+  CheckModel (model);
+
+  std::string filename = CreateTempDirFilename ("clock-trajectory.txt");
+  std::ofstream file (filename.c_str ());
+  file << "# global local frequency" << std::endl;
+  file << "0 1" << std::endl;
+  file << std::endl;
+  file << "10 0.5" << std::endl;
+  file << "20 30 2" << std::endl;
+  file.close ();
+  Ptr<PiecewiseClockModelImpl> loaded = CreateObject<PiecewiseClockModelImpl> ();
+  loaded -> LoadSegments (filename);
+  CheckModel (loaded);
+
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+  clock -> SetAttribute ("ClockModel", PointerValue (model));
+  node -> AggregateObject (clock);
+  m_checks = 0;
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (0), &PiecewiseClockTestCase::Start, this, Seconds (12.5), Seconds (15));
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (0), &PiecewiseClockTestCase::Start, this, Seconds (40), Seconds (25));
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (1), &PiecewiseClockTestCase::Append, this, model);
+  //Scheduled after the segment is appended: local 55 s is reached at global 35 s
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (2), &PiecewiseClockTestCase::Start, this, Seconds (53), Seconds (35));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_checks, 3, "Events did not run");
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks that the stochastic clock model is reproducible, that its conversions are exact inverses,
+* and that the number of steps it keeps in memory is bounded during a long simulation.
+*/
+class StochasticClockTestCase : public TestCase
+{
+public:
+  StochasticClockTestCase ();
+  virtual ~StochasticClockTestCase ();
+  virtual void DoRun (void);
+
+  Ptr<StochasticClockModelImpl> CreateModel (int64_t stream);
+  void Tick (Ptr<StochasticClockModelImpl> model);
+
+  uint32_t m_ticks;
+  uint32_t m_maxSteps;
+};
+
+StochasticClockTestCase::StochasticClockTestCase ()
+  : TestCase ("Check the stochastic clock model")
+{
+}
+
+StochasticClockTestCase::~StochasticClockTestCase ()
+{
+}
+
+Ptr<StochasticClockModelImpl>
+StochasticClockTestCase::CreateModel (int64_t stream)
+{
+  Ptr<StochasticClockModelImpl> model = CreateObject<StochasticClockModelImpl> ();
+  model -> SetAttribute ("Step", TimeValue (MilliSeconds (10)));
+  model -> SetAttribute ("WhiteFrequencyNoise", DoubleValue (1e-4));
+  model -> SetAttribute ("RandomWalkFrequencyNoise", DoubleValue (1e-5));
+  model -> SetAttribute ("BlockSize", UintegerValue (64));
+  model -> SetAttribute ("Window", UintegerValue (2));
+  model -> AssignStreams (stream);
+  return model;
+}
+
+void
+StochasticClockTestCase::Tick (Ptr<StochasticClockModelImpl> model)
+{
+  m_ticks++;
+  m_maxSteps = std::max (m_maxSteps, model -> GetNSteps ());
+  Simulator::Schedule (MilliSeconds (100), &StochasticClockTestCase::Tick, this, model);
+}
+
+void
+StochasticClockTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+
+  Ptr<StochasticClockModelImpl> model = CreateModel (7);
+  Ptr<StochasticClockModelImpl> same = CreateModel (7);
+  Ptr<StochasticClockModelImpl> other = CreateModel (8);
+  for (uint64_t i = 0; i < 2000; ++i)
+    {
+      Time global = TimeStep ((i * 0x9E3779B97F4A7C15ULL) % Seconds (20).GetTimeStep ());
+      Time local = model -> GlobalToLocalTime (global);
+      NS_TEST_ASSERT_MSG_EQ (same -> GlobalToLocalTime (global), local, "Same stream, different trajectory");
+      Time back = model -> LocalToGlobalTime (local);
+      NS_TEST_ASSERT_MSG_EQ (model -> GlobalToLocalTime (back), local, "Global time does not map back to " << local);
+      NS_TEST_ASSERT_MSG_LT (model -> GlobalToLocalTime (back - TimeStep (1)), local, "Not the earliest global time of " << local);
+    }
+  NS_TEST_ASSERT_MSG_NE (other -> GlobalToLocalTime (Seconds (20)), model -> GlobalToLocalTime (Seconds (20)),
+                         "Different streams, same trajectory");
+  Time previous = model -> GlobalToLocalTime (Seconds (0));
+  for (uint32_t i = 1; i < 2000; ++i)
+    {
+      Time local = model -> GlobalToLocalTime (MilliSeconds (i));
+      NS_TEST_ASSERT_MSG_GT (local, previous, "Local time does not increase");
+      previous = local;
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (model -> GetFrequency (Seconds (10)), 1, 0.01, "Frequency too far from the nominal one");
+
+  Ptr<StochasticClockModelImpl> running = CreateModel (9);
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+  clock -> SetAttribute ("ClockModel", PointerValue (running));
+  node -> AggregateObject (clock);
+  m_ticks = 0;
+  m_maxSteps = 0;
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (0), &StochasticClockTestCase::Tick, this, running);
+  Simulator::Stop (Seconds (100));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_ticks, 1000, 10, "Wrong number of ticks in local time");
+  //The window and the block being generated
+  NS_TEST_EXPECT_MSG_LT_OR_EQ (m_maxSteps, 3 * 64, "Too many steps in memory");
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks that a group of clocks updated at the same instant, either in place or with new models,
+* reschedules the pending events of each node at the right time and in the context of the node.
+*/
+class BatchUpdateTestCase : public TestCase
+{
+public:
+  BatchUpdateTestCase ();
+  virtual ~BatchUpdateTestCase ();
+  virtual void DoRun (void);
+
+  void Start (uint32_t i);
+  void Event (uint32_t i, Time expected);
+  void Update (void);
+
+  std::vector<Ptr<LocalClock> > m_clocks;
+  std::vector<EventId> m_ids;
+  uint32_t m_checks;
+};
+
+BatchUpdateTestCase::BatchUpdateTestCase ()
+  : TestCase ("Check that batched clock updates reschedule the events of every node")
+{
+}
+
+BatchUpdateTestCase::~BatchUpdateTestCase ()
+{
+}
+
+void
+BatchUpdateTestCase::Start (uint32_t i)
+{
+  Time expected[] = {Seconds (6), Seconds (18), Seconds (6)};
+  m_ids[i] = Simulator::Schedule (Seconds (10), &BatchUpdateTestCase::Event, this, i, expected[i]);
+}
+
+void
+BatchUpdateTestCase::Event (uint32_t i, Time expected)
+{
+  NS_TEST_EXPECT_MSG_EQ (Simulator::Now (), expected, "Wrong global time for node " << i);
+  NS_TEST_EXPECT_MSG_EQ (Simulator::GetContext (), i, "Event run in the wrong context");
+  m_checks++;
+}
+
+void
+BatchUpdateTestCase::Update (void)
+{
+  //Speed up node 0 and slow down node 1 without a step of their local time at 2s
+  std::vector<LocalClock::Adjustment> adjustments (2);
+  adjustments[0].clock = m_clocks[0];
+  adjustments[0].frequency = 2;
+  adjustments[0].offset = Seconds (-2);
+  adjustments[1].clock = m_clocks[1];
+  adjustments[1].frequency = 0.5;
+  adjustments[1].offset = Seconds (1);
+  LocalClock::AdjustClocks (adjustments);
+  NS_TEST_EXPECT_MSG_EQ (m_clocks[0] -> GetLocalTime (), Seconds (2), "Adjusted clock stepped");
+  NS_TEST_EXPECT_MSG_EQ (m_clocks[1] -> GetLocalTime (), Seconds (2), "Adjusted clock stepped");
+
+  Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+  model -> SetFrequency (2);
+  model -> SetOffset (Seconds (-2));
+  LocalClock::SetClocks (std::vector<Ptr<LocalClock> > (1, m_clocks[2]), std::vector<Ptr<ClockModel> > (1, model));
+
+  for (uint32_t i = 0; i < m_ids.size (); ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ids[i].IsExpired (), false, "Rescheduled event " << i << " has expired");
+    }
+}
+
+void
+BatchUpdateTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  m_checks = 0;
+  m_ids.resize (3);
+  for (uint32_t i = 0; i < 3; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<ClockModel> model = CreateObject<PerfectClockModelImpl> ();
+      Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+      clock -> SetAttribute ("ClockModel", PointerValue (model));
+      node -> AggregateObject (clock);
+      m_clocks.push_back (clock);
+      Simulator::ScheduleWithContext (node -> GetId (), Seconds (0), &BatchUpdateTestCase::Start, this, i);
+    }
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (2), &BatchUpdateTestCase::Update, this);
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < m_ids.size (); ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_ids[i].IsExpired (), true, "Event " << i << " is still pending");
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_checks, 3, "Events did not run");
+  m_clocks.clear ();
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks that re-timing the events lazily, when they reach the head of the scheduler, dispatches
+* the same events at the same times and in the same order as rescheduling them when the clocks are updated.
+* The updates mix slowdowns, which are lazy, and speed-ups, which fall back to rescheduling. The updates of
+* node 0 run on it, and a sink of them schedules an event on it, which must not break the uid order of its events.
+*/
+class LazyReschedulingTestCase : public TestCase
+{
+public:
+  LazyReschedulingTestCase ();
+  virtual ~LazyReschedulingTestCase ();
+  virtual void DoRun (void);
+
+  /** Dispatch of an event: tag of the event and global time. */
+  typedef std::vector<std::pair<uint32_t, int64_t> > Trace;
+
+  void Run (bool lazy, Trace &trace);
+  void Start (uint32_t node);
+  void Event (uint32_t node, uint32_t tag, uint32_t hops);
+  void SetFrequencies (double frequency);
+  void Adjust (uint32_t node, double frequency, Time offset);
+  void CancelFirst (void);
+  void ClockUpdate (Time oldLocalTime, Time newLocalTime);
+  void EventRescheduled (Time oldTs, Time newTs);
+  Time NextDelay (void);
+
+  std::vector<Ptr<LocalClock> > m_clocks;
+  std::vector<EventId> m_first;
+  Trace *m_trace;
+  uint32_t m_tags;
+  uint64_t m_seed;
+  bool m_rescheduled;
+};
+
+LazyReschedulingTestCase::LazyReschedulingTestCase ()
+  : TestCase ("Check that lazy rescheduling dispatches events as eager rescheduling")
+{
+}
+
+LazyReschedulingTestCase::~LazyReschedulingTestCase ()
+{
+}
+
+Time
+LazyReschedulingTestCase::NextDelay (void)
+{
+  m_seed = m_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return NanoSeconds ((m_seed >> 33) % 400000000);
+}
+
+void
+LazyReschedulingTestCase::Start (uint32_t node)
+{
+  for (uint32_t i = 0; i < 200; ++i)
+    {
+      EventId id = Simulator::Schedule (NextDelay (), &LazyReschedulingTestCase::Event, this, node, m_tags++, 3);
+      if (i == 0)
+        {
+          m_first.push_back (id);
+        }
+    }
+}
+
+void
+LazyReschedulingTestCase::Event (uint32_t node, uint32_t tag, uint32_t hops)
+{
+  NS_TEST_EXPECT_MSG_EQ (Simulator::GetContext (), node, "Event run in the wrong context");
+  m_trace->push_back (std::make_pair (tag, Simulator::Now ().GetTimeStep ()));
+  if (hops > 0)
+    {
+      Simulator::Schedule (NextDelay (), &LazyReschedulingTestCase::Event, this, node, m_tags++, hops - 1);
+    }
+}
+
+void
+LazyReschedulingTestCase::SetFrequencies (double frequency)
+{
+  std::vector<Ptr<ClockModel> > models;
+  for (uint32_t i = 0; i < m_clocks.size (); ++i)
+    {
+      Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+      model -> SetFrequency (frequency);
+      models.push_back (model);
+    }
+  LocalClock::SetClocks (m_clocks, models);
+}
+
+void
+LazyReschedulingTestCase::Adjust (uint32_t node, double frequency, Time offset)
+{
+  m_clocks[node] -> AdjustClock (frequency, offset);
+}
+
+void
+LazyReschedulingTestCase::CancelFirst (void)
+{
+  for (uint32_t i = 0; i < m_first.size (); ++i)
+    {
+      Simulator::Cancel (m_first[i]);
+    }
+}
+
+void
+LazyReschedulingTestCase::ClockUpdate (Time, Time)
+{
+  //Only the updates run by node 0 schedule on its clock, an event still pending at the next update
+  if (Simulator::GetContext () == 0)
+    {
+      Simulator::Schedule (MilliSeconds (150), &LazyReschedulingTestCase::Event, this, 0, m_tags++, 0);
+    }
+}
+
+void
+LazyReschedulingTestCase::EventRescheduled (Time, Time)
+{
+  //The speedup of node 0 at 300.5ms moves its events in both modes, the first move schedules an event
+  //that is still pending at the next slowdown
+  if (Simulator::GetContext () == 0 && Simulator::Now () == MicroSeconds (300500) && !m_rescheduled)
+    {
+      m_rescheduled = true;
+      Simulator::Schedule (MilliSeconds (150), &LazyReschedulingTestCase::Event, this, 0, m_tags++, 0);
+    }
+}
+
+void
+LazyReschedulingTestCase::Run (bool lazy, Trace &trace)
+{
+  Config::SetDefault ("ns3::LocalTimeSimulatorImpl::LazyRescheduling", BooleanValue (lazy));
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  m_trace = &trace;
+  m_tags = 0;
+  m_seed = 12345;
+  m_rescheduled = false;
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<ClockModel> model = CreateObject<PerfectClockModelImpl> ();
+      Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+      clock -> SetAttribute ("ClockModel", PointerValue (model));
+      node -> AggregateObject (clock);
+      m_clocks.push_back (clock);
+      Simulator::ScheduleWithContext (node -> GetId (), Seconds (0), &LazyReschedulingTestCase::Start, this, i);
+    }
+  Ptr<LocalTimeSimulatorImpl> impl = DynamicCast<LocalTimeSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_ASSERT_MSG_EQ (impl -> IsLazyRescheduling (), lazy, "Wrong rescheduling mode");
+  m_clocks[0] -> TraceConnectWithoutContext ("ClockUpdate", MakeCallback (&LazyReschedulingTestCase::ClockUpdate, this));
+  m_clocks[0] -> TraceConnectWithoutContext ("EventRescheduled", MakeCallback (&LazyReschedulingTestCase::EventRescheduled, this));
+
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MicroSeconds (100500), &LazyReschedulingTestCase::SetFrequencies, this, 0.9);
+  Simulator::ScheduleWithContext (0, MicroSeconds (200500), &LazyReschedulingTestCase::Adjust, this, 0, 0.8, MilliSeconds (20));
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MicroSeconds (200500), &LazyReschedulingTestCase::Adjust, this, 1, 0.9, MilliSeconds (-5));
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MicroSeconds (250000), &LazyReschedulingTestCase::CancelFirst, this);
+  Simulator::ScheduleWithContext (0, MicroSeconds (300500), &LazyReschedulingTestCase::Adjust, this, 0, 1.2, Seconds (0));
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MicroSeconds (300500), &LazyReschedulingTestCase::Adjust, this, 1, 0.7, Seconds (0));
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MicroSeconds (400500), &LazyReschedulingTestCase::SetFrequencies, this, 1.1);
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MicroSeconds (500500), &LazyReschedulingTestCase::SetFrequencies, this, 0.5);
+  Simulator::ScheduleWithContext (0, MicroSeconds (600500), &LazyReschedulingTestCase::Adjust, this, 0, 0.4, Seconds (1));
+  Simulator::Run ();
+
+  for (uint32_t i = 0; i < m_first.size (); ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_first[i].IsExpired (), true, "Cancelled event is still pending");
+    }
+  m_clocks.clear ();
+  m_first.clear ();
+  Simulator::Destroy ();
+}
+
+void
+LazyReschedulingTestCase::DoRun (void)
+{
+  Trace eager;
+  Trace lazy;
+  Run (false, eager);
+  Run (true, lazy);
+  Config::SetDefault ("ns3::LocalTimeSimulatorImpl::LazyRescheduling", BooleanValue (false));
+
+  NS_TEST_ASSERT_MSG_EQ (lazy.size (), eager.size (), "Different number of events dispatched");
+  //Each of the 3 updates run by node 0 adds an event, and so does the first event it moves at 300.5ms
+  NS_TEST_ASSERT_MSG_LT (eager.size (), 2 * 200 * 4 + 4, "Cancelled events have run");
+  NS_TEST_ASSERT_MSG_EQ (m_rescheduled, true, "No event moved at 300.5ms");
+  for (uint32_t i = 0; i < eager.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (lazy[i].first, eager[i].first, "Different event dispatched at position " << i);
+      NS_TEST_ASSERT_MSG_EQ (lazy[i].second, eager[i].second, "Event " << eager[i].first << " dispatched at a different time");
+    }
+}
+
+class MultithreadedTestCase : public TestCase
+{
+public:
+  MultithreadedTestCase ();
+  virtual ~MultithreadedTestCase ();
+  virtual void DoRun (void);
+
+  /** Dispatch of an event: tag of the event and global time. */
+  typedef std::vector<std::pair<uint32_t, int64_t> > Trace;
+  /** State of a node, only touched by the events of the node. */
+  struct NodeState
+  {
+    uint64_t seed;
+    uint32_t tags;
+    uint32_t wrongContext;
+    Trace trace;
+  };
+
+  void Run (uint32_t partitions);
+  void Start (uint32_t node);
+  void Event (uint32_t node, uint32_t tag, uint32_t hops);
+  void Adjust (uint32_t node);
+  Time NextDelay (uint32_t node);
+
+  std::vector<Ptr<LocalClock> > m_clocks;
+  std::vector<NodeState> m_nodes;
+};
+
+MultithreadedTestCase::MultithreadedTestCase ()
+  : TestCase ("Check that the multithreaded simulator dispatches the events of each node as the single-threaded one")
+{
+}
+
+MultithreadedTestCase::~MultithreadedTestCase ()
+{
+}
+
+Time
+MultithreadedTestCase::NextDelay (uint32_t node)
+{
+  uint64_t &seed = m_nodes[node].seed;
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return NanoSeconds ((seed >> 33) % 50000000);
+}
+
+void
+MultithreadedTestCase::Start (uint32_t node)
+{
+  for (uint32_t i = 0; i < 50; ++i)
+    {
+      Simulator::Schedule (NextDelay (node), &MultithreadedTestCase::Event, this, node, node * 100000 + m_nodes[node].tags++, 20);
+    }
+}
+
+void
+MultithreadedTestCase::Event (uint32_t node, uint32_t tag, uint32_t hops)
+{
+  NodeState &state = m_nodes[node];
+  if (Simulator::GetContext () != node)
+    {
+      state.wrongContext++;
+    }
+  state.trace.push_back (std::make_pair (tag, Simulator::Now ().GetTimeStep ()));
+  if (hops == 0)
+    {
+      return;
+    }
+  uint32_t next = node * 100000 + state.tags++;
+  Time delay = NextDelay (node);
+  if (delay.GetNanoSeconds () % 4 == 0)
+    {
+      //Channel-like delay to another node, in global time and not smaller than the lookahead
+      uint32_t to = (node + 1 + delay.GetNanoSeconds () % 3) % m_nodes.size ();
+      Simulator::ScheduleWithContext (to, MilliSeconds (1) + delay, &MultithreadedTestCase::Event, this, to, next, hops - 1);
+    }
+  else
+    {
+      Simulator::Schedule (delay, &MultithreadedTestCase::Event, this, node, next, hops - 1);
+    }
+}
+
+void
+MultithreadedTestCase::Adjust (uint32_t node)
+{
+  m_clocks[node] -> AdjustClock (1 + 0.05 * node, MilliSeconds (node));
+}
+
+void
+MultithreadedTestCase::Run (uint32_t partitions)
+{
+  if (partitions == 0)
+    {
+      GlobalValue::Bind ("SimulatorImplementationType", 
+                         StringValue ("ns3::LocalTimeSimulatorImpl"));
+    }
+  else
+    {
+      Config::SetDefault ("ns3::MultithreadedLocalTimeSimulatorImpl::Partitions", UintegerValue (partitions));
+      Config::SetDefault ("ns3::MultithreadedLocalTimeSimulatorImpl::LookAhead", TimeValue (MilliSeconds (1)));
+      GlobalValue::Bind ("SimulatorImplementationType", 
+                         StringValue ("ns3::MultithreadedLocalTimeSimulatorImpl"));
+    }
+  m_nodes.assign (4, NodeState ());
+  for (uint32_t i = 0; i < m_nodes.size (); ++i)
+    {
+      m_nodes[i].seed = 1000 + i;
+      m_nodes[i].tags = 0;
+      m_nodes[i].wrongContext = 0;
+      Ptr<Node> node = CreateObject<Node> ();
+      NS_TEST_ASSERT_MSG_EQ (node -> GetId (), i, "Unexpected node id");
+      Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+      model -> SetFrequency (1 - 0.05 * i);
+      Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+      clock -> SetAttribute ("ClockModel", PointerValue (model));
+      node -> AggregateObject (clock);
+      m_clocks.push_back (clock);
+      Simulator::ScheduleWithContext (i, Seconds (0), &MultithreadedTestCase::Start, this, i);
+      Simulator::ScheduleWithContext (i, MicroSeconds (300500), &MultithreadedTestCase::Adjust, this, i);
+    }
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  Ptr<MultithreadedLocalTimeSimulatorImpl> impl = DynamicCast<MultithreadedLocalTimeSimulatorImpl> (Simulator::GetImplementation ());
+  if (partitions != 0)
+    {
+      NS_TEST_ASSERT_MSG_EQ (impl -> GetNPartitions (), partitions, "Wrong number of partitions");
+      NS_TEST_ASSERT_MSG_EQ (impl -> GetLookAhead (), MilliSeconds (1), "Wrong lookahead");
+    }
+  m_clocks.clear ();
+  Simulator::Destroy ();
+}
+
+void
+MultithreadedTestCase::DoRun (void)
+{
+  Run (0);
+  std::vector<NodeState> reference = m_nodes;
+  for (uint32_t partitions = 1; partitions <= 3; ++partitions)
+    {
+      Run (partitions);
+      for (uint32_t i = 0; i < m_nodes.size (); ++i)
+        {
+          const Trace &trace = m_nodes[i].trace;
+          NS_TEST_ASSERT_MSG_EQ (m_nodes[i].wrongContext, 0, "Event run in the wrong context");
+          NS_TEST_ASSERT_MSG_EQ (trace.size (), reference[i].trace.size (), "Different number of events dispatched by node " << i
+                                 << " with " << partitions << " partitions");
+          for (uint32_t j = 0; j < trace.size (); ++j)
+            {
+              NS_TEST_ASSERT_MSG_EQ (trace[j].first, reference[i].trace[j].first, "Different event dispatched by node " << i
+                                     << " at position " << j << " with " << partitions << " partitions");
+              NS_TEST_ASSERT_MSG_EQ (trace[j].second, reference[i].trace[j].second, "Event " << trace[j].first
+                                     << " dispatched at a different time with " << partitions << " partitions");
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_GT (reference[0].trace.size (), 200, "Too few events dispatched");
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+}
+
+/**
+* This test checks the records of the clock traces: periodic samples of the local time,
+* clock updates and events rescheduled by an update, written in blocks and read back.
+*/
+class ClockTraceTestCase : public TestCase
+{
+public:
+  ClockTraceTestCase ();
+  virtual ~ClockTraceTestCase ();
+  virtual void DoRun (void);
+
+  void Start (void);
+  void Event (void);
+};
+
+ClockTraceTestCase::ClockTraceTestCase ()
+  : TestCase ("Check the binary traces of the clocks")
+{
+}
+
+ClockTraceTestCase::~ClockTraceTestCase ()
+{
+}
+
+void
+ClockTraceTestCase::Start (void)
+{
+  Simulator::Schedule (Seconds (10), &ClockTraceTestCase::Event, this);
+}
+
+void
+ClockTraceTestCase::Event (void)
+{
+}
+
+void
+ClockTraceTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  NodeContainer nodes;
+  double frequencies[] = {1, 2};
+  Time offsets[] = {Seconds (0), Seconds (1)};
+  std::vector<Ptr<LocalClock> > clocks;
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+      model -> SetFrequency (frequencies[i]);
+      model -> SetOffset (offsets[i]);
+      Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+      clock -> SetAttribute ("ClockModel", PointerValue (model));
+      node -> AggregateObject (clock);
+      nodes.Add (node);
+      clocks.push_back (clock);
+    }
+  Simulator::ScheduleWithContext (nodes.Get (0) -> GetId (), Seconds (0), &ClockTraceTestCase::Start, this);
+  //The clock of node 0 steps from 2.5s to 3s and runs twice as fast
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, MilliSeconds (2500), &LocalClock::AdjustClock, clocks[0], 2, Seconds (-2));
+  Simulator::Stop (Seconds (5));
+
+  std::string filename = CreateTempDirFilename ("clock-trace.bin");
+  ClockTraceHelper helper;
+  helper.SetBlockSize (4);
+  Ptr<ClockTraceFile> file = helper.EnableTracing (filename, nodes, Seconds (1));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (file -> GetNRecords (), 12, "Wrong number of records");
+  Simulator::Destroy ();
+
+  std::vector<ClockTraceFile::Record> records;
+  NS_TEST_ASSERT_MSG_EQ (ClockTraceFile::Read (filename, records), true, "Unable to read the trace file");
+  NS_TEST_ASSERT_MSG_EQ (records.size (), 12, "Records lost");
+  uint32_t samples = 0;
+  for (uint32_t i = 0; i < records.size (); ++i)
+    {
+      const ClockTraceFile::Record &record = records[i];
+      uint32_t node = record.node == nodes.Get (0) -> GetId () ? 0 : 1;
+      NS_TEST_ASSERT_MSG_EQ (record.node, nodes.Get (node) -> GetId (), "Unknown node " << record.node);
+      if (record.type == ClockTraceFile::SAMPLE)
+        {
+          Time global = TimeStep (record.global);
+          Time expected = frequencies[node] * global + offsets[node];
+          if (node == 0 && global > MilliSeconds (2500))
+            {
+              expected = 2 * global - Seconds (2);
+            }
+          NS_TEST_EXPECT_MSG_EQ (TimeStep (record.a), expected, "Wrong local time of node " << node << " at " << global);
+          samples++;
+        }
+      else if (record.type == ClockTraceFile::CLOCK_UPDATE)
+        {
+          NS_TEST_EXPECT_MSG_EQ (node, 0, "Update of the wrong clock");
+          NS_TEST_EXPECT_MSG_EQ (TimeStep (record.global), MilliSeconds (2500), "Wrong time of the update");
+          NS_TEST_EXPECT_MSG_EQ (TimeStep (record.a), MilliSeconds (2500), "Wrong local time before the update");
+          NS_TEST_EXPECT_MSG_EQ (TimeStep (record.b), Seconds (3), "Wrong local time after the update");
+        }
+      else
+        {
+          //The 7.5s of local time left before the event take 3.75s at the new frequency
+          NS_TEST_EXPECT_MSG_EQ ((uint32_t) record.type, ClockTraceFile::EVENT_RESCHEDULED, "Unknown record type");
+          NS_TEST_EXPECT_MSG_EQ (node, 0, "Event of the wrong clock rescheduled");
+          NS_TEST_EXPECT_MSG_EQ (TimeStep (record.a), Seconds (10), "Wrong time of the event before the update");
+          NS_TEST_EXPECT_MSG_EQ (TimeStep (record.b), MilliSeconds (6250), "Wrong time of the event after the update");
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (samples, 10, "Samples lost");
+}
+
+/**
+* This test checks that ClockHelper installs a clock with its own model on every node,
+* with the frequencies and offsets of the random variables, and that the simulator uses them.
+*/
+class ClockHelperTestCase : public TestCase
+{
+public:
+  ClockHelperTestCase ();
+  virtual ~ClockHelperTestCase ();
+  virtual void DoRun (void);
+
+  void Start (uint32_t i);
+  void Event (uint32_t i);
+
+  std::vector<Ptr<LocalClock> > m_clocks;
+  uint32_t m_checks;
+};
+
+ClockHelperTestCase::ClockHelperTestCase ()
+  : TestCase ("Check the installation of clocks by ClockHelper")
+{
+}
+
+ClockHelperTestCase::~ClockHelperTestCase ()
+{
+}
+
+void
+ClockHelperTestCase::Start (uint32_t i)
+{
+  Simulator::Schedule (Seconds (1), &ClockHelperTestCase::Event, this, i);
+}
+
+void
+ClockHelperTestCase::Event (uint32_t i)
+{
+  //The event runs at the first global time step at which the local time has reached 2s
+  NS_TEST_EXPECT_MSG_GT_OR_EQ (m_clocks[i] -> GetLocalTime (), Seconds (2), "Event of node " << i << " run early");
+  NS_TEST_EXPECT_MSG_LT (m_clocks[i] -> GetLocalTime (), Seconds (2) + NanoSeconds (2), "Event of node " << i << " run late");
+  m_checks++;
+}
+
+void
+ClockHelperTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  m_checks = 0;
+  NodeContainer nodes;
+  nodes.Create (4);
+  Ptr<UniformRandomVariable> frequency = CreateObject<UniformRandomVariable> ();
+  frequency -> SetAttribute ("Min", DoubleValue (0.5));
+  frequency -> SetAttribute ("Max", DoubleValue (2));
+  Ptr<ConstantRandomVariable> offset = CreateObject<ConstantRandomVariable> ();
+  offset -> SetAttribute ("Constant", DoubleValue (1));
+
+  ClockHelper helper;
+  helper.SetFrequency (frequency);
+  helper.SetOffset (offset);
+  NS_TEST_EXPECT_MSG_EQ (helper.AssignStreams (10), 2, "Wrong number of streams");
+  m_clocks = helper.Install (nodes);
+  NS_TEST_ASSERT_MSG_EQ (m_clocks.size (), 4, "Wrong number of clocks");
+
+  std::vector<double> frequencies;
+  for (uint32_t i = 0; i < nodes.GetN (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (nodes.Get (i) -> GetObject<LocalClock> (), m_clocks[i], "Clock not aggregated to node " << i);
+      PointerValue model;
+      m_clocks[i] -> GetAttribute ("ClockModel", model);
+      Ptr<PerfectClockModelImpl> perfect = model.Get<PerfectClockModelImpl> ();
+      NS_TEST_ASSERT_MSG_NE (perfect, 0, "Wrong clock model");
+      NS_TEST_EXPECT_MSG_EQ (perfect -> GetOffset (), Seconds (1), "Wrong offset of node " << i);
+      NS_TEST_EXPECT_MSG_GT_OR_EQ (perfect -> GetFrequency (), 0.5, "Wrong frequency of node " << i);
+      NS_TEST_EXPECT_MSG_LT_OR_EQ (perfect -> GetFrequency (), 2, "Wrong frequency of node " << i);
+      frequencies.push_back (perfect -> GetFrequency ());
+      Simulator::ScheduleWithContext (nodes.Get (i) -> GetId (), Seconds (0), &ClockHelperTestCase::Start, this, i);
+    }
+  std::sort (frequencies.begin (), frequencies.end ());
+  NS_TEST_EXPECT_MSG_EQ ((std::unique (frequencies.begin (), frequencies.end ()) == frequencies.end ()), true, "Frequencies not drawn for each node");
+
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_checks, 4, "Events did not run");
+  m_clocks.clear ();
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks that the delays left before the events of a node are measured in its local time, that the EventIds
+* handed out before a clock update still identify the events it moved, and that Timer and Watchdog run in local time.
+*/
+class LocalTimerTestCase : public TestCase
+{
+public:
+  LocalTimerTestCase (bool lazy);
+  virtual ~LocalTimerTestCase ();
+  virtual void DoRun (void);
+
+  void Start (void);
+  void Update (void);
+  void Ping (void);
+  void Resume (void);
+  void EventExpire (void);
+  void TimerExpire (void);
+  void WatchdogExpire (void);
+
+  bool m_lazy;
+  Ptr<LocalClock> m_clock;
+  EventId m_id;
+  EventId m_removed;
+  Timer m_timer;
+  Watchdog m_watchdog;
+  Time m_event;
+  Time m_timerEnd;
+  Time m_watchdogEnd;
+};
+
+LocalTimerTestCase::LocalTimerTestCase (bool lazy)
+  : TestCase (lazy ? "Check local-time delays, timers and EventIds with lazy rescheduling"
+                   : "Check local-time delays, timers and EventIds with eager rescheduling"),
+    m_lazy (lazy),
+    m_timer (Timer::CANCEL_ON_DESTROY)
+{
+}
+
+LocalTimerTestCase::~LocalTimerTestCase ()
+{
+}
+
+void
+LocalTimerTestCase::Start (void)
+{
+  m_id = Simulator::Schedule (Seconds (10), &LocalTimerTestCase::EventExpire, this);
+  m_removed = Simulator::Schedule (Seconds (20), &LocalTimerTestCase::EventExpire, this);
+  m_timer.SetFunction (&LocalTimerTestCase::TimerExpire, this);
+  m_timer.Schedule (Seconds (4));
+  m_watchdog.SetFunction (&LocalTimerTestCase::WatchdogExpire, this);
+  m_watchdog.Ping (Seconds (6));
+  NS_TEST_EXPECT_MSG_EQ (Simulator::GetDelayLeft (m_id), Seconds (10), "Wrong delay left");
+}
+
+void
+LocalTimerTestCase::Update (void)
+{
+  //Half the frequency, the local time goes on from 2s
+  Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+  model -> SetFrequency (0.5);
+  model -> SetOffset (Seconds (1));
+  m_clock -> SetClock (model);
+
+  Ptr<LocalTimeSimulatorImpl> impl = DynamicCast<LocalTimeSimulatorImpl> (Simulator::GetImplementation ());
+  NS_TEST_EXPECT_MSG_EQ (m_id.IsRunning (), true, "Event expired by the clock update");
+  NS_TEST_EXPECT_MSG_EQ (Simulator::GetDelayLeft (m_id), Seconds (9), "Wrong local delay left after the clock update");
+  NS_TEST_EXPECT_MSG_EQ (impl -> GetGlobalDelayLeft (m_id), Seconds (18), "Wrong global delay left after the clock update");
+  NS_TEST_EXPECT_MSG_EQ (m_timer.GetDelayLeft (), Seconds (3), "Wrong delay left of the timer");
+  Simulator::Remove (m_removed);
+  NS_TEST_EXPECT_MSG_EQ (m_removed.IsExpired (), true, "Event not removed");
+}
+
+void
+LocalTimerTestCase::Ping (void)
+{
+  //Local time is 3s, the watchdog is extended from 7s to 9s local
+  m_watchdog.Ping (Seconds (6));
+  m_timer.Suspend ();
+  NS_TEST_EXPECT_MSG_EQ (m_timer.GetDelayLeft (), Seconds (2), "Wrong delay left of the suspended timer");
+  Simulator::Schedule (Seconds (0.5), &LocalTimerTestCase::Resume, this);
+}
+
+void
+LocalTimerTestCase::Resume (void)
+{
+  m_timer.Resume ();
+}
+
+void
+LocalTimerTestCase::EventExpire (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_event, Seconds (0), "Event run twice");
+  m_event = Simulator::Now ();
+}
+
+void
+LocalTimerTestCase::TimerExpire (void)
+{
+  m_timerEnd = Simulator::Now ();
+}
+
+void
+LocalTimerTestCase::WatchdogExpire (void)
+{
+  m_watchdogEnd = Simulator::Now ();
+}
+
+void
+LocalTimerTestCase::DoRun (void)
+{
+  Config::SetDefault ("ns3::LocalTimeSimulatorImpl::LazyRescheduling", BooleanValue (m_lazy));
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  Ptr<Node> node = CreateObject<Node> ();
+  m_clock = CreateObject<LocalClock> ();
+  m_clock -> SetAttribute ("ClockModel", PointerValue (CreateObject<PerfectClockModelImpl> ()));
+  node -> AggregateObject (m_clock);
+
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (1), &LocalTimerTestCase::Start, this);
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (2), &LocalTimerTestCase::Update, this);
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (4), &LocalTimerTestCase::Ping, this);
+  Simulator::Run ();
+
+  //The remaining local delays at 2s are 9s for the event, 3s for the timer and 5s for the watchdog
+  NS_TEST_EXPECT_MSG_EQ (m_event, Seconds (20), "Event run at the wrong time");
+  NS_TEST_EXPECT_MSG_EQ (m_id.IsExpired (), true, "Event still pending");
+  //Suspended at 4s with 2s local left, resumed at 5s
+  NS_TEST_EXPECT_MSG_EQ (m_timerEnd, Seconds (9), "Timer expired at the wrong time");
+  //Extended to local time 9s
+  NS_TEST_EXPECT_MSG_EQ (m_watchdogEnd, Seconds (16), "Watchdog expired at the wrong time");
+  m_clock = 0;
+  Simulator::Destroy ();
+  Config::SetDefault ("ns3::LocalTimeSimulatorImpl::LazyRescheduling", BooleanValue (false));
+}
+
+class ForkTestCase : public TestCase
+{
+public:
+  ForkTestCase ();
+  virtual ~ForkTestCase ();
+  virtual void DoRun (void);
+
+  void Tick (void);
+  void Stop (void);
+
+  uint32_t m_nTicks;
+};
+
+ForkTestCase::ForkTestCase ()
+  : TestCase ("Check that the variants forked from a checkpoint go on from its state")
+{
+}
+
+ForkTestCase::~ForkTestCase ()
+{
+}
+
+void
+ForkTestCase::Tick (void)
+{
+  m_nTicks++;
+  Simulator::Schedule (Seconds (1), &ForkTestCase::Tick, this);
+}
+
+void
+ForkTestCase::Stop (void)
+{
+  Simulator::Stop ();
+}
+
+void
+ForkTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LocalClock> clock = CreateObject<LocalClock> ();
+  clock -> SetAttribute ("ClockModel", PointerValue (CreateObject<PerfectClockModelImpl> ()));
+  node -> AggregateObject (clock);
+
+  //Warmup, ticks at 1s to 5s
+  m_nTicks = 0;
+  Simulator::ScheduleWithContext (node -> GetId (), Seconds (1), &ForkTestCase::Tick, this);
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (5.5), &ForkTestCase::Stop, this);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_nTicks, 5, "Wrong number of ticks during the warmup");
+
+  Ptr<LocalTimeSimulatorImpl> impl = DynamicCast<LocalTimeSimulatorImpl> (Simulator::GetImplementation ());
+  uint32_t variant = impl -> Fork (3, 2);
+  //Each variant runs its clock at frequency 1, 2 and 3 from 5.5s, the local time goes on from 5.5s
+  double frequency = variant < 3 ? variant + 1 : 1;
+  if (variant < 3)
+    {
+      clock -> AdjustClock (frequency, Seconds (5.5 * (1 - frequency)));
+    }
+  m_nTicks = 0;
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (4.25), &ForkTestCase::Stop, this);
+  Simulator::Run ();
+  //Local ticks at 6s and after, until the local time of global time 9.75s
+  uint32_t expected[] = { 4, 8, 13, 4 };
+  NS_TEST_EXPECT_MSG_EQ (m_nTicks, expected[variant], "Wrong number of ticks after the fork");
+  if (variant < 3)
+    {
+      _exit (IsStatusFailure () ? 1 : 0);
+    }
+  NS_TEST_EXPECT_MSG_EQ (impl -> GetNFailedVariants (), 0, "A variant failed");
+  Simulator::Destroy ();
+}
+
+class HardwareTimestampTestCase : public TestCase
+{
+public:
+  HardwareTimestampTestCase ();
+  virtual ~HardwareTimestampTestCase ();
+  virtual void DoRun (void);
+
+  void Check (void);
+
+  Ptr<LocalClock> m_perfect;
+  Ptr<LocalClock> m_piecewise;
+};
+
+HardwareTimestampTestCase::HardwareTimestampTestCase ()
+  : TestCase ("Check the hardware timestamps and the tag that carries them")
+{
+}
+
+HardwareTimestampTestCase::~HardwareTimestampTestCase ()
+{
+}
+
+void
+HardwareTimestampTestCase::Check (void)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_perfect -> GetTimestamp (), m_perfect -> GetLocalTime (), "Wrong inline timestamp");
+  NS_TEST_EXPECT_MSG_EQ (m_piecewise -> GetTimestamp (), m_piecewise -> GetLocalTime (), "Wrong timestamp");
+
+  //Sent by one node, received on a copy by the other as through a channel
+  Ptr<Packet> sent = Create<Packet> (100);
+  HardwareTimestampTag tag;
+  tag.SetTxTimestamp (m_perfect -> GetTimestamp ());
+  sent -> AddPacketTag (tag);
+  Ptr<Packet> received = sent -> Copy ();
+  HardwareTimestampTag rxTag;
+  NS_TEST_EXPECT_MSG_EQ (received -> PeekPacketTag (rxTag), true, "Tag lost by the copy");
+  NS_TEST_EXPECT_MSG_EQ (rxTag.GetRxTimestamp ().IsNegative (), true, "Receive timestamp taken before the reception");
+  rxTag.SetRxTimestamp (m_piecewise -> GetTimestamp ());
+  received -> ReplacePacketTag (rxTag);
+
+  HardwareTimestampTag sentTag;
+  sent -> PeekPacketTag (sentTag);
+  received -> PeekPacketTag (rxTag);
+  NS_TEST_EXPECT_MSG_EQ (sentTag.GetRxTimestamp ().IsNegative (), true, "Receive timestamp written to the packet sent");
+  NS_TEST_EXPECT_MSG_EQ (rxTag.GetTxTimestamp (), Seconds (9), "Wrong transmit timestamp");
+  NS_TEST_EXPECT_MSG_EQ (rxTag.GetRxTimestamp (), Seconds (3), "Wrong receive timestamp");
+}
+
+void
+HardwareTimestampTestCase::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  Ptr<PerfectClockModelImpl> perfect = CreateObject<PerfectClockModelImpl> ();
+  perfect -> SetFrequency (2);
+  perfect -> SetOffset (Seconds (1));
+  m_perfect = CreateObject<LocalClock> (perfect);
+  Ptr<PiecewiseClockModelImpl> piecewise = CreateObject<PiecewiseClockModelImpl> ();
+  piecewise -> AddSegment (Seconds (0), 1);
+  piecewise -> AddSegment (Seconds (2), 0.5);
+  m_piecewise = CreateObject<LocalClock> (piecewise);
+
+  Simulator::Schedule (Seconds (4), &HardwareTimestampTestCase::Check, this);
+  Simulator::Run ();
+  m_perfect = 0;
+  m_piecewise = 0;
+  Simulator::Destroy ();
+}
+
+/**
+* This test checks the serialization of the PTP messages, and that PtpSlave synchronizes clocks of different
+* frequencies and offsets to the master, through a shared channel or through point-to-point links.
+*/
+class PtpTestCase : public TestCase
+{
+public:
+  PtpTestCase (bool pointToPoint);
+  virtual ~PtpTestCase ();
+  virtual void DoRun (void);
+
+  void Check (void);
+  static void Offset (PtpTestCase *test, uint32_t i, Time offset, Time meanPathDelay);
+
+  std::vector<Ptr<LocalClock> > m_clocks;
+  std::vector<uint32_t> m_offsets;
+  std::vector<Time> m_meanPathDelays;
+  bool m_pointToPoint;
+};
+
+PtpTestCase::PtpTestCase (bool pointToPoint)
+  : TestCase (std::string ("Check the PTP messages and the synchronization of the clocks by PtpSlave")
+              + (pointToPoint ? " over point-to-point links" : "")),
+    m_pointToPoint (pointToPoint)
+{
+}
+
+PtpTestCase::~PtpTestCase ()
+{
+}
+
+void
+PtpTestCase::Offset (PtpTestCase *test, uint32_t i, Time offset, Time meanPathDelay)
+{
+  test -> m_offsets[i]++;
+  test -> m_meanPathDelays[i] = meanPathDelay;
+}
+
+void
+PtpTestCase::Check (void)
+{
+  for (uint32_t i = 0; i < m_clocks.size (); ++i)
+    {
+      Time error = m_clocks[i] -> GetLocalTime () - Simulator::Now ();
+      NS_TEST_EXPECT_MSG_LT (Abs (error), NanoSeconds (100), "Slave " << i << " not synchronized");
+    }
+}
+
+void
+PtpTestCase::DoRun (void)
+{
+  PtpHeader header;
+  header.SetMessageType (PtpHeader::DELAY_RESP);
+  header.SetDomain (3);
+  header.SetSequenceId (40000);
+  header.SetSourceClockIdentity (7);
+  header.SetLogMessageInterval (-2);
+  header.SetTimestamp (NanoSeconds (-1500000001));
+  header.SetRequestingClockIdentity (12);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet -> AddHeader (header);
+  NS_TEST_EXPECT_MSG_EQ (packet -> GetSize (), 54, "Wrong size of a Delay_Resp");
+  PtpHeader copy;
+  Ptr<Packet> truncated = packet -> CreateFragment (0, 50);
+  NS_TEST_EXPECT_MSG_EQ (truncated -> PeekHeader (copy), 0, "Truncated Delay_Resp read");
+  packet -> RemoveHeader (copy);
+  NS_TEST_EXPECT_MSG_EQ (copy.GetMessageType (), PtpHeader::DELAY_RESP, "Wrong message type");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t) copy.GetDomain (), 3, "Wrong domain");
+  NS_TEST_EXPECT_MSG_EQ (copy.GetSequenceId (), 40000, "Wrong sequence id");
+  NS_TEST_EXPECT_MSG_EQ (copy.GetSourceClockIdentity (), 7, "Wrong source");
+  NS_TEST_EXPECT_MSG_EQ ((int32_t) copy.GetLogMessageInterval (), -2, "Wrong message interval");
+  NS_TEST_EXPECT_MSG_EQ (copy.GetTimestamp (), NanoSeconds (-1500000001), "Wrong negative timestamp");
+  NS_TEST_EXPECT_MSG_EQ (copy.GetRequestingClockIdentity (), 12, "Wrong requester");
+
+  GlobalValue::Bind ("SimulatorImplementationType", 
+                     StringValue ("ns3::LocalTimeSimulatorImpl"));
+  NodeContainer nodes;
+  nodes.Create (3);
+  Time pathDelay = MicroSeconds (10);
+  if (m_pointToPoint)
+    {
+#ifdef NS3_CLOCK_TEST_POINT_TO_POINT
+      //The master is linked to each slave, the Sync and Delay_Req have the same size
+      PointToPointHelper p2p;
+      p2p.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      p2p.SetChannelAttribute ("Delay", TimeValue (MicroSeconds (10)));
+      p2p.Install (nodes.Get (0), nodes.Get (1));
+      p2p.Install (nodes.Get (0), nodes.Get (2));
+      PtpHeader sync;
+      pathDelay += DataRate ("1Gbps").CalculateBytesTxTime (sync.GetSerializedSize () + 2);
+#endif
+    }
+  else
+    {
+      Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+      channel -> SetAttribute ("Delay", TimeValue (MicroSeconds (10)));
+      for (uint32_t i = 0; i < nodes.GetN (); ++i)
+        {
+          Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+          device -> SetAddress (Mac48Address::Allocate ());
+          device -> SetChannel (channel);
+          nodes.Get (i) -> AddDevice (device);
+        }
+    }
+
+  //The master runs on global time
+  Ptr<PtpMaster> master = CreateObject<PtpMaster> ();
+  nodes.Get (0) -> AddApplication (master);
+  double frequencies[] = { 1 + 50e-6, 1 - 30e-6 };
+  Time offsets[] = { MilliSeconds (3), MilliSeconds (-2) };
+  m_offsets.assign (2, 0);
+  m_meanPathDelays.assign (2, Time (0));
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+      model -> SetFrequency (frequencies[i]);
+      model -> SetOffset (offsets[i]);
+      Ptr<LocalClock> clock = CreateObject<LocalClock> (model);
+      nodes.Get (i + 1) -> AggregateObject (clock);
+      m_clocks.push_back (clock);
+      Ptr<PtpSlave> slave = CreateObject<PtpSlave> ();
+      slave -> AssignStreams (i);
+      slave -> TraceConnectWithoutContext ("Offset", MakeBoundCallback (&PtpTestCase::Offset, this, i));
+      nodes.Get (i + 1) -> AddApplication (slave);
+    }
+
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, Seconds (60), &PtpTestCase::Check, this);
+  Simulator::Stop (Seconds (61));
+  Simulator::Run ();
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      NS_TEST_EXPECT_MSG_GT (m_offsets[i], 55, "Too few offsets measured by slave " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_meanPathDelays[i], pathDelay, "Wrong mean path delay of slave " << i);
+    }
+  m_clocks.clear ();
+  Simulator::Destroy ();
+}
+
 class LocalSimulatorTestSuite : public TestSuite
 {
 public:
@@ -258,6 +1777,24 @@ public:
     factory.SetTypeId (ListScheduler::GetTypeId ());
 
     AddTestCase (new EventSchedulTestCase ("Check basic event handling is working", factory), TestCase::QUICK);
+    AddTestCase (new TombstoneTestCase (), TestCase::QUICK);
+    AddTestCase (new ClockTableTestCase (), TestCase::QUICK);
+    AddTestCase (new ClockConversionTestCase (), TestCase::QUICK);
+    AddTestCase (new PiecewiseClockTestCase (), TestCase::QUICK);
+    AddTestCase (new StochasticClockTestCase (), TestCase::QUICK);
+    AddTestCase (new BatchUpdateTestCase (), TestCase::QUICK);
+    AddTestCase (new LazyReschedulingTestCase (), TestCase::QUICK);
+    AddTestCase (new MultithreadedTestCase (), TestCase::QUICK);
+    AddTestCase (new ClockTraceTestCase (), TestCase::QUICK);
+    AddTestCase (new ClockHelperTestCase (), TestCase::QUICK);
+    AddTestCase (new LocalTimerTestCase (false), TestCase::QUICK);
+    AddTestCase (new LocalTimerTestCase (true), TestCase::QUICK);
+    AddTestCase (new ForkTestCase (), TestCase::QUICK);
+    AddTestCase (new HardwareTimestampTestCase (), TestCase::QUICK);
+    AddTestCase (new PtpTestCase (false), TestCase::QUICK);
+#ifdef NS3_CLOCK_TEST_POINT_TO_POINT
+    AddTestCase (new PtpTestCase (true), TestCase::QUICK);
+#endif
   }
 }g_localSimulatorTestSuite;
 
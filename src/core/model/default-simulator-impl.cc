@@ -27,6 +27,8 @@
 #include "pointer.h"
 #include "assert.h"
 #include "log.h"
+#include "string.h"
+#include "uinteger.h"
 
 #include <cmath>
 
@@ -46,6 +48,9 @@ NS_LOG_COMPONENT_DEFINE ("DefaultSimulatorImpl");
 
 NS_OBJECT_ENSURE_REGISTERED (DefaultSimulatorImpl);
 
+/** Number of slots of the ring of events from other threads, a power of two. */
+static const uint64_t EVENTS_WITH_CONTEXT_RING_SIZE = 4096;
+
 TypeId
 DefaultSimulatorImpl::GetTypeId (void)
 {
@@ -53,11 +58,30 @@ DefaultSimulatorImpl::GetTypeId (void)
     .SetParent<SimulatorImpl> ()
     .SetGroupName ("Core")
     .AddConstructor<DefaultSimulatorImpl> ()
+    .AddAttribute ("ProfileFile",
+                   "Name of the file where to write the profile of the wall-clock time "
+                   "of the events by type and context at Simulator::Destroy, along with "
+                   "a .folded file for flame graphs. Empty to disable the profiler.",
+                   StringValue (""),
+                   MakeStringAccessor (&DefaultSimulatorImpl::m_profileFile),
+                   MakeStringChecker ())
+    .AddAttribute ("ProfileSamplingInterval",
+                   "Mean number of events per event timed by the profiler.",
+                   UintegerValue (16),
+                   MakeUintegerAccessor (&DefaultSimulatorImpl::m_profileSamplingInterval),
+                   MakeUintegerChecker<uint32_t> (1))
   ;
   return tid;
 }
 
 DefaultSimulatorImpl::DefaultSimulatorImpl ()
+  : m_eventsWithContextRing (EVENTS_WITH_CONTEXT_RING_SIZE),
+    m_eventsWithContextHead (0),
+    m_eventsWithContextTail (0),
+    m_eventsWithContextOverflow (false),
+    m_batchNext (0),
+    m_fastBatches (false),
+    m_profiler (0)
 {
   NS_LOG_FUNCTION (this);
   m_stop = false;
@@ -72,13 +96,17 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentContext = Simulator::NO_CONTEXT;
   m_unscheduledEvents = 0;
   m_eventCount = 0;
-  m_eventsWithContextEmpty = true;
+  for (uint64_t i = 0; i < EVENTS_WITH_CONTEXT_RING_SIZE; ++i)
+    {
+      m_eventsWithContextRing[i].sequence.store (i, std::memory_order_relaxed);
+    }
   m_main = SystemThread::Self();
 }
 
 DefaultSimulatorImpl::~DefaultSimulatorImpl ()
 {
   NS_LOG_FUNCTION (this);
+  delete m_profiler;
 }
 
 void
@@ -109,6 +137,12 @@ DefaultSimulatorImpl::Destroy ()
           ev->Invoke ();
         }
     }
+  if (m_profiler != 0)
+    {
+      m_profiler->Write (m_profileFile);
+      delete m_profiler;
+      m_profiler = 0;
+    }
 }
 
 void
@@ -126,6 +160,9 @@ DefaultSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
         }
     }
   m_events = scheduler;
+  // The rest of a batch being run goes to the new scheduler
+  RequeueBatch ();
+  m_fastBatches = scheduler->HasFastBatches ();
 }
 
 // System ID for non-distributed simulation is always zero
@@ -138,7 +175,21 @@ DefaultSimulatorImpl::GetSystemId (void) const
 void
 DefaultSimulatorImpl::ProcessOneEvent (void)
 {
-  Scheduler::Event next = m_events->RemoveNext ();
+  Scheduler::Event next;
+  if (!m_fastBatches)
+    {
+      next = m_events->RemoveNext ();
+    }
+  else
+    {
+      if (m_batchNext == m_batch.size ())
+        {
+          m_batch.clear ();
+          m_batchNext = 0;
+          m_events->RemoveNextBatch (m_batch);
+        }
+      next = m_batch[m_batchNext++];
+    }
 
   NS_ASSERT (next.key.m_ts >= m_currentTs);
   m_unscheduledEvents--;
@@ -148,45 +199,140 @@ DefaultSimulatorImpl::ProcessOneEvent (void)
   m_currentTs = next.key.m_ts;
   m_currentContext = next.key.m_context;
   m_currentUid = next.key.m_uid;
-  next.impl->Invoke ();
+  if (m_profiler != 0 && m_profiler->Sample ())
+    {
+      uint64_t start = EventProfiler::GetTicks ();
+      next.impl->Invoke ();
+      m_profiler->Record (typeid (*next.impl), next.key.m_context, EventProfiler::GetTicks () - start);
+    }
+  else
+    {
+      next.impl->Invoke ();
+    }
   next.impl->Unref ();
 
-  ProcessEventsWithContext ();
+  // The events from a different context run after the batch anyway
+  if (!m_fastBatches || m_batchNext == m_batch.size ())
+    {
+      ProcessEventsWithContext ();
+    }
+}
+
+void
+DefaultSimulatorImpl::RequeueBatch (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (; m_batchNext < m_batch.size (); ++m_batchNext)
+    {
+      m_events->Insert (m_batch[m_batchNext]);
+    }
+  m_batch.clear ();
+  m_batchNext = 0;
 }
 
 bool 
 DefaultSimulatorImpl::IsFinished (void) const
 {
-  return m_events->IsEmpty () || m_stop;
+  return (m_batchNext == m_batch.size () && m_events->IsEmpty ()) || m_stop;
+}
+
+bool
+DefaultSimulatorImpl::EnqueueEventWithContext (const EventWithContext &ev)
+{
+  uint64_t tail = m_eventsWithContextTail.load (std::memory_order_relaxed);
+  EventWithContextSlot *slot;
+  while (true)
+    {
+      slot = &m_eventsWithContextRing[tail & (EVENTS_WITH_CONTEXT_RING_SIZE - 1)];
+      uint64_t sequence = slot->sequence.load (std::memory_order_acquire);
+      int64_t diff = (int64_t) (sequence - tail);
+      if (diff == 0)
+        {
+          // The slot is free, claim it
+          if (m_eventsWithContextTail.compare_exchange_weak (tail, tail + 1, std::memory_order_relaxed))
+            {
+              break;
+            }
+        }
+      else if (diff < 0)
+        {
+          // The slot still holds the event of the previous lap
+          return false;
+        }
+      else
+        {
+          // Another thread claimed the slot
+          tail = m_eventsWithContextTail.load (std::memory_order_relaxed);
+        }
+    }
+  slot->event = ev;
+  slot->sequence.store (tail + 1, std::memory_order_release);
+  return true;
+}
+
+void
+DefaultSimulatorImpl::InsertEventWithContext (const EventWithContext &event)
+{
+  Scheduler::Event ev;
+  ev.impl = event.event;
+  ev.key.m_ts = m_currentTs + event.timestamp;
+  ev.key.m_context = event.context;
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+}
+
+void
+DefaultSimulatorImpl::DrainEventsWithContext (uint64_t end, bool wait)
+{
+  while (m_eventsWithContextHead != end)
+    {
+      EventWithContextSlot &slot = m_eventsWithContextRing[m_eventsWithContextHead & (EVENTS_WITH_CONTEXT_RING_SIZE - 1)];
+      if (slot.sequence.load (std::memory_order_acquire) != m_eventsWithContextHead + 1)
+        {
+          if (!wait)
+            {
+              break;
+            }
+          continue;
+        }
+      InsertEventWithContext (slot.event);
+      slot.sequence.store (m_eventsWithContextHead + EVENTS_WITH_CONTEXT_RING_SIZE, std::memory_order_release);
+      m_eventsWithContextHead++;
+    }
 }
 
 void
 DefaultSimulatorImpl::ProcessEventsWithContext (void)
 {
-  if (m_eventsWithContextEmpty)
+  DrainEventsWithContext (m_eventsWithContextTail.load (std::memory_order_relaxed), false);
+  if (!m_eventsWithContextOverflow.load (std::memory_order_acquire))
     {
       return;
     }
 
   // swap queues
   EventsWithContext eventsWithContext;
+  uint64_t end;
   {
     CriticalSection cs (m_eventsWithContextMutex);
+    // A thread claims its slots before it appends to the list under
+    // the mutex, so all the slots claimed before the events of the list
+    // are below this tail. It is read before the flag is cleared, so the
+    // slots claimed by the threads that see it cleared are not.
+    end = m_eventsWithContextTail.load (std::memory_order_relaxed);
     m_eventsWithContext.swap(eventsWithContext);
-    m_eventsWithContextEmpty = true;
+    m_eventsWithContextOverflow.store (false, std::memory_order_release);
   }
+  // Those slots are drained first, even those still being written, and
+  // the later ones after the list, so that the events of a thread stay
+  // in order
+  DrainEventsWithContext (end, true);
   while (!eventsWithContext.empty ())
     {
-       EventWithContext event = eventsWithContext.front ();
+       InsertEventWithContext (eventsWithContext.front ());
        eventsWithContext.pop_front ();
-       Scheduler::Event ev;
-       ev.impl = event.event;
-       ev.key.m_ts = m_currentTs + event.timestamp;
-       ev.key.m_context = event.context;
-       ev.key.m_uid = m_uid;
-       m_uid++;
-       m_unscheduledEvents++;
-       m_events->Insert (ev);
     }
 }
 
@@ -198,11 +344,16 @@ DefaultSimulatorImpl::Run (void)
   m_main = SystemThread::Self();
   ProcessEventsWithContext ();
   m_stop = false;
+  if (!m_profileFile.empty () && m_profiler == 0)
+    {
+      m_profiler = new EventProfiler (m_profileSamplingInterval);
+    }
 
-  while (!m_events->IsEmpty () && !m_stop) 
+  while ((m_batchNext < m_batch.size () || !m_events->IsEmpty ()) && !m_stop)
     {
       ProcessOneEvent ();
     }
+  RequeueBatch ();
 
   // If the simulator stopped naturally by lack of events, make a
   // consistency test to check that we didn't lose any events along the way.
@@ -270,11 +421,12 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay,
       // Current time added in ProcessEventsWithContext()
       ev.timestamp = delay.GetTimeStep ();
       ev.event = event;
-      {
-        CriticalSection cs (m_eventsWithContextMutex);
-        m_eventsWithContext.push_back(ev);
-        m_eventsWithContextEmpty = false;
-      }
+      if (m_eventsWithContextOverflow.load (std::memory_order_acquire) || !EnqueueEventWithContext (ev))
+        {
+          CriticalSection cs (m_eventsWithContextMutex);
+          m_eventsWithContext.push_back(ev);
+          m_eventsWithContextOverflow.store (true, std::memory_order_release);
+        }
     }
 }
 
@@ -345,6 +497,13 @@ DefaultSimulatorImpl::Remove (const EventId &id)
     {
       return;
     }
+  if (id.GetTs () == m_currentTs && m_batchNext < m_batch.size ()
+      && id.GetUid () <= m_batch.back ().key.m_uid)
+    {
+      // The event is in the batch being run, it is released when its turn comes
+      id.PeekEventImpl ()->Cancel ();
+      return;
+    }
   Scheduler::Event event;
   event.impl = id.PeekEventImpl ();
   event.key.m_ts = id.GetTs ();
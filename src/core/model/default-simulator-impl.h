@@ -26,10 +26,14 @@
 #include "event-impl.h"
 #include "system-thread.h"
 #include "system-mutex.h"
+#include "event-profiler.h"
 
 #include "ptr.h"
 
+#include <atomic>
 #include <list>
+#include <string>
+#include <vector>
 
 /**
  * \file
@@ -39,6 +43,11 @@
 
 namespace ns3 {
 
+  /* Forward declaration */
+  namespace tests {
+    class ThreadedOverflowOrderTestCase;
+  }
+
 /**
  * \ingroup simulator
  *
@@ -80,10 +89,16 @@ public:
   virtual uint64_t GetEventCount (void) const;
 
 private:
+  // Test case needs to stall a producer between the claim and the
+  // publication of a slot
+  friend class tests::ThreadedOverflowOrderTestCase;
+
   virtual void DoDispose (void);
 
   /** Process the next event. */
   void ProcessOneEvent (void);
+  /** Move the events of the batch not yet run back to the main event queue. */
+  void RequeueBatch (void);
   /** Move events from a different context into the main event queue. */
   void ProcessEventsWithContext (void);
  
@@ -96,15 +111,67 @@ private:
     /** The event implementation. */
     EventImpl *event;
   };
+  /**
+   * Append an event from another thread to the ring, without a lock
+   * or an allocation.
+   *
+   * \param [in] ev The event.
+   * \returns \c false if the ring is full.
+   */
+  bool EnqueueEventWithContext (const EventWithContext &ev);
+  /**
+   * Insert an event from another thread in the main event queue.
+   *
+   * \param [in] ev The event.
+   */
+  void InsertEventWithContext (const EventWithContext &ev);
+  /**
+   * Move the events of the ring into the main event queue, up to
+   * a position.
+   *
+   * \param [in] end The position of the first slot not to move.
+   * \param [in] wait Wait for the slots claimed but not yet written,
+   *             instead of stopping at the first of them.
+   */
+  void DrainEventsWithContext (uint64_t end, bool wait);
+
+  /** A slot of the ring of events from other threads. */
+  struct EventWithContextSlot
+  {
+    /**
+     * Sequence number of the slot: its position in the ring while
+     * free, its position plus one once the event has been written.
+     */
+    std::atomic<uint64_t> sequence;
+    /** The event. */
+    EventWithContext event;
+  };
+  /**
+   * Bounded ring of the events scheduled by other threads. The
+   * producers claim a slot by advancing m_eventsWithContextTail, then
+   * publish it through its sequence number. The main thread drains
+   * all the published slots at once.
+   */
+  std::vector<EventWithContextSlot> m_eventsWithContextRing;
+  /** Position of the next slot to read, only used by the main thread. */
+  uint64_t m_eventsWithContextHead;
+  /** Keep the position of the producers on a cache line of its own. */
+  char m_eventsWithContextPadding[64];
+  /** Position of the next slot to claim. */
+  std::atomic<uint64_t> m_eventsWithContextTail;
+  /** Keep the position of the producers on a cache line of its own. */
+  char m_eventsWithContextTailPadding[64];
+
   /** Container type for the events from a different context. */
   typedef std::list<struct EventWithContext> EventsWithContext;
-  /** The container of events from a different context. */
-  EventsWithContext m_eventsWithContext;
   /**
-   * Flag \c true if all events with context have been moved to the
-   * primary event queue.
+   * The events from a different context scheduled while the ring
+   * was full. Once there is one, the next events of the other threads
+   * follow it, so that the events of a thread stay in order.
    */
-  bool m_eventsWithContextEmpty;
+  EventsWithContext m_eventsWithContext;
+  /** Flag \c true if there are events in m_eventsWithContext. */
+  std::atomic<bool> m_eventsWithContextOverflow;
   /** Mutex to control access to the list of events with context. */
   SystemMutex m_eventsWithContextMutex;
 
@@ -116,6 +183,19 @@ private:
   bool m_stop;
   /** The event priority queue. */
   Ptr<Scheduler> m_events;
+  /**
+   * The events with the timestamp being run, taken from m_events at
+   * once and run in uid order. The events scheduled meanwhile at the
+   * same timestamp have larger uids, so they can wait in m_events.
+   */
+  std::vector<Scheduler::Event> m_batch;
+  /** Index of the next event of m_batch to run. */
+  std::size_t m_batchNext;
+  /**
+   * Whether m_events takes batches at once. The other schedulers run
+   * one event at a time, and m_batch stays empty.
+   */
+  bool m_fastBatches;
 
   /** Next event unique id. */
   uint32_t m_uid;
@@ -135,6 +215,13 @@ private:
 
   /** Main execution thread. */
   SystemThread::ThreadId m_main;
+
+  /** Name of the event profile, empty if the events are not profiled. */
+  std::string m_profileFile;
+  /** Mean number of events per profiled event. */
+  uint32_t m_profileSamplingInterval;
+  /** The event profiler, created by Run if a profile is wanted. */
+  EventProfiler *m_profiler;
 };
 
 } // namespace ns3
@@ -20,6 +20,7 @@
 
 #include "event-impl.h"
 #include "log.h"
+#include <new>
 
 /**
  * \file
@@ -31,6 +32,120 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("EventImpl");
 
+namespace {
+
+/** Granularity of the size classes of the event pool. */
+const std::size_t EVENT_POOL_GRANULARITY = 8;
+/** Number of size classes, larger events use the global allocator. */
+const std::size_t EVENT_POOL_N_CLASSES = 16;
+/**
+ * Largest number of free events of a size class. The events released
+ * beyond it, as by a thread that frees the events allocated by
+ * another, go back to the global allocator.
+ */
+const std::size_t EVENT_POOL_MAX_FREE = 256;
+
+/** A free event, linked to the next free event of its size class. */
+struct FreeEvent
+{
+  FreeEvent *next;  /**< Next free event. */
+};
+
+/**
+ * The event pool of a thread: its free lists, by size class. The pool
+ * is accessed on every allocation and release, so it uses the static
+ * TLS model, which costs a single load relative to the thread pointer
+ * instead of a call to __tls_get_addr () from a shared library.
+ */
+struct EventPool
+{
+  FreeEvent *freeEvents[EVENT_POOL_N_CLASSES];  /**< Free lists, by size class. */
+  std::size_t nFreeEvents[EVENT_POOL_N_CLASSES];  /**< Lengths of the free lists. */
+  bool released;  /**< Whether the free lists have been released. */
+};
+
+#if defined (__GNUC__)
+/** The event pool of the thread. */
+thread_local EventPool g_eventPool __attribute__ ((tls_model ("initial-exec")));
+#else
+/** The event pool of the thread. */
+thread_local EventPool g_eventPool;
+#endif
+
+/**
+ * Release the free lists of a thread when it exits. The events
+ * released later, by the destructors of static objects, go back
+ * to the global allocator.
+ */
+struct EventPoolReleaser
+{
+  ~EventPoolReleaser ()
+  {
+    for (std::size_t i = 0; i < EVENT_POOL_N_CLASSES; ++i)
+      {
+        while (g_eventPool.freeEvents[i] != 0)
+          {
+            FreeEvent *event = g_eventPool.freeEvents[i];
+            g_eventPool.freeEvents[i] = event->next;
+            ::operator delete (event);
+          }
+        g_eventPool.nFreeEvents[i] = 0;
+      }
+    g_eventPool.released = true;
+  }
+};
+
+/**
+ * The releaser of the thread, constructed by its first allocation from
+ * the global allocator, or by its first release to an empty free list.
+ */
+thread_local EventPoolReleaser g_eventPoolReleaser;
+
+} // unnamed namespace
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+  std::size_t sizeClass = (size - 1) / EVENT_POOL_GRANULARITY;
+  if (sizeClass >= EVENT_POOL_N_CLASSES)
+    {
+      return ::operator new (size);
+    }
+  FreeEvent *event = g_eventPool.freeEvents[sizeClass];
+  if (event != 0)
+    {
+      g_eventPool.freeEvents[sizeClass] = event->next;
+      g_eventPool.nFreeEvents[sizeClass]--;
+      return event;
+    }
+  if (!g_eventPool.released)
+    {
+      (void) &g_eventPoolReleaser;
+    }
+  return ::operator new ((sizeClass + 1) * EVENT_POOL_GRANULARITY);
+}
+
+void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+  std::size_t sizeClass = (size - 1) / EVENT_POOL_GRANULARITY;
+  if (sizeClass >= EVENT_POOL_N_CLASSES || g_eventPool.released
+      || g_eventPool.nFreeEvents[sizeClass] == EVENT_POOL_MAX_FREE)
+    {
+      ::operator delete (p);
+      return;
+    }
+  if (g_eventPool.nFreeEvents[sizeClass] == 0)
+    {
+      // A thread that only releases events still frees its lists when it exits
+      (void) &g_eventPoolReleaser;
+    }
+  FreeEvent *event = static_cast<FreeEvent *> (p);
+  event->next = g_eventPool.freeEvents[sizeClass];
+  g_eventPool.freeEvents[sizeClass] = event;
+  g_eventPool.nFreeEvents[sizeClass]++;
+}
+
 EventImpl::~EventImpl ()
 {
   NS_LOG_FUNCTION (this);
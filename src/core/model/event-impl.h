@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 /**
@@ -40,6 +41,13 @@ namespace ns3 {
  * when it reaches the time associated to this event. Most subclasses
  * are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * The events are allocated from thread-local free lists, one per
+ * size class of 8 bytes, up to 128 bytes. An event released by
+ * its last reference goes back to the free list of the thread that
+ * releases it, and is reused by the next event of the same size
+ * class scheduled by that thread. Larger events use the global
+ * allocator.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -66,6 +74,21 @@ public:
    */
   bool IsCancelled (void);
 
+  /**
+   * Allocate an event from the free list of its size class.
+   *
+   * \param [in] size The size of the event.
+   * \returns The memory of the event.
+   */
+  static void * operator new (std::size_t size);
+  /**
+   * Give the memory of an event back to the free list of its size class.
+   *
+   * \param [in] p The memory of the event.
+   * \param [in] size The size of the event.
+   */
+  static void operator delete (void *p, std::size_t size);
+
 protected:
   /**
    * Implementation for Invoke().
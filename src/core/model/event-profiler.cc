@@ -0,0 +1,241 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "event-profiler.h"
+#include "simulator.h"
+#include "fatal-error.h"
+#include "log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if (__GNUC__ >= 3)
+#include <cxxabi.h>
+#endif
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::EventProfiler implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("EventProfiler");
+
+namespace {
+
+/**
+ * Get the wall-clock time.
+ *
+ * \returns The time, in ns.
+ */
+uint64_t
+GetNanoSeconds (void)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds> (
+    std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+/**
+ * Get the readable name of a type.
+ *
+ * \param [in] type The type.
+ * \returns The demangled name of the type.
+ */
+std::string
+GetTypeName (const std::type_info &type)
+{
+  std::string name = type.name ();
+#if (__GNUC__ >= 3)
+  int status;
+  char *demangled = abi::__cxa_demangle (name.c_str (), NULL, NULL, &status);
+  if (status == 0)
+    {
+      name = demangled;
+    }
+  std::free (demangled);
+#endif
+  return name;
+}
+
+/**
+ * Get the name of a context.
+ *
+ * \param [in] context The context.
+ * \returns The name of the context.
+ */
+std::string
+GetContextName (uint32_t context)
+{
+  if (context == Simulator::NO_CONTEXT)
+    {
+      return "no context";
+    }
+  std::ostringstream oss;
+  oss << "node " << context;
+  return oss.str ();
+}
+
+/** The estimated time and number of events of a type or context. */
+struct Total
+{
+  double ns;      /**< The time, in ns. */
+  double events;  /**< The number of events. */
+};
+
+/**
+ * Order of the entries of a report, longest time first.
+ *
+ * \param [in] a The first entry.
+ * \param [in] b The second entry.
+ * \returns \c true if \c a took longer than \c b.
+ */
+bool
+IsLonger (const std::pair<std::string, Total> &a, const std::pair<std::string, Total> &b)
+{
+  return a.second.ns > b.second.ns;
+}
+
+/**
+ * Write a section of the report.
+ *
+ * \param [in] os The report.
+ * \param [in] title The heading of the names.
+ * \param [in] totals The entries, by name.
+ * \param [in] ns The total time of the events, in ns.
+ */
+void
+WriteSection (std::ostream &os, const std::string &title,
+              const std::map<std::string, Total> &totals, double ns)
+{
+  std::vector<std::pair<std::string, Total> > sorted (totals.begin (), totals.end ());
+  std::sort (sorted.begin (), sorted.end (), IsLonger);
+  os << std::setw (16) << "time (ns)"
+     << std::setw (8) << "%"
+     << std::setw (14) << "events"
+     << std::setw (12) << "ns/event"
+     << "  " << title << std::endl;
+  for (std::vector<std::pair<std::string, Total> >::const_iterator i = sorted.begin (); i != sorted.end (); ++i)
+    {
+      const Total &total = i->second;
+      os << std::setw (16) << (uint64_t) total.ns
+         << std::setw (8) << std::fixed << std::setprecision (2) << 100 * total.ns / ns
+         << std::setw (14) << (uint64_t) total.events
+         << std::setw (12) << std::setprecision (0) << total.ns / total.events
+         << "  " << i->first << std::endl;
+    }
+}
+
+} // unnamed namespace
+
+EventProfiler::EventProfiler (uint32_t samplingInterval)
+  : m_samplingInterval (std::max (samplingInterval, 1U)),
+    m_random (0x2545f4914f6cdd1dULL),
+    m_startTicks (GetTicks ()),
+    m_startNs (GetNanoSeconds ())
+{
+  NS_LOG_FUNCTION (this << samplingInterval);
+  m_countdown = NextInterval ();
+}
+
+uint32_t
+EventProfiler::NextInterval (void)
+{
+  if (m_samplingInterval == 1)
+    {
+      return 1;
+    }
+  // xorshift64, uniform on [1, 2 m_samplingInterval - 1]
+  m_random ^= m_random << 13;
+  m_random ^= m_random >> 7;
+  m_random ^= m_random << 17;
+  return 1 + m_random % (2 * m_samplingInterval - 1);
+}
+
+void
+EventProfiler::Record (const std::type_info &type, uint32_t context, uint64_t ticks)
+{
+  Stats &stats = m_stats[Key (context, &type)];
+  stats.ticks += ticks;
+  stats.samples++;
+}
+
+void
+EventProfiler::Write (const std::string &filename) const
+{
+  NS_LOG_FUNCTION (this << filename);
+  uint64_t ticks = GetTicks () - m_startTicks;
+  uint64_t ns = GetNanoSeconds () - m_startNs;
+  double nsPerTick = ticks > 0 ? (double) ns / ticks : 0;
+
+  // The type_info of a type may be duplicated across libraries, so
+  // the entries are merged by name
+  std::map<std::string, Total> types;
+  std::map<std::string, Total> contexts;
+  std::map<std::pair<std::string, std::string>, Total> pairs;
+  double total = 0;
+  uint64_t samples = 0;
+  for (std::unordered_map<Key, Stats, KeyHash>::const_iterator i = m_stats.begin (); i != m_stats.end (); ++i)
+    {
+      Total t;
+      t.ns = i->second.ticks * nsPerTick * m_samplingInterval;
+      t.events = (double) i->second.samples * m_samplingInterval;
+      std::string type = GetTypeName (*i->first.second);
+      std::string context = GetContextName (i->first.first);
+      Total *entries[] = {&types[type], &contexts[context], &pairs[std::make_pair (context, type)]};
+      for (uint32_t j = 0; j < 3; ++j)
+        {
+          entries[j]->ns += t.ns;
+          entries[j]->events += t.events;
+        }
+      total += t.ns;
+      samples += i->second.samples;
+    }
+
+  std::ofstream os (filename.c_str ());
+  if (!os.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open the event profile " << filename);
+    }
+  os << "# Event profile: " << samples << " events sampled, one in "
+     << m_samplingInterval << " on average" << std::endl
+     << "# Estimated time in the events: " << std::fixed << std::setprecision (3)
+     << total / 1e9 << " s of " << ns / 1e9 << " s" << std::endl
+     << std::endl;
+  WriteSection (os, "type", types, total);
+  os << std::endl;
+  WriteSection (os, "context", contexts, total);
+
+  std::string foldedFilename = filename + ".folded";
+  std::ofstream folded (foldedFilename.c_str ());
+  if (!folded.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open the folded event profile " << foldedFilename);
+    }
+  for (std::map<std::pair<std::string, std::string>, Total>::const_iterator i = pairs.begin (); i != pairs.end (); ++i)
+    {
+      folded << i->first.first << ";" << i->first.second << " " << (uint64_t) i->second.ns << std::endl;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include <stdint.h>
+#include <string>
+#include <functional>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * \file
+ * \ingroup simulator
+ * ns3::EventProfiler declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup simulator
+ *
+ * \brief Attribute the wall-clock time of the events to their type
+ * and context.
+ *
+ * The simulator times a sample of the events it runs with the time
+ * stamp counter of the processor, and records the time against the
+ * dynamic type of the EventImpl, which names the function called and
+ * the types of its arguments, and against the context of the event,
+ * the node id. The sampled events are one in SamplingInterval on
+ * average, at random intervals so as not to lock onto periodic
+ * patterns, and the counts and times are scaled back accordingly.
+ *
+ * Write writes two files:
+ *   - a report of the event types sorted by decreasing time, followed
+ *     by the contexts sorted the same way;
+ *   - the same file name with a \c .folded extension, with a line
+ *     <tt>context;type time</tt> per pair, for flamegraph.pl and
+ *     compatible viewers.
+ *
+ * Enable it with the DefaultSimulatorImpl::ProfileFile attribute.
+ */
+class EventProfiler
+{
+public:
+  /**
+   * Constructor.
+   *
+   * \param [in] samplingInterval Mean number of events per sample.
+   */
+  EventProfiler (uint32_t samplingInterval);
+
+  /**
+   * Get the current value of the tick counter.
+   *
+   * \returns The ticks, in processor cycles or ns.
+   */
+  static inline uint64_t GetTicks (void)
+  {
+#if defined (__x86_64__) || defined (__i386__)
+    return __rdtsc ();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+#endif
+  }
+
+  /**
+   * Check whether to time the next event.
+   *
+   * \returns \c true if the next event is sampled.
+   */
+  inline bool Sample (void)
+  {
+    if (--m_countdown != 0)
+      {
+        return false;
+      }
+    m_countdown = NextInterval ();
+    return true;
+  }
+
+  /**
+   * Record a sampled event.
+   *
+   * \param [in] type The dynamic type of the EventImpl.
+   * \param [in] context The context of the event.
+   * \param [in] ticks The duration of the event, in ticks.
+   */
+  void Record (const std::type_info &type, uint32_t context, uint64_t ticks);
+
+  /**
+   * Write the report and the folded stacks.
+   *
+   * \param [in] filename The name of the report.
+   */
+  void Write (const std::string &filename) const;
+
+private:
+  /** The time and number of the sampled events. */
+  struct Stats
+  {
+    uint64_t ticks;   /**< The total duration, in ticks. */
+    uint64_t samples; /**< The number of events. */
+  };
+  /** Key of the table of samples: the context and type of the event. */
+  typedef std::pair<uint32_t, const std::type_info *> Key;
+  /** Hash of a Key. */
+  struct KeyHash
+  {
+    /**
+     * \param [in] key The key.
+     * \returns The hash.
+     */
+    std::size_t operator () (const Key &key) const
+    {
+      return std::hash<const void *> () (key.second) ^ (key.first * 0x9e3779b9U);
+    }
+  };
+
+  /**
+   * Draw the number of events to the next sample.
+   *
+   * \returns The number of events, on average the sampling interval.
+   */
+  uint32_t NextInterval (void);
+
+  /** Mean number of events per sample. */
+  uint32_t m_samplingInterval;
+  /** Number of events to the next sample. */
+  uint32_t m_countdown;
+  /** State of the generator of the sampling intervals. */
+  uint64_t m_random;
+  /** The samples, by context and type. */
+  std::unordered_map<Key, Stats, KeyHash> m_stats;
+  /** The ticks at the start of the profile. */
+  uint64_t m_startTicks;
+  /** The wall-clock time at the start of the profile, in ns. */
+  uint64_t m_startNs;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_PROFILER_H */
@@ -0,0 +1,326 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::LadderScheduler class implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+namespace {
+
+/** Buckets with more events spill over into a new rung instead of being sorted. */
+const uint32_t LADDER_THRESHOLD = 50;
+/** Maximum number of rungs. */
+const uint32_t LADDER_MAX_RUNGS = 8;
+
+/**
+ * Order of the events of Bottom, latest first.
+ *
+ * \param [in] a The first event.
+ * \param [in] b The second event.
+ * \returns \c true if \c a is later than \c b
+ */
+bool
+IsLater (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key > b.key;
+}
+
+} // unnamed namespace
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topMin (0),
+    m_topMax (0),
+    m_topStart (0),
+    m_rungs (LADDER_MAX_RUNGS),
+    m_nRungs (0),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint64_t
+LadderScheduler::GetCurrentStart (const Rung &rung)
+{
+  return rung.start + rung.current * rung.width;
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  uint64_t ts = ev.key.m_ts;
+  m_size++;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      else
+        {
+          m_topMin = std::min (m_topMin, ts);
+          m_topMax = std::max (m_topMax, ts);
+        }
+      m_top.push_back (ev);
+      return;
+    }
+  for (uint32_t r = 0; r < m_nRungs; ++r)
+    {
+      Rung &rung = m_rungs[r];
+      if (ts >= GetCurrentStart (rung))
+        {
+          uint32_t bucket = (ts - rung.start) / rung.width;
+          NS_ASSERT (bucket < rung.nBuckets);
+          rung.buckets[bucket].push_back (ev);
+          rung.nEvents++;
+          return;
+        }
+    }
+  InsertBottom (ev);
+}
+
+void
+LadderScheduler::InsertBottom (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.key.m_ts);
+  m_bottom.insert (std::upper_bound (m_bottom.begin (), m_bottom.end (), ev, IsLater), ev);
+  if (m_bottom.size () > LADDER_THRESHOLD && m_nRungs < LADDER_MAX_RUNGS
+      && m_bottom.front ().key.m_ts != m_bottom.back ().key.m_ts)
+    {
+      // Too many events were inserted before the lowest rung, they get a rung of their own
+      uint64_t end = m_nRungs > 0 ? GetCurrentStart (m_rungs[m_nRungs - 1]) : m_topStart;
+      SpawnRung (m_bottom, m_bottom.back ().key.m_ts, end);
+      m_bottom.clear ();
+    }
+}
+
+void
+LadderScheduler::SpawnRung (const Bucket &events, uint64_t start, uint64_t end)
+{
+  NS_LOG_FUNCTION (this << events.size () << start << end);
+  NS_ASSERT (end > start && m_nRungs < LADDER_MAX_RUNGS);
+  uint64_t n = events.size ();
+  Rung &rung = m_rungs[m_nRungs++];
+  rung.start = start;
+  rung.width = (end - start + n - 1) / n;
+  rung.nBuckets = (end - start + rung.width - 1) / rung.width;
+  rung.current = 0;
+  rung.nEvents = events.size ();
+  if (rung.buckets.size () < rung.nBuckets)
+    {
+      rung.buckets.resize (rung.nBuckets);
+    }
+  for (Bucket::const_iterator i = events.begin (); i != events.end (); ++i)
+    {
+      uint32_t bucket = (i->key.m_ts - start) / rung.width;
+      NS_ASSERT (bucket < rung.nBuckets);
+      rung.buckets[bucket].push_back (*i);
+    }
+}
+
+void
+LadderScheduler::FillBottom (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_bottom.empty () && m_size > 0);
+  while (true)
+    {
+      if (m_nRungs == 0)
+        {
+          NS_ASSERT (!m_top.empty ());
+          SpawnRung (m_top, m_topMin, m_topMax + 1);
+          const Rung &rung = m_rungs[0];
+          m_topStart = rung.start + rung.nBuckets * rung.width;
+          m_top.clear ();
+        }
+      Rung &rung = m_rungs[m_nRungs - 1];
+      if (rung.nEvents == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung.buckets[rung.current].empty ())
+        {
+          rung.current++;
+        }
+      NS_ASSERT (rung.current < rung.nBuckets);
+      Bucket &bucket = rung.buckets[rung.current];
+      uint64_t start = GetCurrentStart (rung);
+      rung.current++;
+      rung.nEvents -= bucket.size ();
+      if (bucket.size () > LADDER_THRESHOLD && m_nRungs < LADDER_MAX_RUNGS && rung.width > 1)
+        {
+          SpawnRung (bucket, start, start + rung.width);
+          bucket.clear ();
+          continue;
+        }
+      m_bottom.swap (bucket);
+      std::sort (m_bottom.begin (), m_bottom.end (), IsLater);
+      return;
+    }
+}
+
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_size == 0;
+}
+
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      // Moving the next events down the ladder does not change the events held
+      const_cast<LadderScheduler *> (this)->FillBottom ();
+    }
+  return m_bottom.back ();
+}
+
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      FillBottom ();
+    }
+  Scheduler::Event ev = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  NS_LOG_LOGIC ("remove ts=" << ev.key.m_ts << ", key=" << ev.key.m_uid);
+  return ev;
+}
+
+void
+LadderScheduler::RemoveNextBatch (std::vector<Scheduler::Event> &events)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_bottom.empty ())
+    {
+      FillBottom ();
+    }
+  uint64_t ts = m_bottom.back ().key.m_ts;
+  while (true)
+    {
+      // The events of a timestamp are next to each other at the end of Bottom
+      while (!m_bottom.empty () && m_bottom.back ().key.m_ts == ts)
+        {
+          events.push_back (m_bottom.back ());
+          m_bottom.pop_back ();
+          m_size--;
+        }
+      if (!m_bottom.empty () || m_size == 0)
+        {
+          return;
+        }
+      FillBottom ();
+      if (m_bottom.back ().key.m_ts != ts)
+        {
+          return;
+        }
+    }
+}
+
+bool
+LadderScheduler::HasFastBatches (void) const
+{
+  return true;
+}
+
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (!IsEmpty ());
+  uint64_t ts = ev.key.m_ts;
+  Bucket *bucket = 0;
+  if (ts >= m_topStart)
+    {
+      bucket = &m_top;
+    }
+  else
+    {
+      for (uint32_t r = 0; r < m_nRungs; ++r)
+        {
+          Rung &rung = m_rungs[r];
+          if (ts >= GetCurrentStart (rung))
+            {
+              bucket = &rung.buckets[(ts - rung.start) / rung.width];
+              rung.nEvents--;
+              break;
+            }
+        }
+    }
+  m_size--;
+  if (bucket == 0)
+    {
+      Bucket::iterator i = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, IsLater);
+      NS_ASSERT (i != m_bottom.end () && i->key.m_uid == ev.key.m_uid);
+      m_bottom.erase (i);
+      return;
+    }
+  // The buckets are unsorted, the last event takes the place of the one removed
+  for (Bucket::iterator i = bucket->begin (); i != bucket->end (); ++i)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (ev.impl == i->impl);
+          *i = bucket->back ();
+          bucket->pop_back ();
+          return;
+        }
+    }
+  NS_ASSERT (false);
+}
+
+} // namespace ns3
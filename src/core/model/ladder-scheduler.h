@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::LadderScheduler class declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue of
+ * "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation" by Wai Teng Tang, Rick Siow Mong Goh
+ * and Ian Li-Jin Thng (2005).
+ *
+ * The events are held in three tiers:
+ *   - Top, an unsorted list of the events farther in the future
+ *     than the ladder;
+ *   - the ladder, a stack of rungs of buckets. The events of a
+ *     bucket are unsorted, and a bucket with too many events to be
+ *     sorted cheaply spills over into a finer rung below;
+ *   - Bottom, a small sorted list of the next events.
+ *
+ * When Bottom is empty, the next bucket of the lowest rung is
+ * sorted into it. When the ladder is empty, Top is spread over a
+ * new first rung, whose buckets are sized from the number of
+ * events and their range. No event is ever sorted with more than
+ * a bucket's worth of others, so Insert and RemoveNext run in
+ * amortized constant time, even when the timestamps are skewed or
+ * bursty. Remove searches the single bucket, or tier, where the
+ * timestamp of the event belongs.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  LadderScheduler ();
+  /** Destructor. */
+  virtual ~LadderScheduler ();
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void RemoveNextBatch (std::vector<Scheduler::Event> &events);
+  virtual bool HasFastBatches (void) const;
+  virtual void Remove (const Scheduler::Event &ev);
+
+private:
+  /** Bucket type: an unsorted vector of Events. */
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  /** A rung of the ladder. */
+  struct Rung
+  {
+    uint64_t start;                 /**< Timestamp at the start of the first bucket. */
+    uint64_t width;                 /**< Duration of a bucket, in dimensionless time units. */
+    uint32_t nBuckets;              /**< Number of buckets in use. */
+    uint32_t current;               /**< Index of the first bucket not yet moved down. */
+    uint32_t nEvents;               /**< Number of events in the buckets of the rung. */
+    std::vector<Bucket> buckets;    /**< The buckets, the storage of the others is kept for reuse. */
+  };
+
+  /**
+   * Get the timestamp at the start of the current bucket of a rung.
+   * The events of the rung, and of the rungs above, are not earlier.
+   *
+   * \param [in] rung The rung.
+   * \returns The timestamp at the start of the current bucket.
+   */
+  static uint64_t GetCurrentStart (const Rung &rung);
+  /**
+   * Spread events over a new rung below the lowest one.
+   *
+   * \param [in] events The events.
+   * \param [in] start The timestamp at the start of the rung.
+   * \param [in] end The timestamp at the end of the rung, later than all the events.
+   */
+  void SpawnRung (const Bucket &events, uint64_t start, uint64_t end);
+  /** Move the next events to Bottom, which must be empty. */
+  void FillBottom (void);
+  /**
+   * Insert an event in Bottom, at its rank.
+   *
+   * \param [in] ev The event.
+   */
+  void InsertBottom (const Scheduler::Event &ev);
+
+  /** Events of Top, unsorted. */
+  Bucket m_top;
+  /** Smallest timestamp of Top. */
+  uint64_t m_topMin;
+  /** Largest timestamp of Top. */
+  uint64_t m_topMax;
+  /** Events later than this are inserted in Top. */
+  uint64_t m_topStart;
+  /** The rungs, allocated once. The storage of the rungs not in use is kept for reuse. */
+  std::vector<Rung> m_rungs;
+  /** Number of rungs in use. */
+  uint32_t m_nRungs;
+  /** Events of Bottom, sorted latest first. */
+  Bucket m_bottom;
+  /** Number of events in the scheduler. */
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
@@ -136,6 +136,10 @@
  * This macro allows you to log an arbitrary message at a specific
  * log level.
  *
+ * Each call site caches whether its level is enabled, until the
+ * levels of a LogComponent change, so a disabled call site only
+ * costs a comparison and a branch.
+ *
  * The log message is expected to be a C++ ostream
  * message such as "my string" << aNumber << "my oth stream".
  *
@@ -153,7 +157,8 @@
   NS_LOG_CONDITION                                              \
   do                                                            \
     {                                                           \
-      if (g_log.IsEnabled (level))                              \
+      static std::atomic<uint32_t> ns3LogCallSite (0);          \
+      if (g_log.IsEnabled (level, ns3LogCallSite))              \
         {                                                       \
           NS_LOG_APPEND_TIME_PREFIX;                            \
           NS_LOG_APPEND_NODE_PREFIX;                            \
@@ -177,7 +182,8 @@
   NS_LOG_CONDITION                                              \
   do                                                            \
     {                                                           \
-      if (g_log.IsEnabled (ns3::LOG_FUNCTION))                  \
+      static std::atomic<uint32_t> ns3LogCallSite (0);          \
+      if (g_log.IsEnabled (ns3::LOG_FUNCTION, ns3LogCallSite))  \
         {                                                       \
           NS_LOG_APPEND_TIME_PREFIX;                            \
           NS_LOG_APPEND_NODE_PREFIX;                            \
@@ -214,7 +220,8 @@
   NS_LOG_CONDITION                                              \
   do                                                            \
     {                                                           \
-      if (g_log.IsEnabled (ns3::LOG_FUNCTION))                  \
+      static std::atomic<uint32_t> ns3LogCallSite (0);          \
+      if (g_log.IsEnabled (ns3::LOG_FUNCTION, ns3LogCallSite))  \
         {                                                       \
           NS_LOG_APPEND_TIME_PREFIX;                            \
           NS_LOG_APPEND_NODE_PREFIX;                            \
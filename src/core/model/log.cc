@@ -111,6 +111,8 @@ PrintList::PrintList ()
 }
 
 
+std::atomic<uint32_t> LogComponent::m_generation (1);
+
 LogComponent::LogComponent (const std::string & name,
                             const std::string & file,
                             const enum LogLevel mask /* = 0 */)
@@ -293,6 +295,19 @@ LogComponent::IsEnabled (const enum LogLevel level) const
   return (level & m_levels) ? 1 : 0;
 }
 
+bool
+LogComponent::IsEnabledSlow (const enum LogLevel level, std::atomic<uint32_t> &cache) const
+{
+  uint32_t generation = m_generation.load (std::memory_order_relaxed);
+  if (cache.load (std::memory_order_relaxed) == 2 * generation + 1)
+    {
+      return true;
+    }
+  bool enabled = IsEnabled (level);
+  cache.store (2 * generation + (enabled ? 1 : 0), std::memory_order_relaxed);
+  return enabled;
+}
+
 bool
 LogComponent::IsNoneEnabled (void) const
 {
@@ -309,12 +324,14 @@ void
 LogComponent::Enable (const enum LogLevel level)
 {
   m_levels |= (level & ~m_mask);
+  m_generation++;
 }
 
 void 
 LogComponent::Disable (const enum LogLevel level)
 {
   m_levels &= ~level;
+  m_generation++;
 }
 
 char const *
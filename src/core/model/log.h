@@ -21,6 +21,7 @@
 #ifndef NS3_LOG_H
 #define NS3_LOG_H
 
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <stdint.h>
@@ -354,6 +355,29 @@ public:
    * \return \c true if we are enabled at \c level.
    */
   bool IsEnabled (const enum LogLevel level) const;
+  /**
+   * Check if this LogComponent is enabled for \c level, through the
+   * cached state of a call site.
+   *
+   * The cache holds twice the generation of the log levels when it
+   * was filled, plus one if \c level was enabled. Enabling or
+   * disabling any LogComponent starts a new generation, so while
+   * the levels do not change, a disabled call site costs a single
+   * comparison.
+   *
+   * \param [in] level The level to check for.
+   * \param [in,out] cache The state of the call site, zero at first.
+   * \return \c true if we are enabled at \c level.
+   */
+  inline bool IsEnabled (const enum LogLevel level, std::atomic<uint32_t> &cache) const
+  {
+    if (cache.load (std::memory_order_relaxed)
+        == 2 * m_generation.load (std::memory_order_relaxed))
+      {
+        return false;
+      }
+    return IsEnabledSlow (level, cache);
+  }
   /**
    * Check if all levels are disabled.
    *
@@ -426,7 +450,19 @@ private:
    * LogComponent.
    */
   void EnvVarCheck (void);
-  
+  /**
+   * Check if this LogComponent is enabled for \c level, when the cache
+   * of the call site is enabled or stale.
+   *
+   * \param [in] level The level to check for.
+   * \param [in,out] cache The state of the call site.
+   * \return \c true if we are enabled at \c level.
+   */
+  bool IsEnabledSlow (const enum LogLevel level, std::atomic<uint32_t> &cache) const;
+
+  /** Generation of the log levels of all the LogComponents, from one. */
+  static std::atomic<uint32_t> m_generation;
+
   int32_t     m_levels;  //!< Enabled LogLevels.
   int32_t     m_mask;    //!< Blocked LogLevels.
   std::string m_name;    //!< LogComponent name.
@@ -100,6 +100,31 @@ MapScheduler::RemoveNext (void)
   return ev;
 }
 
+void
+MapScheduler::RemoveNextBatch (std::vector<Scheduler::Event> &events)
+{
+  NS_LOG_FUNCTION (this);
+  EventMapI begin = m_list.begin ();
+  NS_ASSERT (begin != m_list.end ());
+  uint64_t ts = begin->first.m_ts;
+  EventMapI end = begin;
+  while (end != m_list.end () && end->first.m_ts == ts)
+    {
+      Event ev;
+      ev.impl = end->second;
+      ev.key = end->first;
+      events.push_back (ev);
+      ++end;
+    }
+  m_list.erase (begin, end);
+}
+
+bool
+MapScheduler::HasFastBatches (void) const
+{
+  return true;
+}
+
 void
 MapScheduler::Remove (const Event &ev)
 {
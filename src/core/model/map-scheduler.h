@@ -60,6 +60,8 @@ public:
   virtual bool IsEmpty (void) const;
   virtual Scheduler::Event PeekNext (void) const;
   virtual Scheduler::Event RemoveNext (void);
+  virtual void RemoveNextBatch (std::vector<Scheduler::Event> &events);
+  virtual bool HasFastBatches (void) const;
   virtual void Remove (const Scheduler::Event &ev);
 
 private:
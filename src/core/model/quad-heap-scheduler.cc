@@ -0,0 +1,298 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "quad-heap-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::QuadHeapScheduler class implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("QuadHeapScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (QuadHeapScheduler);
+
+namespace {
+
+/** Number of children of a node. */
+const std::size_t QUAD_HEAP_ARITY = 4;
+/** Size of a cache line, in bytes. */
+const std::size_t QUAD_HEAP_CACHE_LINE = 64;
+/** Initial capacity of the heap. */
+const std::size_t QUAD_HEAP_INITIAL_CAPACITY = 16;
+
+} // unnamed namespace
+
+TypeId
+QuadHeapScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::QuadHeapScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<QuadHeapScheduler> ()
+  ;
+  return tid;
+}
+
+QuadHeapScheduler::QuadHeapScheduler ()
+  : m_heap (0),
+    m_size (0),
+    m_capacity (0)
+{
+  NS_LOG_FUNCTION (this);
+  Grow ();
+}
+
+QuadHeapScheduler::~QuadHeapScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+bool
+QuadHeapScheduler::IsLess (const Node &a, const Node &b)
+{
+  return a.ts < b.ts || (a.ts == b.ts && a.uid < b.uid);
+}
+
+Scheduler::Event
+QuadHeapScheduler::GetEvent (const Node &node) const
+{
+  const Payload &payload = m_payloads[node.payload];
+  Scheduler::Event ev;
+  ev.impl = payload.impl;
+  ev.key.m_ts = node.ts;
+  ev.key.m_uid = node.uid;
+  ev.key.m_context = payload.context;
+  return ev;
+}
+
+void
+QuadHeapScheduler::Grow (void)
+{
+  std::size_t capacity = std::max (2 * m_capacity, QUAD_HEAP_INITIAL_CAPACITY);
+  NS_LOG_FUNCTION (this << capacity);
+  // Room to shift the heap by up to a cache line
+  const std::size_t perLine = QUAD_HEAP_CACHE_LINE / sizeof (Node);
+  std::vector<Node> storage (capacity + perLine);
+  // The children of the root, and so all the groups of siblings,
+  // start on a cache line
+  std::size_t shift = 0;
+  while (shift < perLine
+         && (reinterpret_cast<uintptr_t> (&storage[shift + 1]) % QUAD_HEAP_CACHE_LINE) != 0)
+    {
+      shift++;
+    }
+  if (shift == perLine)
+    {
+      // The allocator does not align the nodes on their size
+      shift = 0;
+    }
+  Node *heap = &storage[shift];
+  std::copy (m_heap, m_heap + m_size, heap);
+  m_storage.swap (storage);
+  m_heap = heap;
+  m_capacity = capacity;
+}
+
+std::size_t
+QuadHeapScheduler::SmallestChild (std::size_t first) const
+{
+  if (first + QUAD_HEAP_ARITY > m_size)
+    {
+      std::size_t smallest = first;
+      for (std::size_t child = first + 1; child < m_size; ++child)
+        {
+          if (IsLess (m_heap[child], m_heap[smallest]))
+            {
+              smallest = child;
+            }
+        }
+      return smallest;
+    }
+#if defined (__GNUC__)
+  // Whichever child is picked, its own children are fetched by then
+  for (std::size_t grandChildren = QUAD_HEAP_ARITY * first + 1;
+       grandChildren < std::min (QUAD_HEAP_ARITY * (first + QUAD_HEAP_ARITY) + 1, m_size);
+       grandChildren += QUAD_HEAP_ARITY)
+    {
+      __builtin_prefetch (&m_heap[grandChildren]);
+    }
+#endif
+  // A tournament, whose outcomes do not depend on each other
+  std::size_t a = IsLess (m_heap[first + 1], m_heap[first]) ? first + 1 : first;
+  std::size_t b = IsLess (m_heap[first + 3], m_heap[first + 2]) ? first + 3 : first + 2;
+  return IsLess (m_heap[b], m_heap[a]) ? b : a;
+}
+
+void
+QuadHeapScheduler::SiftUp (std::size_t index, const Node &node)
+{
+  while (index > 0)
+    {
+      std::size_t parent = (index - 1) / QUAD_HEAP_ARITY;
+      if (!IsLess (node, m_heap[parent]))
+        {
+          break;
+        }
+      m_heap[index] = m_heap[parent];
+      index = parent;
+    }
+  m_heap[index] = node;
+}
+
+void
+QuadHeapScheduler::SiftDown (std::size_t index, const Node &node)
+{
+  while (true)
+    {
+      std::size_t first = QUAD_HEAP_ARITY * index + 1;
+      if (first >= m_size)
+        {
+          break;
+        }
+      std::size_t smallest = SmallestChild (first);
+      if (!IsLess (m_heap[smallest], node))
+        {
+          break;
+        }
+      m_heap[index] = m_heap[smallest];
+      index = smallest;
+    }
+  m_heap[index] = node;
+}
+
+void
+QuadHeapScheduler::RemoveAt (std::size_t index)
+{
+  m_freePayloads.push_back (m_heap[index].payload);
+  m_size--;
+  if (index == m_size)
+    {
+      return;
+    }
+  // The last node fills the hole, from above or from below
+  Node last = m_heap[m_size];
+  if (index > 0 && IsLess (last, m_heap[(index - 1) / QUAD_HEAP_ARITY]))
+    {
+      SiftUp (index, last);
+    }
+  else
+    {
+      SiftDown (index, last);
+    }
+}
+
+void
+QuadHeapScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  if (m_size == m_capacity)
+    {
+      Grow ();
+    }
+  Payload payload;
+  payload.impl = ev.impl;
+  payload.context = ev.key.m_context;
+  Node node;
+  node.ts = ev.key.m_ts;
+  node.uid = ev.key.m_uid;
+  if (m_freePayloads.empty ())
+    {
+      node.payload = m_payloads.size ();
+      m_payloads.push_back (payload);
+    }
+  else
+    {
+      node.payload = m_freePayloads.back ();
+      m_freePayloads.pop_back ();
+      m_payloads[node.payload] = payload;
+    }
+  m_size++;
+  SiftUp (m_size - 1, node);
+}
+
+bool
+QuadHeapScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_size == 0;
+}
+
+Scheduler::Event
+QuadHeapScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  return GetEvent (m_heap[0]);
+}
+
+Scheduler::Event
+QuadHeapScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  Scheduler::Event ev = GetEvent (m_heap[0]);
+  m_freePayloads.push_back (m_heap[0].payload);
+  m_size--;
+  if (m_size == 0)
+    {
+      return ev;
+    }
+  // The last node almost always belongs near the bottom: the hole
+  // sinks to a leaf without comparing it, then the node moves up
+  // from there, which saves a comparison per level on the way down
+  std::size_t index = 0;
+  while (true)
+    {
+      std::size_t first = QUAD_HEAP_ARITY * index + 1;
+      if (first >= m_size)
+        {
+          break;
+        }
+      std::size_t smallest = SmallestChild (first);
+      m_heap[index] = m_heap[smallest];
+      index = smallest;
+    }
+  SiftUp (index, m_heap[m_size]);
+  return ev;
+}
+
+void
+QuadHeapScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (!IsEmpty ());
+  uint32_t uid = ev.key.m_uid;
+  for (std::size_t i = 0; i < m_size; ++i)
+    {
+      if (m_heap[i].uid == uid)
+        {
+          NS_ASSERT (m_payloads[m_heap[i].payload].impl == ev.impl);
+          RemoveAt (i);
+          return;
+        }
+    }
+  NS_ASSERT (false);
+}
+
+} // namespace ns3
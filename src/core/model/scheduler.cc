@@ -49,4 +49,23 @@ Scheduler::GetTypeId (void)
   return tid;
 }
 
+void
+Scheduler::RemoveNextBatch (std::vector<Event> &events)
+{
+  NS_LOG_FUNCTION (this);
+  Event ev = RemoveNext ();
+  uint64_t ts = ev.key.m_ts;
+  events.push_back (ev);
+  while (!IsEmpty () && PeekNext ().key.m_ts == ts)
+    {
+      events.push_back (RemoveNext ());
+    }
+}
+
+bool
+Scheduler::HasFastBatches (void) const
+{
+  return false;
+}
+
 } // namespace ns3
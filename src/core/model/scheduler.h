@@ -22,6 +22,7 @@
 #define SCHEDULER_H
 
 #include <stdint.h>
+#include <vector>
 #include "object.h"
 
 /**
@@ -127,6 +128,29 @@ public:
    * \return The Event.
    */
   virtual Event RemoveNext (void) = 0;
+  /**
+   * Remove all the events with the earliest timestamp from the event list.
+   *
+   * The events are appended to \p events, in uid order. The default
+   * implementation calls RemoveNext until the timestamp changes;
+   * schedulers which keep the next events sorted together can take
+   * them all at once.
+   *
+   * This method cannot be invoked if the list is empty.
+   *
+   * \param [out] events The events.
+   */
+  virtual void RemoveNextBatch (std::vector<Event> &events);
+  /**
+   * Check if RemoveNextBatch takes the events at once.
+   *
+   * The default RemoveNextBatch saves nothing over as many calls to
+   * RemoveNext, so the simulator only takes batches from the
+   * schedulers which override it.
+   *
+   * \return \c true if RemoveNextBatch is cheaper than RemoveNext.
+   */
+  virtual bool HasFastBatches (void) const;
   /**
    * Remove a specific event from the event list.
    *
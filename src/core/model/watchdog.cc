@@ -34,7 +34,7 @@ NS_LOG_COMPONENT_DEFINE ("Watchdog");
 Watchdog::Watchdog ()
   : m_impl (0),
     m_event (),
-    m_end (MicroSeconds (0))
+    m_extension (MicroSeconds (0))
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -49,26 +49,28 @@ void
 Watchdog::Ping (Time delay)
 {
   NS_LOG_FUNCTION (this << delay);
-  Time end = Simulator::Now () + delay;
-  m_end = std::max (m_end, end);
   if (m_event.IsRunning ())
     {
+      m_extension = std::max (m_extension, delay - Simulator::GetDelayLeft (m_event));
       return;
     }
-  m_event = Simulator::Schedule (m_end - Now (), &Watchdog::Expire, this);
+  m_extension = Time (0);
+  m_event = Simulator::Schedule (delay, &Watchdog::Expire, this);
 }
 
 void
 Watchdog::Expire (void)
 {
   NS_LOG_FUNCTION (this);
-  if (m_end == Simulator::Now ())
+  if (!m_extension.IsStrictlyPositive ())
     {
       m_impl->Invoke ();
     }
   else
     {
-      m_event = Simulator::Schedule (m_end - Now (), &Watchdog::Expire, this);
+      Time extension = m_extension;
+      m_extension = Time (0);
+      m_event = Simulator::Schedule (extension, &Watchdog::Expire, this);
     }
 }
 
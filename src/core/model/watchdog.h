@@ -178,8 +178,13 @@ private:
   TimerImpl *m_impl;
   /** The future event scheduled to expire the timer. */
   EventId m_event;
-  /** The absolute time when the timer will expire. */
-  Time m_end;
+  /**
+   * The time the timer will run after m_event, to honor the Pings that
+   * extended it. It is a delay rather than an absolute time, so that
+   * the timer follows the delays of Simulator::Schedule even when they
+   * are not measured in simulation time.
+   */
+  Time m_extension;
 };
 
 } // namespace ns3
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/test.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+/**
+ * \file
+ * \ingroup core-tests
+ * \ingroup logging
+ * \ingroup log-tests
+ * Log test suite.
+ */
+
+/**
+ * \ingroup core-tests
+ * \defgroup log-tests Log test suite
+ */
+
+namespace ns3 {
+
+  namespace tests {
+
+NS_LOG_COMPONENT_DEFINE ("LogTestSuite");
+
+/**
+ * \ingroup log-tests
+ * Check that the call sites follow the levels of their LogComponent
+ * as they are enabled and disabled, through their cached state.
+ */
+class LogCallSiteTestCase : public TestCase
+{
+public:
+  LogCallSiteTestCase ();
+  virtual ~LogCallSiteTestCase () {}
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * Run the same call sites of each macro.
+   * \param [in] arg An argument of the function to log.
+   * \returns What the call sites wrote to std::clog.
+   */
+  static std::string Log (int arg);
+};
+
+LogCallSiteTestCase::LogCallSiteTestCase ()
+  : TestCase ("Check the cached state of the log call sites")
+{
+}
+
+std::string
+LogCallSiteTestCase::Log (int arg)
+{
+  std::ostringstream oss;
+  std::streambuf *clog = std::clog.rdbuf (oss.rdbuf ());
+  NS_LOG_FUNCTION_NOARGS ();
+  NS_LOG_FUNCTION (arg);
+  NS_LOG_INFO ("info " << arg);
+  std::clog.rdbuf (clog);
+  return oss.str ();
+}
+
+void
+LogCallSiteTestCase::DoRun (void)
+{
+#ifdef NS3_LOG_ENABLE
+  LogComponentDisable ("LogTestSuite", LOG_LEVEL_ALL);
+  NS_TEST_EXPECT_MSG_EQ (Log (1), "", "Disabled call sites wrote");
+
+  LogComponentEnable ("LogTestSuite", LOG_DEBUG);
+  NS_TEST_EXPECT_MSG_EQ (Log (2), "", "Call sites of other levels wrote");
+
+  LogComponentEnable ("LogTestSuite", LOG_INFO);
+  std::string out = Log (3);
+  NS_TEST_EXPECT_MSG_EQ (std::count (out.begin (), out.end (), '\n'), 1, "Call sites of other levels wrote");
+  NS_TEST_EXPECT_MSG_NE (out.find ("info 3"), std::string::npos, "Enabled call site did not write");
+
+  LogComponentEnable ("LogTestSuite", LOG_FUNCTION);
+  out = Log (4);
+  NS_TEST_EXPECT_MSG_EQ (std::count (out.begin (), out.end (), '\n'), 3, "Enabled call sites did not write");
+  NS_TEST_EXPECT_MSG_NE (out.find ("Log(4)"), std::string::npos, "Enabled call site did not write");
+  NS_TEST_EXPECT_MSG_NE (out.find ("info 4"), std::string::npos, "Enabled call site did not write");
+
+  LogComponentDisable ("LogTestSuite", LOG_LEVEL_ALL);
+  NS_TEST_EXPECT_MSG_EQ (Log (5), "", "Call sites still wrote once disabled");
+#endif
+}
+
+/**
+ * \ingroup log-tests
+ * Log test suite
+ */
+class LogTestSuite : public TestSuite
+{
+public:
+  LogTestSuite ();
+};
+
+LogTestSuite::LogTestSuite ()
+  : TestSuite ("log")
+{
+  AddTestCase (new LogCallSiteTestCase);
+}
+
+/**
+ * \ingroup log-tests
+ * LogTestSuite instance variable.
+ */
+static LogTestSuite g_logTestSuite;
+
+
+  }  // namespace tests
+
+}  // namespace ns3
@@ -23,6 +23,16 @@
 #include "ns3/heap-scheduler.h"
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
+#include "ns3/ladder-scheduler.h"
+#include "ns3/quad-heap-scheduler.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/make-event.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <fstream>
+#include <sstream>
 
 using namespace ns3;
 
@@ -461,6 +471,333 @@ SimulatorTemplateTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+ * Check that the memory of released events is reused by the next
+ * events of their size class, that a free list holds at most 256
+ * events, and that larger events still work.
+ */
+class EventPoolTestCase : public TestCase
+{
+public:
+  EventPoolTestCase ();
+private:
+  virtual void DoRun (void);
+
+  /** An argument too large for the event pool. */
+  struct Large
+  {
+    char data[200];  //!< Payload.
+  };
+
+  void Small (int) {}
+  void Medium (int, int, int, int, int) {}
+  void Big (Large large)
+  {
+    m_large = large.data[199];
+  }
+
+  char m_large;  //!< Last byte of the last large argument.
+};
+
+EventPoolTestCase::EventPoolTestCase ()
+  : TestCase ("Check the reuse of the memory of the events")
+{
+}
+
+void
+EventPoolTestCase::DoRun (void)
+{
+  EventImpl *small = MakeEvent (&EventPoolTestCase::Small, this, 0);
+  EventImpl *medium = MakeEvent (&EventPoolTestCase::Medium, this, 0, 0, 0, 0, 0);
+  small->Unref ();
+  medium->Unref ();
+  EventImpl *reused = MakeEvent (&EventPoolTestCase::Small, this, 1);
+  NS_TEST_EXPECT_MSG_EQ (reused, small, "Released event not reused");
+  EventImpl *other = MakeEvent (&EventPoolTestCase::Medium, this, 1, 1, 1, 1, 1);
+  NS_TEST_EXPECT_MSG_EQ (other, medium, "Released event not reused by its size class");
+  reused->Unref ();
+  other->Unref ();
+
+  // Twice the cap empties the free list, which then keeps the first
+  // events released, the others going back to the global allocator
+  std::vector<EventImpl *> events;
+  for (uint32_t i = 0; i < 512; ++i)
+    {
+      events.push_back (MakeEvent (&EventPoolTestCase::Small, this, i));
+    }
+  for (uint32_t i = 0; i < events.size (); ++i)
+    {
+      events[i]->Unref ();
+    }
+  bool capped = true;
+  for (uint32_t i = 256; i > 0; --i)
+    {
+      EventImpl *event = MakeEvent (&EventPoolTestCase::Small, this, i);
+      capped = capped && event == events[i - 1];
+      events[i - 1] = event;
+    }
+  NS_TEST_EXPECT_MSG_EQ (capped, true, "Free list not capped at 256 events");
+  for (uint32_t i = 0; i < 256; ++i)
+    {
+      events[i]->Unref ();
+    }
+
+  Large large;
+  large.data[199] = 42;
+  m_large = 0;
+  EventImpl *big = MakeEvent (&EventPoolTestCase::Big, this, large);
+  big->Invoke ();
+  big->Unref ();
+  NS_TEST_EXPECT_MSG_EQ ((int) m_large, 42, "Large event not run");
+}
+
+/**
+ * Check that a scheduler hands out the events in the same order
+ * as MapScheduler, through the spill-over of the buckets of
+ * LadderScheduler, the growth of QuadHeapScheduler, and the removal
+ * of events from anywhere in the queue.
+ */
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+private:
+  virtual void DoRun (void);
+  ObjectFactory m_schedulerFactory;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check the order of the events of " + schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+void
+SchedulerOrderTestCase::DoRun (void)
+{
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  Ptr<Scheduler> map = CreateObject<MapScheduler> ();
+  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
+  rand->SetStream (1);
+  std::vector<Scheduler::Event> inserted;
+  uint64_t now = 0;
+  uint32_t uid = 0;
+  bool hasLast = false;
+  Scheduler::EventKey last;
+  for (uint32_t step = 0; step < 20000; ++step)
+    {
+      double action = rand->GetValue ();
+      if (action < 0.5 || map->IsEmpty ())
+        {
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          // Mostly bursts of events at the same time, or close, and a tail far in the future
+          double kind = rand->GetValue ();
+          if (kind < 0.3)
+            {
+              ev.key.m_ts = now;
+            }
+          else if (kind < 0.9)
+            {
+              ev.key.m_ts = now + rand->GetInteger (0, 100);
+            }
+          else
+            {
+              ev.key.m_ts = now + rand->GetInteger (0, 1000000);
+            }
+          scheduler->Insert (ev);
+          map->Insert (ev);
+          inserted.push_back (ev);
+        }
+      else if (action < 0.6)
+        {
+          // Remove a random event still scheduled
+          uint32_t i = rand->GetInteger (0, inserted.size () - 1);
+          Scheduler::Event ev = inserted[i];
+          inserted[i] = inserted.back ();
+          inserted.pop_back ();
+          // The events not later than the last one removed have run
+          if (hasLast && !(last < ev.key))
+            {
+              continue;
+            }
+          scheduler->Remove (ev);
+          map->Remove (ev);
+        }
+      else
+        {
+          Scheduler::Event expected = map->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (scheduler->PeekNext ().key.m_uid, expected.key.m_uid, "Wrong next event");
+          Scheduler::Event next = scheduler->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, expected.key.m_uid, "Wrong event removed at " << now);
+          now = next.key.m_ts;
+          last = next.key;
+          hasLast = true;
+        }
+    }
+  while (!map->IsEmpty ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), false, "Events lost");
+      NS_TEST_ASSERT_MSG_EQ (scheduler->RemoveNext ().key.m_uid, map->RemoveNext ().key.m_uid, "Wrong event removed");
+    }
+  NS_TEST_EXPECT_MSG_EQ (scheduler->IsEmpty (), true, "Events left");
+}
+
+/**
+ * Check the events which share a timestamp, and are run as a batch:
+ * their order, the removal of one of them by another, the events
+ * scheduled meanwhile at the same time, a stop in the middle, and a
+ * change of scheduler in the middle.
+ */
+class SimulatorBatchTestCase : public TestCase
+{
+public:
+  SimulatorBatchTestCase (ObjectFactory schedulerFactory);
+private:
+  virtual void DoRun (void);
+  void Record (int i);
+  void RemoveOther (int i);
+  void ScheduleNow (int i);
+  void StopNow (int i);
+  void SwitchScheduler (int i);
+  ObjectFactory m_schedulerFactory;
+  std::vector<int> m_run;
+  EventId m_other;
+};
+
+SimulatorBatchTestCase::SimulatorBatchTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check the events at the same time with " + schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+void
+SimulatorBatchTestCase::Record (int i)
+{
+  m_run.push_back (i);
+}
+
+void
+SimulatorBatchTestCase::RemoveOther (int i)
+{
+  Record (i);
+  NS_TEST_EXPECT_MSG_EQ (Simulator::IsExpired (m_other), false, "Event of the batch expired");
+  Simulator::Remove (m_other);
+  NS_TEST_EXPECT_MSG_EQ (Simulator::IsExpired (m_other), true, "Removed event not expired");
+}
+
+void
+SimulatorBatchTestCase::ScheduleNow (int i)
+{
+  Record (i);
+  Simulator::ScheduleNow (&SimulatorBatchTestCase::Record, this, 100 + i);
+}
+
+void
+SimulatorBatchTestCase::StopNow (int i)
+{
+  Record (i);
+  Simulator::Stop ();
+}
+
+void
+SimulatorBatchTestCase::SwitchScheduler (int i)
+{
+  Record (i);
+  ObjectFactory factory;
+  factory.SetTypeId (HeapScheduler::GetTypeId ());
+  Simulator::SetScheduler (factory);
+}
+
+void
+SimulatorBatchTestCase::DoRun (void)
+{
+  Simulator::SetScheduler (m_schedulerFactory);
+  Simulator::Schedule (Seconds (1), &SimulatorBatchTestCase::Record, this, 0);
+  Simulator::Schedule (Seconds (1), &SimulatorBatchTestCase::ScheduleNow, this, 1);
+  Simulator::Schedule (Seconds (1), &SimulatorBatchTestCase::RemoveOther, this, 2);
+  Simulator::Schedule (Seconds (1), &SimulatorBatchTestCase::StopNow, this, 3);
+  m_other = Simulator::Schedule (Seconds (1), &SimulatorBatchTestCase::Record, this, 4);
+  Simulator::Schedule (Seconds (1), &SimulatorBatchTestCase::Record, this, 5);
+  Simulator::Schedule (Seconds (2), &SimulatorBatchTestCase::Record, this, 6);
+  Simulator::Schedule (Seconds (3), &SimulatorBatchTestCase::SwitchScheduler, this, 7);
+  Simulator::Schedule (Seconds (3), &SimulatorBatchTestCase::Record, this, 8);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_run.size (), 4u, "Wrong number of events before the stop");
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  int expected[] = {0, 1, 2, 3, 5, 101, 6, 7, 8};
+  NS_TEST_ASSERT_MSG_EQ (m_run.size (), sizeof (expected) / sizeof (expected[0]), "Wrong number of events");
+  for (uint32_t i = 0; i < m_run.size (); ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_run[i], expected[i], "Wrong order at " << i);
+    }
+}
+
+/**
+ * Check that the event profiler writes the time of the events by
+ * type and by context.
+ */
+class SimulatorProfilerTestCase : public TestCase
+{
+public:
+  SimulatorProfilerTestCase ();
+private:
+  virtual void DoRun (void);
+  void Event (void);
+  /**
+   * Read a whole file.
+   * \param [in] filename The file name.
+   * \returns The contents of the file.
+   */
+  static std::string Read (const std::string &filename);
+};
+
+SimulatorProfilerTestCase::SimulatorProfilerTestCase ()
+  : TestCase ("Check the profile of the events")
+{
+}
+
+void
+SimulatorProfilerTestCase::Event (void)
+{
+}
+
+std::string
+SimulatorProfilerTestCase::Read (const std::string &filename)
+{
+  std::ifstream is (filename.c_str ());
+  std::ostringstream oss;
+  oss << is.rdbuf ();
+  return oss.str ();
+}
+
+void
+SimulatorProfilerTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("profile.txt");
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileFile", StringValue (filename));
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileSamplingInterval", UintegerValue (1));
+  for (uint32_t i = 0; i < 10; ++i)
+    {
+      Simulator::ScheduleWithContext (7, MicroSeconds (i), &SimulatorProfilerTestCase::Event, this);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileFile", StringValue (""));
+  Config::SetDefault ("ns3::DefaultSimulatorImpl::ProfileSamplingInterval", UintegerValue (16));
+
+  std::string report = Read (filename);
+  NS_TEST_EXPECT_MSG_NE (report.find ("10 events sampled"), std::string::npos, "Wrong number of samples");
+  NS_TEST_EXPECT_MSG_NE (report.find ("SimulatorProfilerTestCase"), std::string::npos, "Event type missing");
+  NS_TEST_EXPECT_MSG_NE (report.find ("node 7"), std::string::npos, "Context missing");
+  std::string folded = Read (filename + ".folded");
+  NS_TEST_EXPECT_MSG_EQ (folded.find ("node 7;"), 0, "Wrong folded stack");
+}
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -477,5 +814,19 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (QuadHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    AddTestCase (new SchedulerOrderTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorBatchTestCase (factory), TestCase::QUICK);
+    AddTestCase (new EventPoolTestCase (), TestCase::QUICK);
+    AddTestCase (new SimulatorProfilerTestCase (), TestCase::QUICK);
   }
 } g_simulatorTestSuite;
@@ -26,12 +26,15 @@
 #include "ns3/config.h"
 #include "ns3/string.h"
 #include "ns3/system-thread.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/make-event.h"
 
 #include <chrono>  // seconds, milliseconds
 #include <ctime>
 #include <list>
 #include <thread>  // sleep_for
 #include <utility>
+#include <vector>
 
 using namespace ns3;
 
@@ -226,6 +229,222 @@ ThreadedSimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_a, m_d, "Bad scheduling");
 }
 
+/**
+ * Check that the events injected by many threads at once are all
+ * run, in the order each thread scheduled them.
+ *
+ * The order only breaks if a thread publishes a slot of the ring while
+ * the main thread swaps the overflow list. With the threads on a single
+ * core this interleaving is rare, ThreadedOverflowOrderTestCase forces it.
+ */
+class ThreadedInjectionTestCase : public TestCase
+{
+public:
+  ThreadedInjectionTestCase ();
+  static void InjectingThread (std::pair<ThreadedInjectionTestCase *, unsigned int> context);
+  void Receive (unsigned int threadno, uint32_t seq);
+  void Poll (void);
+  /** Number of injecting threads. */
+  static const unsigned int THREADS = 8;
+  /** Number of events injected by each thread, enough to fill the ring. */
+  static const uint32_t EVENTS = 20000;
+  uint32_t m_next[THREADS];
+  uint64_t m_received;
+  bool m_inOrder;
+
+private:
+  virtual void DoRun (void);
+};
+
+ThreadedInjectionTestCase::ThreadedInjectionTestCase ()
+  : TestCase ("Check the events injected by " + std::to_string (THREADS) + " threads at once")
+{
+}
+
+void
+ThreadedInjectionTestCase::InjectingThread (std::pair<ThreadedInjectionTestCase *, unsigned int> context)
+{
+  ThreadedInjectionTestCase *me = context.first;
+  unsigned int threadno = context.second;
+  for (uint32_t seq = 0; seq < EVENTS; ++seq)
+    {
+      Simulator::ScheduleWithContext (threadno, Time (0),
+                                      &ThreadedInjectionTestCase::Receive, me, threadno, seq);
+    }
+}
+
+void
+ThreadedInjectionTestCase::Receive (unsigned int threadno, uint32_t seq)
+{
+  if (seq != m_next[threadno])
+    {
+      m_inOrder = false;
+    }
+  m_next[threadno] = seq + 1;
+  m_received++;
+}
+
+void
+ThreadedInjectionTestCase::Poll (void)
+{
+  if (m_received < THREADS * EVENTS)
+    {
+      Simulator::Schedule (MicroSeconds (1), &ThreadedInjectionTestCase::Poll, this);
+    }
+}
+
+void
+ThreadedInjectionTestCase::DoRun (void)
+{
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      m_next[i] = 0;
+    }
+  m_received = 0;
+  m_inOrder = true;
+
+  std::list<Ptr<SystemThread> > threads;
+  for (unsigned int i = 0; i < THREADS; ++i)
+    {
+      threads.push_back (Create<SystemThread> (MakeBoundCallback (
+          &ThreadedInjectionTestCase::InjectingThread,
+          std::pair<ThreadedInjectionTestCase *, unsigned int> (this, i))));
+    }
+  Simulator::Schedule (MicroSeconds (1), &ThreadedInjectionTestCase::Poll, this);
+  for (std::list<Ptr<SystemThread> >::iterator it = threads.begin (); it != threads.end (); ++it)
+    {
+      (*it)->Start ();
+    }
+  Simulator::Run ();
+  for (std::list<Ptr<SystemThread> >::iterator it = threads.begin (); it != threads.end (); ++it)
+    {
+      (*it)->Join ();
+    }
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_received, THREADS * EVENTS, "Lost injected events");
+  NS_TEST_EXPECT_MSG_EQ (m_inOrder, true, "Injected events out of order");
+}
+
+namespace ns3 {
+
+  namespace tests {
+
+/**
+ * Check that the events of a thread stay in order when it publishes an
+ * event in the ring right after the main thread swaps the overflow list,
+ * while the main thread still waits for a slot claimed before the swap.
+ *
+ * The test stands for the thread whose slot is still being written, so
+ * the interleaving happens on every run.
+ */
+class ThreadedOverflowOrderTestCase : public TestCase
+{
+public:
+  ThreadedOverflowOrderTestCase ();
+  static void FillingThread (ThreadedOverflowOrderTestCase *me);
+  static void PublishingThread (ThreadedOverflowOrderTestCase *me);
+  void Receive (uint32_t seq);
+  void ReceiveStalled (void);
+  /** The simulator, driven directly by the test. */
+  Ptr<DefaultSimulatorImpl> m_impl;
+  /** Position of the slot claimed before the swap. */
+  uint64_t m_stalled;
+  /** Number of events scheduled by the filling thread. */
+  uint32_t m_events;
+  /** Sequence numbers of the events received. */
+  std::vector<uint32_t> m_received;
+  /** Whether the event of the stalled slot has been received. */
+  bool m_receivedStalled;
+
+private:
+  virtual void DoRun (void);
+};
+
+ThreadedOverflowOrderTestCase::ThreadedOverflowOrderTestCase ()
+  : TestCase ("Check the order of the events of a thread across a swap of the overflow list")
+{
+}
+
+void
+ThreadedOverflowOrderTestCase::FillingThread (ThreadedOverflowOrderTestCase *me)
+{
+  // Fill the ring but its last slot, which another thread claims and
+  // has not written yet, then the next event goes to the overflow list
+  uint32_t size = me->m_impl->m_eventsWithContextRing.size ();
+  for (uint32_t seq = 0; seq < size - 1; ++seq)
+    {
+      me->m_impl->ScheduleWithContext (0, Time (0), MakeEvent (&ThreadedOverflowOrderTestCase::Receive, me, seq));
+    }
+  me->m_stalled = me->m_impl->m_eventsWithContextTail.fetch_add (1);
+  me->m_impl->ScheduleWithContext (0, Time (0), MakeEvent (&ThreadedOverflowOrderTestCase::Receive, me, size - 1));
+  me->m_events = size;
+}
+
+void
+ThreadedOverflowOrderTestCase::PublishingThread (ThreadedOverflowOrderTestCase *me)
+{
+  // Once the list is swapped, the next event goes to the ring, and is
+  // published before the slot the main thread waits for
+  while (me->m_impl->m_eventsWithContextOverflow.load ())
+    {
+    }
+  me->m_impl->ScheduleWithContext (0, Time (0), MakeEvent (&ThreadedOverflowOrderTestCase::Receive, me, me->m_events));
+  me->m_events++;
+  DefaultSimulatorImpl::EventWithContextSlot &slot =
+    me->m_impl->m_eventsWithContextRing[me->m_stalled % me->m_impl->m_eventsWithContextRing.size ()];
+  slot.event.context = 1;
+  slot.event.timestamp = 0;
+  slot.event.event = MakeEvent (&ThreadedOverflowOrderTestCase::ReceiveStalled, me);
+  slot.sequence.store (me->m_stalled + 1, std::memory_order_release);
+}
+
+void
+ThreadedOverflowOrderTestCase::Receive (uint32_t seq)
+{
+  m_received.push_back (seq);
+}
+
+void
+ThreadedOverflowOrderTestCase::ReceiveStalled (void)
+{
+  m_receivedStalled = true;
+}
+
+void
+ThreadedOverflowOrderTestCase::DoRun (void)
+{
+  m_impl = CreateObject<DefaultSimulatorImpl> ();
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::MapScheduler");
+  m_impl->SetScheduler (factory);
+  m_receivedStalled = false;
+
+  Ptr<SystemThread> filling = Create<SystemThread> (MakeBoundCallback (&ThreadedOverflowOrderTestCase::FillingThread, this));
+  filling->Start ();
+  filling->Join ();
+  NS_TEST_ASSERT_MSG_EQ (m_impl->m_eventsWithContextOverflow.load (), true, "The ring did not overflow");
+
+  Ptr<SystemThread> publishing = Create<SystemThread> (MakeBoundCallback (&ThreadedOverflowOrderTestCase::PublishingThread, this));
+  publishing->Start ();
+  m_impl->ProcessEventsWithContext ();
+  publishing->Join ();
+  m_impl->Run ();
+  m_impl->Destroy ();
+  m_impl = 0;
+
+  NS_TEST_EXPECT_MSG_EQ (m_receivedStalled, true, "Lost the event of the stalled slot");
+  NS_TEST_ASSERT_MSG_EQ (m_received.size (), m_events, "Lost injected events");
+  for (uint32_t i = 0; i < m_received.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_received[i], i, "Injected events out of order");
+    }
+}
+
+  }  // namespace tests
+
+}  // namespace ns3
+
 class ThreadedSimulatorTestSuite : public TestSuite
 {
 public:
@@ -242,7 +461,9 @@ public:
       "ns3::ListScheduler",
       "ns3::HeapScheduler",
       "ns3::MapScheduler",
-      "ns3::CalendarScheduler"
+      "ns3::CalendarScheduler",
+      "ns3::LadderScheduler",
+      "ns3::QuadHeapScheduler"
     };
     unsigned int threadcounts[] = {
       0,
@@ -263,5 +484,7 @@ public:
               }
           }
       }
+    AddTestCase (new ThreadedInjectionTestCase (), TestCase::QUICK);
+    AddTestCase (new ns3::tests::ThreadedOverflowOrderTestCase (), TestCase::QUICK);
   }
 } g_threadedSimulatorTestSuite;
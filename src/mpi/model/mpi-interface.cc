@@ -89,7 +89,8 @@ MpiInterface::Enable (int* pargc, char*** pargv)
           g_parallelCommunicationInterface = new NullMessageMpiInterface ();
           useDefault = false;
         }
-      else if (simulationType.compare ("ns3::DistributedSimulatorImpl") == 0)
+      else if (simulationType.compare ("ns3::DistributedSimulatorImpl") == 0
+               || simulationType.compare ("ns3::DistributedLocalTimeSimulatorImpl") == 0)
         {
           g_parallelCommunicationInterface = new GrantedTimeWindowMpiInterface ();
           useDefault = false;
@@ -0,0 +1,623 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <sys/resource.h>
+
+#include "ns3/core-module.h"
+#include "ns3/node.h"
+#include "ns3/local-clock.h"
+#include "ns3/perfect-clock-model-impl.h"
+#include "ns3/localtime-simulator-impl.h"
+#include "ns3/multithreaded-localtime-simulator-impl.h"
+#include "ns3/clock-helper.h"
+
+using namespace ns3;
+
+
+bool g_debug = false;
+
+std::string g_me;
+#define LOG(x)   std::cout << x << std::endl
+#define LOGME(x) LOG (g_me << x)
+#define DEB(x) if (g_debug) { LOGME (x); }
+
+// Output field width
+int g_fwidth = 6;
+
+/**
+ * Peak resident set size of the process
+ * \return the peak RSS in kB
+ */
+long
+GetPeakRss (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/// Bench class
+class LocalTimeBench
+{
+public:
+  /**
+   * constructor
+   * \param nodes the number of nodes
+   * \param pending the number of pending events per node
+   */
+  LocalTimeBench (const uint32_t nodes, const uint32_t pending)
+    : m_nodes (nodes),
+      m_pending (pending),
+      m_mean (1e6),
+      m_remote (0),
+      m_updates (0),
+      m_batch (false),
+      m_report (true)
+  {
+  }
+
+  /**
+   * Set the mean event interval
+   * \param mean the mean event interval in ns
+   */
+  void SetMean (double mean)
+  {
+    m_mean = mean;
+  }
+  /**
+   * Send some of the events to other nodes
+   * \param remote the probability that an event is sent to a random node
+   * \param lookAhead the minimum delay of an event sent to another node
+   */
+  void SetRemote (double remote, Time lookAhead)
+  {
+    m_remote = remote;
+    m_lookAhead = lookAhead;
+  }
+
+  /**
+   * Run function
+   * \param update interval between two clock updates of a node
+   * \param window interval between two reports
+   * \param stop simulation stop time
+   */
+  void RunBench (Time update, Time window, Time stop);
+  /**
+   * Update all the clocks together
+   * \param batch whether the clocks are adjusted in place in a single batch
+   */
+  void SetBatch (bool batch)
+  {
+    m_batch = batch;
+  }
+  /**
+   * Print the rate of every window
+   * \param report whether the windows are reported, which is only safe with a single thread
+   */
+  void SetReport (bool report)
+  {
+    m_report = report;
+  }
+  /**
+   * Trace the clocks of all the nodes
+   * \param filename name of the trace file, empty for no trace
+   * \param sample interval between two samples of the local times
+   */
+  void SetTrace (std::string filename, Time sample)
+  {
+    m_traceFilename = filename;
+    m_sample = sample;
+  }
+  /**
+   * Print the rate of the whole run
+   * \param elapsed wall clock time of the run in s
+   */
+  void Summary (double elapsed);
+private:
+  /**
+   * callback function
+   * \param node the index of the node
+   */
+  void Cb (uint32_t node);
+  /**
+   * Replace the clock model of a node
+   * \param node the index of the node
+   * \param update interval between two clock updates
+   */
+  void Update (uint32_t node, Time update);
+  /**
+   * Adjust the clocks of all the nodes in place, in a single batch
+   * \param update interval between two clock updates
+   */
+  void Sync (Time update);
+  /**
+   * Print the rate observed since the previous report
+   * \param window interval between two reports
+   */
+  void Report (Time window);
+
+  /// State of a node, only touched by the events of the node
+  struct NodeState
+  {
+    Ptr<LocalClock> clock; ///< clock of the node
+    Ptr<ExponentialRandomVariable> interval; ///< event intervals
+    Ptr<UniformRandomVariable> remote; ///< choice of the remote events
+    uint64_t count; ///< count
+    uint64_t updates; ///< clock updates
+  };
+  /** \return the events run by all the nodes */
+  uint64_t GetCount (void) const;
+  /** \return the clock updates of all the nodes */
+  uint64_t GetUpdates (void) const;
+
+  uint32_t m_nodes; ///< nodes
+  uint32_t m_pending; ///< pending events per node
+  double m_mean; ///< mean event interval
+  double m_remote; ///< probability of a remote event
+  Time m_lookAhead; ///< minimum delay of a remote event
+  uint64_t m_updates; ///< batched clock updates
+  bool m_batch; ///< batch clock updates
+  bool m_report; ///< report every window
+  std::string m_traceFilename; ///< clock trace file
+  Time m_sample; ///< clock trace sample interval
+  Ptr<ClockTraceFile> m_trace; ///< clock trace
+  std::vector<NodeState> m_states; ///< state of the nodes
+  std::vector<Ptr<LocalClock> > m_clocks; ///< clocks of the nodes
+  uint64_t m_lastCount; ///< count at the last report
+  SystemWallClockMs m_time; ///< wall clock of the current window
+};
+
+void
+LocalTimeBench::RunBench (Time update, Time window, Time stop)
+{
+  DEB ("initializing");
+  m_lastCount = 0;
+  m_updates = 0;
+
+  // The node ids are the indexes of m_states, used as contexts
+  NodeContainer nodes;
+  nodes.Create (m_nodes);
+  NS_ABORT_UNLESS (nodes.Get (0)->GetId () == 0);
+  ClockHelper clockHelper;
+  m_clocks = clockHelper.Install (nodes);
+  m_states.resize (m_nodes);
+  for (uint32_t i = 0; i < m_nodes; ++i)
+    {
+      NodeState &state = m_states[i];
+      state.clock = m_clocks[i];
+      state.interval = CreateObject<ExponentialRandomVariable> ();
+      state.interval->SetAttribute ("Mean", DoubleValue (m_mean));
+      state.remote = CreateObject<UniformRandomVariable> ();
+      state.count = 0;
+      state.updates = 0;
+
+      for (uint32_t j = 0; j < m_pending; ++j)
+        {
+          Simulator::ScheduleWithContext (i, NanoSeconds (state.interval->GetValue ()),
+                                          &LocalTimeBench::Cb, this, i);
+        }
+      if (!m_batch)
+        {
+          Simulator::ScheduleWithContext (i, update, &LocalTimeBench::Update, this, i, update);
+        }
+    }
+  if (m_batch)
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, update, &LocalTimeBench::Sync, this, update);
+    }
+  if (m_report)
+    {
+      Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, window, &LocalTimeBench::Report, this, window);
+    }
+  if (!m_traceFilename.empty ())
+    {
+      ClockTraceHelper helper;
+      m_trace = helper.EnableTracing (m_traceFilename, NodeContainer::GetGlobal (), m_sample);
+    }
+  Simulator::Stop (stop);
+
+  DEB ("running");
+  m_time.Start ();
+  Simulator::Run ();
+  LOG ("");
+}
+
+void
+LocalTimeBench::Summary (double elapsed)
+{
+  uint64_t events = GetCount ();
+  LOGME ("events: " << events);
+  LOGME ("clock updates: " << GetUpdates ());
+  LOGME ("wall clock: " << elapsed << " s");
+  LOGME ("rate: " << (events / elapsed) << " ev/s");
+  LOGME ("peak RSS: " << GetPeakRss () << " kB");
+  if (m_trace != 0)
+    {
+      LOGME ("clock trace records: " << m_trace->GetNRecords ());
+    }
+}
+
+uint64_t
+LocalTimeBench::GetCount (void) const
+{
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < m_states.size (); ++i)
+    {
+      count += m_states[i].count;
+    }
+  return count;
+}
+
+uint64_t
+LocalTimeBench::GetUpdates (void) const
+{
+  uint64_t updates = m_updates;
+  for (uint32_t i = 0; i < m_states.size (); ++i)
+    {
+      updates += m_states[i].updates;
+    }
+  return updates;
+}
+
+void
+LocalTimeBench::Cb (uint32_t node)
+{
+  NodeState &state = m_states[node];
+  Time after = NanoSeconds (state.interval->GetValue ());
+  if (m_remote > 0 && state.remote->GetValue () < m_remote)
+    {
+      // Like a packet on a channel, the delay to another node is in global time
+      uint32_t to = state.remote->GetInteger (0, m_nodes - 1);
+      Simulator::ScheduleWithContext (to, m_lookAhead + after, &LocalTimeBench::Cb, this, to);
+    }
+  else
+    {
+      Simulator::Schedule (after, &LocalTimeBench::Cb, this, node);
+    }
+  ++state.count;
+}
+
+void
+LocalTimeBench::Update (uint32_t node, Time update)
+{
+  // Alternate between two frequencies, every pending event of the node is rescheduled
+  NodeState &state = m_states[node];
+  Ptr<PerfectClockModelImpl> model = CreateObject<PerfectClockModelImpl> ();
+  model->SetAttribute ("Frequency", DoubleValue (state.updates % 2 ? 1 : 1.0001));
+  state.clock->SetClock (model);
+  ++state.updates;
+  Simulator::Schedule (update, &LocalTimeBench::Update, this, node, update);
+}
+
+void
+LocalTimeBench::Sync (Time update)
+{
+  // Same frequencies as Update (), applied to every clock at once
+  std::vector<LocalClock::Adjustment> adjustments (m_clocks.size ());
+  double frequency = (m_updates / m_clocks.size ()) % 2 ? 1 : 1.0001;
+  for (uint32_t i = 0; i < m_clocks.size (); ++i)
+    {
+      adjustments[i].clock = m_clocks[i];
+      adjustments[i].frequency = frequency;
+      adjustments[i].offset = Seconds (0);
+    }
+  LocalClock::AdjustClocks (adjustments);
+  m_updates += m_clocks.size ();
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, update, &LocalTimeBench::Sync, this, update);
+}
+
+void
+LocalTimeBench::Report (Time window)
+{
+  double elapsed = m_time.End () / 1000.0;
+  uint64_t count = GetCount ();
+  uint64_t events = count - m_lastCount;
+  Ptr<LocalTimeSimulatorImpl> impl = DynamicCast<LocalTimeSimulatorImpl> (Simulator::GetImplementation ());
+
+  LOG (std::setw (g_fwidth) << Simulator::Now ().GetSeconds () <<
+       std::setw (g_fwidth) << GetUpdates () <<
+       std::setw (g_fwidth) << impl->GetTombstoneCount () <<
+       std::setw (g_fwidth) << events <<
+       std::setw (g_fwidth) << elapsed <<
+       std::setw (g_fwidth) << (events / elapsed) <<
+       std::setw (g_fwidth) << GetPeakRss ());
+
+  m_lastCount = count;
+  m_time.Start ();
+  Simulator::ScheduleWithContext (Simulator::NO_CONTEXT, window, &LocalTimeBench::Report, this, window);
+}
+
+
+/** Event that does nothing */
+void
+Noop (void)
+{
+}
+
+/**
+ * Schedule events from the current context and time the calls
+ * \param n the number of events
+ * \param cost the cost of a call in ns
+ */
+void
+ScheduleMany (uint32_t n, double *cost)
+{
+  SystemWallClockMs timer;
+  timer.Start ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      Simulator::Schedule (NanoSeconds (1 + i), &Noop);
+    }
+  *cost = timer.End () * 1e6 / n;
+}
+
+/**
+ * Time EventId::IsExpired on events moved by a clock update, and on events scheduled since
+ * \param clock the clock of the current node
+ * \param n the number of events of each kind
+ * \param costs the cost of a call in ns, for the moved events and for the others
+ */
+void
+ExpiredMany (Ptr<LocalClock> clock, uint32_t n, double *costs)
+{
+  std::vector<EventId> ids;
+  for (uint32_t i = 0; i < 2 * n; ++i)
+    {
+      if (i == n)
+        {
+          clock->AdjustClock (1.0002, Seconds (0));
+        }
+      ids.push_back (Simulator::Schedule (Seconds (1) + NanoSeconds (i), &Noop));
+    }
+  uint32_t running = 0;
+  SystemWallClockMs timer;
+  for (uint32_t k = 0; k < 2; ++k)
+    {
+      timer.Start ();
+      for (uint32_t i = k * n; i < (k + 1) * n; ++i)
+        {
+          running += ids[i].IsRunning ();
+        }
+      costs[k] = timer.End () * 1e6 / n;
+    }
+  NS_ABORT_UNLESS (running == 2 * n);
+}
+
+/**
+ * Print the cost of Simulator::Schedule from a node without clock and from a node with a clock
+ * \param n the number of events scheduled by each node
+ */
+void
+ScheduleCost (uint32_t n)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  ClockHelper clockHelper;
+  clockHelper.SetClockModelAttribute ("Frequency", DoubleValue (1.0001));
+  Ptr<LocalClock> clock = clockHelper.Install (nodes.Get (1));
+
+  double costs[2];
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      Simulator::ScheduleWithContext (nodes.Get (i)->GetId (), Seconds (i), &ScheduleMany, n, &costs[i]);
+    }
+  Simulator::Run ();
+  LOGME ("events scheduled per node: " << n);
+  LOGME ("schedule without clock: " << costs[0] << " ns");
+  LOGME ("schedule with clock: " << costs[1] << " ns");
+  LOGME ("clock overhead: " << (costs[1] - costs[0]) << " ns");
+
+  // The conversion alone, as done by Schedule, and through the virtual ClockModel interface
+  PointerValue model;
+  clock->GetAttribute ("ClockModel", model);
+  Ptr<ClockModel> clockModel = model.Get<ClockModel> ();
+  Time now = Simulator::Now ();
+  int64_t sum = 0;
+  SystemWallClockMs timer;
+  timer.Start ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      sum += clock->LocalToGlobalDelay (NanoSeconds (1 + i)).GetTimeStep ();
+    }
+  double clockCost = timer.End () * 1e6 / n;
+  timer.Start ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      sum -= clockModel->LocalDelayToGlobalDelay (now, NanoSeconds (1 + i)).GetTimeStep ();
+    }
+  double modelCost = timer.End () * 1e6 / n;
+  NS_ABORT_UNLESS (sum == 0);
+  LOGME ("conversion by LocalClock: " << clockCost << " ns");
+  LOGME ("conversion by ClockModel: " << modelCost << " ns");
+
+  double expiredCosts[2];
+  Simulator::ScheduleWithContext (nodes.Get (1)->GetId (), Seconds (0), &ExpiredMany, clock, n, expiredCosts);
+  Simulator::Run ();
+  LOGME ("IsExpired of a moved event: " << expiredCosts[0] << " ns");
+  LOGME ("IsExpired of an event scheduled since: " << expiredCosts[1] << " ns");
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nodes   =   10;
+  uint32_t pending =   10;
+  double mean      = 1e6;
+  double update    = 0.01;
+  double window    =    1;
+  double stop      =   10;
+  bool batch       = false;
+  bool lazy        = false;
+  bool schedCal    = false;
+  bool schedHeap   = false;
+  bool schedLadder = false;
+  bool schedList   = false;
+  bool schedMap    = false;  // default scheduler
+  bool schedQuad   = false;
+  uint32_t schedule =   0;
+  uint32_t threads =    0;
+  double remote    =    0;
+  double lookahead = 1e-3;
+  std::string trace;
+  double sample    = 1e-3;
+
+  CommandLine cmd;
+  cmd.Usage ("Benchmark the local-time simulator under clock updates.\n"
+             "\n"
+             "Every node keeps --pending events in flight, with intervals\n"
+             "taken from an exponential distribution in local time, and\n"
+             "updates its clock model every --update seconds, which\n"
+             "reschedules all of its pending events.  With --batch, all the\n"
+             "clocks are adjusted in place by a single synchronization\n"
+             "event instead.  With --remote, a fraction of the events is\n"
+             "sent to a random node, at least --lookahead seconds later.\n"
+             "With --threads, the nodes are split between that number of\n"
+             "threads by ns3::MultithreadedLocalTimeSimulatorImpl.  The\n"
+             "event rate, the number of tombstones left by rescheduled\n"
+             "events and the peak RSS are reported for every --window\n"
+             "seconds of simulated time when running on a single thread,\n"
+             "and the rate for the whole run.  With --trace, the clocks are\n"
+             "traced in a binary file, and sampled every --sample seconds.\n"
+             "\n"
+             "With --schedule, only the cost of Simulator::Schedule is\n"
+             "measured instead, by scheduling that number of events from a\n"
+             "node with a clock and from a node without clock, and the cost\n"
+             "of EventId::IsExpired on events moved by a clock update.");
+  cmd.AddValue ("nodes",   "number of nodes (default 10)",                         nodes);
+  cmd.AddValue ("pending", "pending events per node (default 10)",                 pending);
+  cmd.AddValue ("mean",    "mean event interval in ns (default 1E6)",              mean);
+  cmd.AddValue ("update",  "clock update interval per node in s (default 0.01)",   update);
+  cmd.AddValue ("window",  "report interval in s (default 1)",                     window);
+  cmd.AddValue ("stop",    "simulation stop time in s (default 10)",               stop);
+  cmd.AddValue ("batch",   "update all the clocks in a single batch",              batch);
+  cmd.AddValue ("lazy",    "re-time the events lazily on clock slowdowns",         lazy);
+  cmd.AddValue ("cal",     "use CalendarSheduler",                                 schedCal);
+  cmd.AddValue ("heap",    "use HeapScheduler",                                    schedHeap);
+  cmd.AddValue ("ladder",  "use LadderScheduler",                                  schedLadder);
+  cmd.AddValue ("list",    "use ListSheduler",                                     schedList);
+  cmd.AddValue ("map",     "use MapScheduler (default)",                           schedMap);
+  cmd.AddValue ("quad",    "use QuadHeapScheduler",                                schedQuad);
+  cmd.AddValue ("threads", "number of threads, 0 for the single-threaded simulator", threads);
+  cmd.AddValue ("remote",  "probability that an event is sent to another node",    remote);
+  cmd.AddValue ("lookahead", "minimum delay of the remote events in s (default 1E-3)", lookahead);
+  cmd.AddValue ("trace",   "clock trace file, with ns3::ClockTraceHelper",        trace);
+  cmd.AddValue ("sample",  "clock trace sample interval in s (default 1E-3)",     sample);
+  cmd.AddValue ("schedule", "number of events of the Simulator::Schedule cost measure", schedule);
+  cmd.AddValue ("debug",   "enable debugging output",                              g_debug);
+  cmd.AddValue ("prec",    "printed output precision",                             g_fwidth);
+  cmd.Parse (argc, argv);
+  g_me = cmd.GetName () + ": ";
+  g_fwidth += 6;  // 5 extra chars in '2.000002e+07 ': . e+0 _
+
+  if (threads == 0)
+    {
+      GlobalValue::Bind ("SimulatorImplementationType",
+                         StringValue ("ns3::LocalTimeSimulatorImpl"));
+    }
+  else
+    {
+      // The batch update adjusts the clocks of all the partitions from a single event
+      NS_ABORT_MSG_IF (batch, "--batch needs --threads=0");
+      Config::SetDefault ("ns3::MultithreadedLocalTimeSimulatorImpl::Partitions", UintegerValue (threads));
+      Config::SetDefault ("ns3::MultithreadedLocalTimeSimulatorImpl::LookAhead", TimeValue (Seconds (lookahead)));
+      GlobalValue::Bind ("SimulatorImplementationType",
+                         StringValue ("ns3::MultithreadedLocalTimeSimulatorImpl"));
+    }
+  Config::SetDefault ("ns3::LocalTimeSimulatorImpl::LazyRescheduling", BooleanValue (lazy));
+
+  ObjectFactory factory ("ns3::MapScheduler");
+  if (schedCal)
+    {
+      factory.SetTypeId ("ns3::CalendarScheduler");
+    }
+  if (schedHeap)
+    {
+      factory.SetTypeId ("ns3::HeapScheduler");
+    }
+  if (schedLadder)
+    {
+      factory.SetTypeId ("ns3::LadderScheduler");
+    }
+  if (schedList)
+    {
+      factory.SetTypeId ("ns3::ListScheduler");
+    }
+  if (schedQuad)
+    {
+      factory.SetTypeId ("ns3::QuadHeapScheduler");
+    }
+  Simulator::SetScheduler (factory);
+
+  LOGME (std::setprecision (g_fwidth - 6));
+  DEB ("debugging is ON");
+
+  LOGME ("scheduler: " << factory.GetTypeId ().GetName ());
+  if (schedule > 0)
+    {
+      NS_ABORT_MSG_IF (threads != 0, "--schedule needs --threads=0");
+      ScheduleCost (schedule);
+      Simulator::Destroy ();
+      return 0;
+    }
+  LOGME ("nodes: " << nodes);
+  LOGME ("pending events per node: " << pending);
+  LOGME ("mean event interval: " << mean << " ns");
+  LOGME ("clock update interval: " << update << " s");
+  LOGME ("batch clock updates: " << (batch ? "yes" : "no"));
+  LOGME ("lazy rescheduling: " << (lazy ? "yes" : "no"));
+  LOGME ("remote events: " << remote << ", lookahead " << lookahead << " s");
+  LOGME ("threads: " << threads);
+
+  LocalTimeBench *bench = new LocalTimeBench (nodes, pending);
+  bench->SetMean (mean);
+  bench->SetRemote (remote, Seconds (lookahead));
+  bench->SetBatch (batch);
+  // The report reads the counters of all the nodes, which the other threads are updating
+  bench->SetReport (threads == 0);
+  NS_ABORT_MSG_IF (!trace.empty () && threads != 0, "--trace needs --threads=0");
+  bench->SetTrace (trace, Seconds (sample));
+
+  // table header
+  LOG ("");
+  LOG (std::left << std::setw (g_fwidth) << "Sim (s)" <<
+       std::left << std::setw (g_fwidth) << "Updates" <<
+       std::left << std::setw (g_fwidth) << "Tombstones" <<
+       std::left << std::setw (g_fwidth) << "Events" <<
+       std::left << std::setw (g_fwidth) << "Time (s)" <<
+       std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
+       std::left << std::setw (g_fwidth) << "RSS (kB)");
+  LOG (std::setfill ('-') <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
+       std::setfill (' ')
+       );
+
+  SystemWallClockMs total;
+  total.Start ();
+  bench->RunBench (Seconds (update), Seconds (window), Seconds (stop));
+  bench->Summary (total.End () / 1000.0);
+
+  Simulator::Destroy ();
+  delete bench;
+  return 0;
+}
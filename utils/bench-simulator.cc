@@ -49,7 +49,9 @@ public:
    * \param total the total
    */
   Bench (const uint32_t population, const uint32_t total)
-    : m_population (population),
+    : m_farProbability (0),
+      m_fanout (1),
+      m_population (population),
       m_total (total),
       m_count (0)
   {
@@ -64,6 +66,28 @@ public:
     m_rand = stream;
   }
 
+  /**
+   * Draw a fraction of the intervals from a second stream, far in the future
+   * \param stream the random variable stream of the far intervals
+   * \param probability the probability of a far interval
+   */
+  void SetFarStream (Ptr<RandomVariableStream> stream, double probability)
+  {
+    m_far = stream;
+    m_farProbability = probability;
+    m_choice = CreateObject<UniformRandomVariable> ();
+  }
+
+  /**
+   * Schedule each event with others at the same time, like the
+   * receptions of a broadcast
+   * \param fanout the number of events at each time
+   */
+  void SetFanout (const uint32_t fanout)
+  {
+    m_fanout = fanout;
+  }
+
   /**
    * Set population function
    * \param population the population
@@ -87,8 +111,19 @@ public:
 private:
   /// callback function
   void Cb (void);
+  /// callback function of the events which do not schedule others
+  void Receive (void);
+  /**
+   * Draw the next event interval
+   * \return the interval
+   */
+  Time NextInterval (void);
 
   Ptr<RandomVariableStream> m_rand; ///< random variable
+  Ptr<RandomVariableStream> m_far; ///< random variable of the far intervals
+  Ptr<UniformRandomVariable> m_choice; ///< choice of the far intervals
+  double m_farProbability; ///< probability of a far interval
+  uint32_t m_fanout; ///< number of events at each time
   uint32_t m_population; ///< population
   uint32_t m_total; ///< total
   uint32_t m_count; ///< count 
@@ -107,7 +142,7 @@ Bench::RunBench (void)
   time.Start ();
   for (uint32_t i = 0; i < m_population; ++i)
     {
-      Time at = NanoSeconds (m_rand->GetValue ());
+      Time at = NextInterval ();
       Simulator::Schedule (at, &Bench::Cb, this);
     }
   init = time.End ();
@@ -139,18 +174,144 @@ Bench::Cb (void)
     }
   DEB ("event at " << Simulator::Now ().GetSeconds () << "s");
 
-  Time after = NanoSeconds (m_rand->GetValue ());
+  Time after = NextInterval ();
   Simulator::Schedule (after, &Bench::Cb, this);
+  for (uint32_t i = 1; i < m_fanout; ++i)
+    {
+      Simulator::Schedule (after, &Bench::Receive, this);
+    }
+  ++m_count;
+}
+
+void
+Bench::Receive (void)
+{
   ++m_count;
 }
 
+Time
+Bench::NextInterval (void)
+{
+  if (m_far != 0 && m_choice->GetValue () < m_farProbability)
+    {
+      return NanoSeconds (m_far->GetValue ());
+    }
+  return NanoSeconds (m_rand->GetValue ());
+}
+
+/// Bench of the events scheduled from other threads
+class InjectionBench
+{
+public:
+  /**
+   * constructor
+   * \param threads the number of injecting threads
+   * \param total the total number of events injected
+   */
+  InjectionBench (const uint32_t threads, const uint32_t total)
+    : m_threads (threads),
+      m_total (total),
+      m_count (0)
+  {
+  }
+
+  /// Run function
+  void RunBench (void);
+private:
+  /**
+   * Inject a share of the events
+   * \param bench the bench
+   */
+  static void Inject (InjectionBench *bench);
+  /// callback function of the injected events
+  void Cb (void);
+  /// keep the simulation running until all the events are received
+  void Poll (void);
+
+  uint32_t m_threads; ///< number of injecting threads
+  uint32_t m_total; ///< total
+  uint32_t m_count; ///< count
+};
+
+void
+InjectionBench::RunBench (void)
+{
+  SystemWallClockMs time;
+  double simu;
+
+  m_count = 0;
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < m_threads; ++i)
+    {
+      threads.push_back (Create<SystemThread> (MakeBoundCallback (&InjectionBench::Inject, this)));
+    }
+  Simulator::Schedule (NanoSeconds (1), &InjectionBench::Poll, this);
+
+  time.Start ();
+  for (uint32_t i = 0; i < m_threads; ++i)
+    {
+      threads[i]->Start ();
+    }
+  Simulator::Run ();
+  simu = time.End ();
+  simu /= 1000;
+  for (uint32_t i = 0; i < m_threads; ++i)
+    {
+      threads[i]->Join ();
+    }
+
+  LOG (std::setw (g_fwidth) << simu <<
+       std::setw (g_fwidth) << (m_count / simu) <<
+       std::setw (g_fwidth) << (simu / m_count));
+}
+
+void
+InjectionBench::Inject (InjectionBench *bench)
+{
+  uint32_t n = bench->m_total / bench->m_threads;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      Simulator::ScheduleWithContext (0, NanoSeconds (1), &InjectionBench::Cb, bench);
+    }
+}
+
+void
+InjectionBench::Cb (void)
+{
+  ++m_count;
+}
+
+void
+InjectionBench::Poll (void)
+{
+  if (m_count < m_total / m_threads * m_threads)
+    {
+      Simulator::Schedule (NanoSeconds (1), &InjectionBench::Poll, this);
+    }
+}
+
 
 Ptr<RandomVariableStream>
-GetRandomStream (std::string filename)
+GetRandomStream (std::string filename, std::string dist)
 {
   Ptr<RandomVariableStream> stream = 0;
 
-  if (filename == "")
+  if (filename == "" && dist == "uniform")
+    {
+      LOGME ("using uniform distribution");
+      Ptr<UniformRandomVariable> urv = CreateObject<UniformRandomVariable> ();
+      urv->SetAttribute ("Min", DoubleValue (0));
+      urv->SetAttribute ("Max", DoubleValue (200));
+      stream = urv;
+    }
+  else if (filename == "" && dist == "bimodal")
+    {
+      LOGME ("using bimodal distribution");
+      Ptr<ExponentialRandomVariable> erv = CreateObject<ExponentialRandomVariable> ();
+      erv->SetAttribute ("Mean", DoubleValue (10));
+      stream = erv;
+    }
+  else if (filename == "")
     {
       LOGME ("using default exponential distribution");
       Ptr<ExponentialRandomVariable> erv = CreateObject<ExponentialRandomVariable> ();
@@ -205,32 +366,46 @@ int main (int argc, char *argv[])
 
   bool schedCal  = false;
   bool schedHeap = false;
+  bool schedLadder = false;
   bool schedList = false;
   bool schedMap  = true;
+  bool schedQuad = false;
 
   uint32_t pop   =  100000;
   uint32_t total = 1000000;
   uint32_t runs  =       1;
+  uint32_t injectors =    0;
+  uint32_t fanout =       1;
   std::string filename = "";
+  std::string dist = "exp";
 
   CommandLine cmd;
   cmd.Usage ("Benchmark the simulator scheduler.\n"
              "\n"
              "Event intervals are taken from one of:\n"
              "  an exponential distribution, with mean 100 ns,\n"
+             "  a uniform distribution on [0, 200] ns, with --dist=uniform,\n"
+             "  a bimodal distribution, with --dist=bimodal: 90% from an\n"
+             "  exponential distribution with mean 10 ns, 10% from one\n"
+             "  with mean 910 ns,\n"
              "  an ascii file, given by the --file=\"<filename>\" argument,\n"
              "  or standard input, by the argument --file=\"-\"\n"
              "In the case of either --file form, the input is expected\n"
              "to be ascii, giving the relative event times in ns.");
   cmd.AddValue ("cal",   "use CalendarSheduler",          schedCal);
   cmd.AddValue ("heap",  "use HeapScheduler",             schedHeap);
+  cmd.AddValue ("ladder", "use LadderScheduler",          schedLadder);
   cmd.AddValue ("list",  "use ListSheduler",              schedList);
   cmd.AddValue ("map",   "use MapScheduler (default)",    schedMap);
+  cmd.AddValue ("quad",  "use QuadHeapScheduler",         schedQuad);
   cmd.AddValue ("debug", "enable debugging output",       g_debug);
   cmd.AddValue ("pop",   "event population size (default 1E5)",         pop);
   cmd.AddValue ("total", "total number of events to run (default 1E6)", total);
   cmd.AddValue ("runs",  "number of runs (default 1)",    runs);
   cmd.AddValue ("file",  "file of relative event times",  filename);
+  cmd.AddValue ("dist",  "interval distribution: exp, uniform or bimodal (default exp)", dist);
+  cmd.AddValue ("fanout", "number of events scheduled at each time (default 1)", fanout);
+  cmd.AddValue ("injectors", "schedule the events from this many threads instead", injectors);
   cmd.AddValue ("prec",  "printed output precision",      g_fwidth);
   cmd.Parse (argc, argv);
   g_me = cmd.GetName () + ": ";
@@ -245,10 +420,18 @@ int main (int argc, char *argv[])
     {
       factory.SetTypeId ("ns3::HeapScheduler");
     }
+  if (schedLadder)
+    {
+      factory.SetTypeId ("ns3::LadderScheduler");
+    }
   if (schedList)
     {
       factory.SetTypeId ("ns3::ListScheduler");
     }
+  if (schedQuad)
+    {
+      factory.SetTypeId ("ns3::QuadHeapScheduler");
+    }
   Simulator::SetScheduler (factory);
 
   LOGME (std::setprecision (g_fwidth - 6));
@@ -258,9 +441,36 @@ int main (int argc, char *argv[])
   LOGME ("population: " << pop);
   LOGME ("total events: " << total);
   LOGME ("runs: " << runs);
+  LOGME ("events at each time: " << fanout);
+
+  if (injectors > 0)
+    {
+      LOGME ("injecting threads: " << injectors);
+      LOG ("");
+      LOG (std::left << std::setw (g_fwidth) << "Run #" <<
+           std::left << std::setw (g_fwidth) << "Time (s)" <<
+           std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
+           std::left << std::setw (g_fwidth) << "Per (s/ev)");
+      InjectionBench injection (injectors, total);
+      for (uint32_t i = 0; i < runs; i++)
+        {
+          std::cout << std::left << std::setw (g_fwidth) << i;
+          injection.RunBench ();
+        }
+      LOG ("");
+      Simulator::Destroy ();
+      return 0;
+    }
 
   Bench *bench = new Bench (pop, total);
-  bench->SetRandomStream (GetRandomStream (filename));
+  bench->SetRandomStream (GetRandomStream (filename, dist));
+  bench->SetFanout (fanout);
+  if (filename == "" && dist == "bimodal")
+    {
+      Ptr<ExponentialRandomVariable> far = CreateObject<ExponentialRandomVariable> ();
+      far->SetAttribute ("Mean", DoubleValue (910));
+      bench->SetFarStream (far, 0.1);
+    }
 
   // table header
   LOG ("");